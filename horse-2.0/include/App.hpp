@@ -12,6 +12,14 @@ public:
 	void Create(int width, int height, const char* windowTitle);
 
 	void Initialize();
+	// Offscreen rendering without a window. Uses an EGL surfaceless context
+	// on Linux (works with Mesa llvmpipe on GPU-less machines), a hidden SDL
+	// window elsewhere. Everything renders into GetFramebuffer().
+	void InitializeHeadless();
+	// Loads GL function pointers for the current context, call once after
+	// Initialize()/InitializeHeadless()
+	void LoadGL();
+	void SwapBuffers();
 	void Terminate();
 
 	// Setters
@@ -25,6 +33,9 @@ public:
 	SDL_Window* getWindow();
 	SDL_GLContext getContext();
 	bool isActive();
+	bool isHeadless();
+	// Framebuffer to present into, 0 unless headless
+	GLuint getFramebuffer();
 	
 
 
@@ -35,6 +46,14 @@ private:
 	SDL_Window* window = nullptr;
 	SDL_GLContext openGlContext = nullptr;
 	bool active;
+
+	// Headless
+	bool headless = false;
+	void* eglDisplay = nullptr;
+	void* eglContext = nullptr;
+	GLuint framebuffer = 0;
+	GLuint colorRenderbuffer = 0;
+	GLuint depthRenderbuffer = 0;
 };
 
 
@@ -0,0 +1,64 @@
+#ifndef BENCHMARK_HPP
+#define BENCHMARK_HPP
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include "ImportSettings.hpp"
+#include "StressScene.hpp"
+
+struct BenchmarkOptions {
+	int frames = 600;
+	int warmupFrames = 60;
+	int width = 1280;
+	int height = 720;
+	float frameRate = 60.0f;	// scripted time advances 1 / frameRate per frame
+	bool headless = true;
+	std::string cameraPath;		// empty = orbit around the scene
+	bool csv = false;			// also print one machine-readable RESULT line
+	bool deferred = false;		// render with the deferred path instead of forward
+	bool shadows = true;
+	bool depthPrepass = false;	// forward path only
+	bool occlusion = true;		// frustum and occlusion culling
+	bool softwareOcclusion = true;
+	bool simd = true;			// AVX2 software occlusion when the CPU has it
+	bool portals = true;		// cell and portal culling, when the scene has cells
+	bool textureArrays = true;	// pack equally sized textures into array textures
+	bool textureAtlas = true;	// pack small model textures into atlas pages
+	bool textureStreaming = true;
+	int textureBudgetMB = 256;		// resident streamed mip levels
+	int gpuBudgetMB = 0;			// GpuMemory budget, 0 derives it from the device
+	ImportSettings importSettings = ImportSettings::Production();	// --import preview|production
+	std::string scenePath;		// empty = the built in scene
+	double dynamicResolutionMs = 0.0;	// GPU frame time target, 0 = full resolution
+	bool sharpenUpscale = true;		// --upscale sharpen|bilinear
+
+	// Procedural scene added on top of the default one
+	bool stress = false;
+	StressSceneConfig stressConfig;
+
+	// Fills options from the command line. Returns false unless --benchmark
+	// was passed.
+	static bool Parse(int argc, char* argv[], BenchmarkOptions& options);
+};
+
+class FrameStatistics {
+public:
+	void Add(double ms);
+	void Clear();
+
+	size_t GetCount() const { return m_samples.size(); }
+	double GetMin() const;
+	double GetMax() const;
+	double GetMean() const;
+	double GetPercentile(double percentile) const;
+
+	void Print(std::ostream& out, const std::string& label) const;
+
+private:
+	std::vector<double> m_samples;
+	mutable std::vector<double> m_sorted;
+	mutable bool m_sortedValid = false;
+};
+
+#endif
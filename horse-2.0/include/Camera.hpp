@@ -21,17 +21,27 @@ public:
 
 	void SetProjectionMatrix(float fovy, float aspect, float near, float far);
 	void SetFovy(float fovy);
+	void SetPose(const glm::vec3& eye, const glm::vec3& target);
 
 	float GetFovy();
+	float GetNear() const { return m_near; }
+	float GetFar() const { return m_far; }
 	glm::vec3 GetEye();
 	glm::vec3 GetLookDir();
 	glm::mat4 GetProjectionMatrix() const;
 	glm::mat4 GetViewMatrix() const;
 
+	// Eye position is interpolated between simulation ticks, the look
+	// direction follows the mouse directly
+	void StorePreviousState();
+	glm::vec3 GetInterpolatedEye(float alpha) const;
+	glm::mat4 GetInterpolatedViewMatrix(float alpha) const;
+
 private:
 	glm::mat4 m_projectionMatrix;
 
 	glm::vec3 m_eye;
+	glm::vec3 m_previousEye;
 	glm::vec3 m_lookDirection;
 	glm::vec3 m_upVector;
 
@@ -0,0 +1,38 @@
+#ifndef CAMERA_PATH_HPP
+#define CAMERA_PATH_HPP
+
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+
+struct CameraKey {
+	float time;
+	glm::vec3 eye;
+	glm::vec3 target;
+};
+
+// Scripted camera flight used by the benchmark mode. The eye follows a
+// Catmull-Rom spline through the keys, the look-at target is interpolated
+// linearly. Sampling past the last key wraps around to the start.
+class CameraPath {
+public:
+	CameraPath();
+
+	// Text file, one key per line: "time eyeX eyeY eyeZ targetX targetY targetZ".
+	// Blank lines and lines starting with '#' are ignored.
+	bool Load(const std::string& filepath);
+
+	void AddKey(float time, const glm::vec3& eye, const glm::vec3& target);
+	void Sample(float time, glm::vec3& eye, glm::vec3& target) const;
+
+	float GetDuration() const;
+	bool IsEmpty() const { return m_keys.empty(); }
+
+	// Circle around center at the given radius and height
+	static CameraPath CreateOrbit(const glm::vec3& center, float radius, float height, float duration, int keyCount = 16);
+
+private:
+	std::vector<CameraKey> m_keys;
+};
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef CLUSTERED_LIGHTING_HPP
+#define CLUSTERED_LIGHTING_HPP
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+#include "JobSystem.hpp"
+#include "Shader.hpp"
+
+struct PointLight {
+	glm::vec3 position;		// world space
+	float radius;			// no contribution past this distance
+	glm::vec3 color;
+	float intensity;
+};
+
+// Clustered forward lighting. Every frame the lights are binned on the CPU
+// into a froxel grid (screen tiles x exponential depth slices) and the
+// grid, per-cluster light index lists and light data are uploaded as
+// texture buffers, so the fragment shader only loops over the lights that
+// can reach its cluster.
+class ClusteredLighting {
+public:
+	static const int kClustersX = 16;
+	static const int kClustersY = 9;
+	static const int kClustersZ = 24;
+	static const int kClusterCount = kClustersX * kClustersY * kClustersZ;
+	static const int kMaxLights = 4096;
+	static const int kMaxLightsPerCluster = 128;
+
+	// Texture units used by Bind(), unit 0 stays free for material textures
+	static const int kLightDataUnit = 1;
+	static const int kClusterDataUnit = 2;
+	static const int kLightIndexUnit = 3;
+
+	ClusteredLighting();
+
+	void Initialize();
+	void CleanUp();
+	void SetJobSystem(JobSystem* jobSystem);
+
+	void Update(const std::vector<PointLight>& lights, const glm::mat4& view, const glm::mat4& projection, float nearPlane, float farPlane);
+	// Binds the buffers and sets the cluster uniforms on the active program
+	void Bind(Shader* shader, int viewportWidth, int viewportHeight);
+
+	size_t GetLightCount() const { return m_lights.size(); }
+	size_t GetLightIndexCount() const { return m_lightIndices.size(); }
+
+private:
+	struct ClusterRange {
+		int minX, maxX;
+		int minY, maxY;
+		int minZ, maxZ;
+	};
+
+	struct TextureBuffer {
+		GLuint buffer = 0;
+		GLuint texture = 0;
+	};
+
+	void CreateBuffer(TextureBuffer& target, GLenum format);
+	void Upload(TextureBuffer& target, const void* data, size_t bytes);
+	bool ComputeRange(const PointLight& light, const glm::mat4& view, const glm::mat4& projection, ClusterRange& range) const;
+	int SliceForDepth(float depth) const;
+
+	JobSystem* m_jobSystem = nullptr;
+	bool m_initialized = false;
+
+	float m_near = 0.1f;
+	float m_far = 50.0f;
+
+	std::vector<PointLight> m_lights;
+	std::vector<ClusterRange> m_ranges;
+	std::vector<glm::uvec2> m_clusters;		// offset, count into m_lightIndices
+	std::vector<uint32_t> m_lightIndices;
+	std::vector<std::vector<uint32_t>> m_sliceIndices;
+
+	TextureBuffer m_lightData;
+	TextureBuffer m_clusterData;
+	TextureBuffer m_lightIndexData;
+};
+
+#endif
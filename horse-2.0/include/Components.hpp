@@ -0,0 +1,57 @@
+#ifndef COMPONENTS_HPP
+#define COMPONENTS_HPP
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+class Mesh3D;
+
+// Placement of an entity, and where it was at the start of the current
+// simulation tick for interpolated drawing
+struct TransformComponent {
+	glm::vec3 position{ 0.0f };
+	float rotationAngle = 0.0f;
+	glm::vec3 rotationAxis{ 0.0f, 1.0f, 0.0f };
+	glm::vec3 scale{ 1.0f };
+	uint32_t version = 0;		// bumped on every change, shadow caches compare it
+
+	bool hasPrevious = false;
+	glm::vec3 previousPosition{ 0.0f };
+	float previousRotationAngle = 0.0f;
+	glm::vec3 previousScale{ 1.0f };
+
+	glm::mat4 GetModelMatrix() const;
+	// alpha blends previous -> current
+	glm::vec3 GetInterpolatedPosition(float alpha) const;
+	glm::mat4 GetInterpolatedModelMatrix(float alpha) const;
+	void StorePrevious();
+};
+
+// GPU geometry and materials, owned by the entity
+struct RenderableComponent {
+	std::unique_ptr<Mesh3D> mesh;
+};
+
+// Point light at the entity's position, colored like its mesh
+struct LightComponent {
+	float radius = 10.0f;
+	float intensity = 1.0f;
+};
+
+struct NameComponent {
+	std::string name;
+};
+
+struct TagComponent {
+	enum Flags : uint32_t {
+		Static = 1 << 0,		// not expected to move after placement
+		Occluder = 1 << 1,		// rasterized into the CPU occlusion buffer
+	};
+
+	uint32_t flags = 0;
+};
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef DEFERRED_RENDERER_HPP
+#define DEFERRED_RENDERER_HPP
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "ClusteredLighting.hpp"
+#include "Shader.hpp"
+
+// Deferred shading path. The geometry pass writes a compact G-buffer
+// (12 bytes per pixel):
+//   0: RGBA8  albedo, specular strength
+//   1: RG16   octahedral encoded world normal
+//   depth: DEPTH24, world position is rebuilt from it
+// Shade() then runs one fullscreen pass that lights every visible pixel
+// exactly once, reading the same cluster grid as the forward path.
+class DeferredRenderer {
+public:
+	DeferredRenderer();
+
+	void Initialize(int width, int height);
+	void CleanUp();
+
+	// Binds and clears the G-buffer for a width x height pass in its bottom
+	// left corner. The targets are reallocated when the pass does not fit or
+	// uses less than half of them in either direction, so dynamic resolution
+	// can change the size every few frames without reallocating.
+	// Draw the scene with the G-buffer shader afterwards.
+	void BeginGeometryPass(int width, int height);
+	// Lights the G-buffer into targetFramebuffer and writes the scene depth
+	// there too, so forward passes drawn afterwards are depth tested.
+	void Shade(Shader* shader, GLuint targetFramebuffer, const glm::mat4& view, const glm::mat4& projection,
+		const glm::vec3& viewPos, const glm::vec3& ambientColor, ClusteredLighting& lighting);
+
+	// Size of the current pass, and of the allocated targets
+	int GetWidth() const { return m_viewportWidth; }
+	int GetHeight() const { return m_viewportHeight; }
+	int GetTargetWidth() const { return m_width; }
+	int GetTargetHeight() const { return m_height; }
+	size_t GetMemoryBytes() const;
+
+	// Texture units read by Shade(), clear of the cluster lighting units
+	static const int kAlbedoUnit = 4;
+	static const int kNormalUnit = 5;
+	static const int kDepthUnit = 6;
+
+private:
+	void CreateTargets(int width, int height);
+	void DestroyTargets();
+
+	bool m_initialized = false;
+	int m_width = 0;
+	int m_height = 0;
+	int m_viewportWidth = 0;
+	int m_viewportHeight = 0;
+
+	GLuint m_framebuffer = 0;
+	GLuint m_albedo = 0;
+	GLuint m_normal = 0;
+	GLuint m_depth = 0;
+	// Fullscreen triangle is generated from gl_VertexID, core profile still
+	// needs a VAO bound to draw
+	GLuint m_emptyVertexArray = 0;
+};
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef DYNAMIC_RESOLUTION_HPP
+#define DYNAMIC_RESOLUTION_HPP
+
+#include <glad/glad.h>
+#include "Shader.hpp"
+
+// Offscreen scene target whose resolution follows the measured GPU frame
+// time. The scene is rendered into the bottom left GetRenderWidth() x
+// GetRenderHeight() of a window sized target, and Resolve() scales that
+// region up to the window. The scale only moves in kScaleStep steps, and
+// only once the GPU times of the current scale have come back, so the
+// timer query latency does not make it oscillate.
+class DynamicResolution {
+public:
+	enum Upscale {
+		Bilinear,	// framebuffer blit with linear filtering
+		Sharpen,	// bilinear with a contrast limited sharpening filter
+	};
+
+	struct Settings {
+		double targetMs = 1000.0 / 60.0;
+		float minScale = 0.5f;		// per axis, at least 0.5
+		float maxScale = 1.0f;
+		Upscale upscale = Sharpen;
+		float sharpness = 0.5f;		// 0 is plain bilinear
+	};
+
+	static constexpr float kScaleStep = 0.05f;
+	// Frames the GPU times of a new scale need to arrive, kFrameLatency of
+	// GpuProfiler plus a few to average over
+	static const int kSettleFrames = 8;
+
+	DynamicResolution();
+
+	// shader is deferredVert.glsl / upscaleFrag.glsl
+	void Initialize(Shader* upscaleShader, int width, int height);
+	void CleanUp();
+
+	void SetEnabled(bool enabled);
+	bool IsEnabled() const { return m_enabled; }
+	void SetSettings(const Settings& settings);
+	const Settings& GetSettings() const { return m_settings; }
+
+	// Window size changes reallocate the target
+	void Resize(int width, int height);
+	// Once per frame with the latest GPU frame time, 0 when unknown
+	void Update(double gpuMs);
+
+	// Where the scene is drawn this frame and at what size
+	GLuint GetFramebuffer() const { return m_framebuffer; }
+	int GetRenderWidth() const;
+	int GetRenderHeight() const;
+	float GetScale() const { return m_scale; }
+
+	// Scales the rendered region up into the whole of outputFramebuffer
+	void Resolve(GLuint outputFramebuffer);
+
+private:
+	void CreateTarget(int width, int height);
+	void DestroyTarget();
+	float ClampScale(float scale) const;
+
+	Shader* m_shader = nullptr;
+	GLuint m_framebuffer = 0;
+	GLuint m_color = 0;
+	GLuint m_depth = 0;
+	GLuint m_emptyVertexArray = 0;
+	int m_width = 0;
+	int m_height = 0;
+
+	bool m_enabled = false;
+	Settings m_settings;
+	float m_scale = 1.0f;
+	double m_measuredMs = 0.0;
+	int m_samples = 0;
+	int m_framesSinceChange = 0;
+};
+
+#endif
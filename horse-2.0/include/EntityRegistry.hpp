@@ -0,0 +1,131 @@
+#ifndef ENTITY_REGISTRY_HPP
+#define ENTITY_REGISTRY_HPP
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "Components.hpp"
+
+// Index into the registry plus the generation it was created in, so a
+// handle to a destroyed entity never resolves to whatever reuses its slot
+struct Entity {
+	static const uint32_t kInvalidIndex = UINT32_MAX;
+
+	uint32_t index = kInvalidIndex;
+	uint32_t generation = 0;
+
+	bool IsValid() const { return index != kInvalidIndex; }
+	bool operator==(const Entity& other) const { return index == other.index && generation == other.generation; }
+	bool operator!=(const Entity& other) const { return !(*this == other); }
+};
+
+// Sparse set: components are packed densely in insertion order, with a
+// sparse array mapping entity index to dense slot. Systems iterate the dense
+// arrays directly, GetEntities()[i] owns GetComponents()[i]. Removal moves
+// the last component into the hole.
+template <typename T>
+class ComponentPool {
+public:
+	T& Add(Entity entity, T component = T()) {
+		if (entity.index >= m_sparse.size()) {
+			m_sparse.resize(entity.index + 1, kNoSlot);
+		}
+		if (Has(entity)) {
+			T& existing = m_components[m_sparse[entity.index]];
+			existing = std::move(component);
+			return existing;
+		}
+		m_sparse[entity.index] = static_cast<uint32_t>(m_entities.size());
+		m_entities.push_back(entity);
+		m_components.push_back(std::move(component));
+		return m_components.back();
+	}
+
+	void Remove(Entity entity) {
+		if (!Has(entity)) {
+			return;
+		}
+		uint32_t slot = m_sparse[entity.index];
+		uint32_t last = static_cast<uint32_t>(m_entities.size() - 1);
+		if (slot != last) {
+			m_entities[slot] = m_entities[last];
+			m_components[slot] = std::move(m_components[last]);
+			m_sparse[m_entities[slot].index] = slot;
+		}
+		m_entities.pop_back();
+		m_components.pop_back();
+		m_sparse[entity.index] = kNoSlot;
+	}
+
+	bool Has(Entity entity) const {
+		return entity.index < m_sparse.size() && m_sparse[entity.index] != kNoSlot &&
+			m_entities[m_sparse[entity.index]].generation == entity.generation;
+	}
+
+	// The entity must have the component
+	T& Get(Entity entity) { return m_components[m_sparse[entity.index]]; }
+	const T& Get(Entity entity) const { return m_components[m_sparse[entity.index]]; }
+	T* TryGet(Entity entity) { return Has(entity) ? &Get(entity) : nullptr; }
+	const T* TryGet(Entity entity) const { return Has(entity) ? &Get(entity) : nullptr; }
+
+	size_t Size() const { return m_entities.size(); }
+	const std::vector<Entity>& GetEntities() const { return m_entities; }
+	std::vector<T>& GetComponents() { return m_components; }
+	const std::vector<T>& GetComponents() const { return m_components; }
+
+	void Clear() {
+		m_sparse.clear();
+		m_entities.clear();
+		m_components.clear();
+	}
+
+private:
+	enum : uint32_t { kNoSlot = UINT32_MAX };
+
+	std::vector<uint32_t> m_sparse;
+	std::vector<Entity> m_entities;
+	std::vector<T> m_components;
+};
+
+// Entities of a scene and one pool per component type. Not thread safe,
+// only touched from the main thread.
+class EntityRegistry {
+public:
+	EntityRegistry();
+	~EntityRegistry();
+
+	Entity Create();
+	// Removes every component, the entity's handles stop resolving
+	void Destroy(Entity entity);
+	bool IsAlive(Entity entity) const;
+	size_t GetCount() const { return m_generations.size() - m_freeIndices.size(); }
+	void Clear();
+
+	ComponentPool<TransformComponent>& GetTransforms() { return m_transforms; }
+	ComponentPool<RenderableComponent>& GetRenderables() { return m_renderables; }
+	ComponentPool<LightComponent>& GetLights() { return m_lights; }
+	ComponentPool<NameComponent>& GetNames() { return m_names; }
+	ComponentPool<TagComponent>& GetTags() { return m_tags; }
+	const ComponentPool<TransformComponent>& GetTransforms() const { return m_transforms; }
+	const ComponentPool<RenderableComponent>& GetRenderables() const { return m_renderables; }
+	const ComponentPool<LightComponent>& GetLights() const { return m_lights; }
+	const ComponentPool<NameComponent>& GetNames() const { return m_names; }
+	const ComponentPool<TagComponent>& GetTags() const { return m_tags; }
+
+	// Tag flag of an entity, false when it has no tags
+	bool HasTag(Entity entity, uint32_t flag) const;
+	void SetTag(Entity entity, uint32_t flag, bool enabled);
+
+private:
+	std::vector<uint32_t> m_generations;	// per index, bumped on destroy
+	std::vector<uint32_t> m_freeIndices;
+	std::vector<bool> m_alive;
+
+	ComponentPool<TransformComponent> m_transforms;
+	ComponentPool<RenderableComponent> m_renderables;
+	ComponentPool<LightComponent> m_lights;
+	ComponentPool<NameComponent> m_names;
+	ComponentPool<TagComponent> m_tags;
+};
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef FIXED_TIMESTEP_HPP
+#define FIXED_TIMESTEP_HPP
+
+#include <SDL.h>
+
+// Fixed-rate simulation clock driven by SDL's high-resolution counter.
+// Each frame Advance() reports how many simulation ticks are due; what is
+// left over is exposed as an interpolation factor for rendering.
+class FixedTimestep {
+public:
+	FixedTimestep(double tickRate = 120.0, int maxTicksPerFrame = 8);
+
+	void Reset();
+	// Ticks due this frame. Call Tick() before simulating each of them.
+	int Advance();
+	// Moves simulation time forward by one tick
+	void Tick() { m_simulationTime += m_tickDuration; }
+
+	void SetTickRate(double tickRate);
+
+	double GetTickDuration() const { return m_tickDuration; }
+	double GetFrameTime() const { return m_frameTime; }
+	double GetSimulationTime() const { return m_simulationTime; }
+	float GetAlpha() const;
+
+	// Seconds since an arbitrary point, at performance counter resolution
+	static double Now();
+
+private:
+	double m_tickDuration;
+	int m_maxTicksPerFrame;
+
+	Uint64 m_lastCounter = 0;
+	double m_accumulator = 0.0;
+	double m_frameTime = 0.0;
+	double m_simulationTime = 0.0;
+};
+
+#endif
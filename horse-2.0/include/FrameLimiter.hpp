@@ -0,0 +1,72 @@
+#ifndef FRAME_LIMITER_HPP
+#define FRAME_LIMITER_HPP
+
+#include <SDL.h>
+
+// Paces the main loop. The swap interval decides whether presenting waits
+// for vblank, an optional frame cap sleeps away what is left of each frame,
+// and windows without focus drop to a low idle rate. Sleeping is done in
+// 1 ms SDL_Delay calls while the measured length of one, plus its
+// deviation, still fits before the deadline, then the rest is spun so the
+// cap holds to well under a millisecond.
+class FrameLimiter {
+public:
+	enum VSync {
+		VSyncOff = 0,
+		VSyncOn = 1,
+		VSyncAdaptive = -1,		// late frames tear instead of waiting a whole vblank
+	};
+
+	enum IdleState {
+		Active,
+		Unfocused,		// runs at the idle frame rate
+		Hidden,			// minimized or hidden, the caller blocks on events
+	};
+
+	FrameLimiter();
+
+	// Applies the swap interval to the current SDL context. Adaptive falls
+	// back to on when the driver has no late swap tearing. Returns the mode
+	// in effect.
+	VSync SetVSync(VSync mode);
+	VSync GetVSync() const { return m_vsync; }
+	static const char* GetVSyncName(VSync mode);
+	// "off", "on" or "adaptive"
+	static bool VSyncFromName(const char* name, VSync& mode);
+
+	// Frames per second, 0 = uncapped
+	void SetFrameCap(double fps) { m_frameCap = fps; }
+	double GetFrameCap() const { return m_frameCap; }
+	// Cap while unfocused, 0 keeps running at the normal rate
+	void SetIdleFrameRate(double fps) { m_idleFrameRate = fps; }
+	double GetIdleFrameRate() const { return m_idleFrameRate; }
+
+	// From SDL_GetWindowFlags()
+	void UpdateIdleState(Uint32 windowFlags);
+	IdleState GetIdleState() const { return m_idleState; }
+	// Cap in effect for the current state, 0 = uncapped
+	double GetTargetFrameRate() const;
+
+	// Starts the frame schedule over, after blocking or a long stall
+	void Reset();
+	// Call once per frame after presenting. Sleeps until the next frame is
+	// due under the current cap.
+	void Wait();
+	// Time the last Wait() slept
+	double GetWaitMs() const { return m_waitMs; }
+
+private:
+	VSync m_vsync = VSyncOff;
+	double m_frameCap = 0.0;
+	double m_idleFrameRate = 10.0;
+	IdleState m_idleState = Active;
+
+	double m_nextFrame = 0.0;		// FixedTimestep::Now() seconds, 0 = unscheduled
+	double m_waitMs = 0.0;
+
+	// Running estimate of how long SDL_Delay(1) really takes, in ms
+	double m_delayMean = 1.0;
+	double m_delayVariance = 0.0;
+};
+
+#endif
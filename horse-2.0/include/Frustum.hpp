@@ -0,0 +1,26 @@
+#ifndef FRUSTUM_HPP
+#define FRUSTUM_HPP
+
+#include <glm/glm.hpp>
+
+// View frustum as six inward facing planes, extracted from a combined
+// view-projection matrix (Gribb/Hartmann)
+class Frustum {
+public:
+	enum Plane { Left, Right, Bottom, Top, Near, Far, PlaneCount };
+
+	Frustum();
+	explicit Frustum(const glm::mat4& viewProjection);
+
+	void Set(const glm::mat4& viewProjection);
+
+	bool IntersectsSphere(const glm::vec3& center, float radius) const;
+	bool IntersectsBox(const glm::vec3& min, const glm::vec3& max) const;
+
+	const glm::vec4& GetPlane(int index) const { return m_planes[index]; }
+
+private:
+	glm::vec4 m_planes[PlaneCount];
+};
+
+#endif
@@ -0,0 +1,108 @@
+#ifndef GPU_MEMORY_HPP
+#define GPU_MEMORY_HPP
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Bytes of GPU memory held by the renderer. Every buffer, texture and
+// renderbuffer allocation reports its size here under a category and the
+// asset it belongs to. With a budget set, CheckBudget() asks the registered
+// pressure callbacks to release memory before the total reaches it, rather
+// than letting the driver start paging. Only touched from the GL thread.
+class GpuMemory {
+public:
+	enum Category {
+		VertexBuffers,
+		IndexBuffers,
+		UniformBuffers,		// including texture buffers of per frame data
+		Textures,
+		RenderTargets,		// G-buffer, shadow maps, the offscreen framebuffer
+		CategoryCount
+	};
+
+	// Callbacks run when memory is over kPressureThreshold of the budget
+	static constexpr double kPressureThreshold = 0.9;
+
+	// Given the bytes wanted, releases what it can and returns the bytes freed
+	using PressureCallback = std::function<uint64_t(uint64_t bytes)>;
+
+	struct PoolUsage {
+		uint64_t capacity = 0;	// bytes allocated by the pool
+		uint64_t used = 0;		// bytes holding live data
+	};
+
+	static GpuMemory& Get();
+	static const char* GetCategoryName(Category category);
+
+	// Records the current size of an object, replacing its previous size.
+	// Zero bytes releases it, as does the matching Release call.
+	void TrackBuffer(GLuint buffer, Category category, uint64_t bytes, const std::string& asset);
+	void TrackTexture(GLuint texture, Category category, uint64_t bytes, const std::string& asset);
+	void TrackRenderbuffer(GLuint renderbuffer, uint64_t bytes, const std::string& asset);
+	void ReleaseBuffer(GLuint buffer);
+	void ReleaseTexture(GLuint texture);
+	void ReleaseRenderbuffer(GLuint renderbuffer);
+
+	// Pools sub-allocating larger objects report how much of them is in use
+	void ReportPool(const std::string& name, uint64_t capacity, uint64_t used);
+	void RemovePool(const std::string& name);
+
+	// 0 disables the budget
+	void SetBudget(uint64_t bytes) { m_budget = bytes; }
+	uint64_t GetBudget() const { return m_budget; }
+	// Callbacks are asked in registration order until enough is released
+	void AddPressureCallback(const std::string& name, PressureCallback callback);
+	void ClearPressureCallbacks() { m_callbacks.clear(); }
+	// Once per frame
+	void CheckBudget();
+
+	uint64_t GetBytes(Category category) const { return m_categoryBytes[category]; }
+	uint64_t GetTotal() const { return m_total; }
+	uint64_t GetPeak() const { return m_peak; }
+	uint64_t GetPeak(Category category) const { return m_categoryPeaks[category]; }
+	// Bytes per asset, largest first
+	std::vector<std::pair<std::string, uint64_t>> GetAssets() const;
+	const std::map<std::string, PoolUsage>& GetPools() const { return m_pools; }
+
+	// Dedicated video memory reported by the driver (NVX_gpu_memory_info or
+	// ATI_meminfo), 0 when neither is available
+	static uint64_t QueryDeviceMemory();
+	// Bytes of a 2D texture or array with the given mip levels, -1 for the
+	// full chain
+	static uint64_t TextureBytes(int width, int height, int layers, int bytesPerTexel, int levels = 1);
+
+	// One line for the title bar, and a full report
+	std::string GetSummary() const;
+	void Print(std::ostream& out) const;
+
+private:
+	enum ObjectType { Buffer, Texture, Renderbuffer };
+
+	struct Allocation {
+		Category category;
+		uint64_t bytes;
+		std::string asset;
+	};
+
+	GpuMemory();
+	void Track(ObjectType type, GLuint name, Category category, uint64_t bytes, const std::string& asset);
+	void Release(ObjectType type, GLuint name);
+
+	std::map<std::pair<int, GLuint>, Allocation> m_allocations;
+	uint64_t m_categoryBytes[CategoryCount] = {};
+	uint64_t m_categoryPeaks[CategoryCount] = {};
+	uint64_t m_total = 0;
+	uint64_t m_peak = 0;
+	std::map<std::string, PoolUsage> m_pools;
+
+	uint64_t m_budget = 0;
+	std::vector<std::pair<std::string, PressureCallback>> m_callbacks;
+};
+
+#endif
@@ -0,0 +1,107 @@
+#ifndef GPU_PROFILER_HPP
+#define GPU_PROFILER_HPP
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Named GPU timing scopes built on GL_TIMESTAMP queries. Queries are kept in
+// a ring of kFrameLatency frames and only read back once that many frames
+// have passed; a frame whose results are still not available is dropped
+// rather than stalling the pipeline.
+class GpuProfiler {
+public:
+	static const int kFrameLatency = 4;
+	static const int kMaxScopesPerFrame = 64;
+
+	struct ScopeStats {
+		std::string name;
+		int depth = 0;
+		double lastMs = 0.0;
+		double averageMs = 0.0;
+		double minMs = 0.0;
+		double maxMs = 0.0;
+		uint64_t samples = 0;
+	};
+
+	GpuProfiler();
+
+	void Initialize();
+	void CleanUp();
+
+	void BeginFrame();
+	void EndFrame();
+
+	// Scopes may nest, each one is timed independently
+	void BeginScope(const std::string& name);
+	void EndScope();
+
+	const std::vector<ScopeStats>& GetStats() const { return m_stats; }
+	const ScopeStats* GetScope(const std::string& name) const;
+	double GetFrameMs() const { return m_frameStats.lastMs; }
+	double GetAverageFrameMs() const { return m_frameStats.averageMs; }
+	uint64_t GetDroppedFrames() const { return m_droppedFrames; }
+
+	// One line "name avg ms" per scope, for overlays and the window title
+	std::string GetSummary() const;
+
+	// Appends "frame,scope,depth,ms" rows for every resolved frame
+	bool OpenCsv(const std::string& filepath);
+	void CloseCsv();
+	bool IsWritingCsv() const { return m_csv.is_open(); }
+
+	bool IsInitialized() const { return m_initialized; }
+
+private:
+	struct ScopeRecord {
+		int statIndex;
+		int depth;
+		int beginQuery;
+		int endQuery;
+	};
+
+	struct FrameSlot {
+		GLuint queries[kMaxScopesPerFrame * 2 + 2] = {};
+		int usedQueries = 0;
+		std::vector<ScopeRecord> scopes;
+		uint64_t frameNumber = 0;
+		bool pending = false;
+	};
+
+	void ResolveFrame(FrameSlot& slot);
+	void Accumulate(ScopeStats& stats, double ms);
+	int GetStatIndex(const std::string& name, int depth);
+
+	bool m_initialized = false;
+	FrameSlot m_frames[kFrameLatency];
+	int m_currentFrame = 0;
+	uint64_t m_frameNumber = 0;
+	uint64_t m_droppedFrames = 0;
+	bool m_inFrame = false;
+
+	std::vector<int> m_openScopes;
+	std::vector<ScopeStats> m_stats;
+	std::unordered_map<std::string, int> m_statLookup;
+	ScopeStats m_frameStats;
+
+	std::ofstream m_csv;
+};
+
+// RAII helper: times the enclosing block as a named GPU scope
+class GpuScope {
+public:
+	GpuScope(GpuProfiler& profiler, const std::string& name) : m_profiler(profiler) {
+		m_profiler.BeginScope(name);
+	}
+	~GpuScope() {
+		m_profiler.EndScope();
+	}
+
+private:
+	GpuProfiler& m_profiler;
+};
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef IMPORT_SETTINGS_HPP
+#define IMPORT_SETTINGS_HPP
+
+#include <string>
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+
+// Assimp post-processing run when a model is imported. Preview() reads a
+// model as fast as possible while iterating on it, Production() spends
+// import time on fewer, vertex cache friendly draws. Steps run one at a
+// time so the cost of each can be printed.
+struct ImportSettings {
+	// On top of triangulation, smooth normals and flipped UVs, which the
+	// renderer always needs
+	bool joinIdenticalVertices = false;
+	bool improveCacheLocality = false;
+	bool optimizeMeshes = false;			// merge meshes sharing a material
+	bool optimizeGraph = false;				// collapse nodes without their own meshes
+	bool splitLargeMeshes = false;
+	bool removeRedundantMaterials = false;
+	int splitVertexLimit = 1000000;
+	int splitTriangleLimit = 1000000;
+	bool printTimings = false;				// one line per model with each step's time
+
+	static ImportSettings Preview();
+	static ImportSettings Production();
+	// "preview" or "production", false for anything else
+	static bool FromName(const std::string& name, ImportSettings& settings);
+
+	// Reads the file and applies the enabled steps in Assimp's own order,
+	// nullptr with the error printed on failure. The scene is owned by the
+	// importer.
+	const aiScene* Import(Assimp::Importer& importer, const std::string& filepath) const;
+	unsigned int GetFlags() const;
+};
+
+#endif
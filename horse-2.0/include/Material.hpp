@@ -0,0 +1,105 @@
+#ifndef MATERIAL_HPP
+#define MATERIAL_HPP
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+#include "Shader.hpp"
+#include "Texture.hpp"
+#include "TextureArray.hpp"
+
+// std140 layout of the MaterialBlock uniform block in the scene shaders
+struct MaterialBlock {
+	glm::vec4 baseColor;	// rgb color
+	glm::vec4 params;		// x specular strength, y shininess, z texture kind, w array layer
+};
+
+// Surface parameters of one or more objects. Parameters live in a slot of
+// the library's uniform buffer, so binding a material is one buffer range
+// bind plus its texture.
+class Material {
+public:
+	const std::string& GetName() const { return m_name; }
+
+	void SetColor(const glm::vec3& color);
+	void SetSpecular(float strength, float shininess);
+	void SetTexture(Texture* texture);
+
+	glm::vec3 GetColor() const { return m_color; }
+	float GetSpecularStrength() const { return m_specularStrength; }
+	float GetShininess() const { return m_shininess; }
+	Texture* GetTexture() const { return m_texture; }
+	// Position in the library's uniform buffer, in creation order
+	uint32_t GetSlot() const { return m_slot; }
+
+private:
+	friend class MaterialLibrary;
+	Material(const std::string& name, uint32_t slot);
+
+	std::string m_name;
+	uint32_t m_slot;
+	glm::vec3 m_color{ 1.0f };
+	float m_specularStrength = 1.0f;
+	float m_shininess = 32.0f;
+	Texture* m_texture = nullptr;
+	bool m_dirty = true;
+};
+
+// Owns every material and the uniform buffer holding their parameters,
+// one aligned slot each. Binds are skipped when the material is already
+// bound, so draws sorted by material switch state once per run.
+class MaterialLibrary {
+public:
+	static const GLuint kBindingPoint = 0;
+	static const int kTextureUnit = 0;
+	static const int kArrayTextureUnit = 9;
+
+	// MaterialBlock params.z
+	static constexpr float kNoTexture = 0.0f;
+	static constexpr float kStandaloneTexture = 1.0f;
+	static constexpr float kArrayTexture = 2.0f;
+
+	MaterialLibrary();
+
+	Material* Create(const std::string& name);
+	// Shared material for a plain color and texture, one per distinct pair.
+	// Objects without their own material are drawn with these.
+	Material* GetDefault(const glm::vec3& color, Texture* texture);
+
+	// Points the program's MaterialBlock and texture samplers at the library,
+	// once per program (GLSL 4.1 has no layout(binding) for either)
+	void PrepareShader(Shader* shader);
+	// Writes changed materials to the buffer, call before drawing
+	void Upload();
+	// Textures already bound stay bound, materials whose textures share an
+	// array only switch the uniform buffer range
+	void Bind(const Material* material);
+	// Forget the bound material and textures, after other code touched the
+	// binding point or texture units
+	void ResetBindings();
+	void CleanUp();
+
+	size_t GetMaterialCount() const { return m_materials.size(); }
+
+private:
+	void Reserve(size_t count);
+
+	std::vector<std::unique_ptr<Material>> m_materials;
+	std::map<std::tuple<float, float, float, Texture*>, Material*> m_defaults;
+	std::vector<GLuint> m_preparedPrograms;
+
+	GLuint m_buffer = 0;
+	size_t m_capacity = 0;		// slots allocated in m_buffer
+	size_t m_stride = 0;		// slot size, padded to the offset alignment
+	std::vector<unsigned char> m_staging;
+	const Material* m_bound = nullptr;
+	const Texture* m_boundTexture = nullptr;
+	const TextureArray* m_boundArray = nullptr;
+};
+
+#endif
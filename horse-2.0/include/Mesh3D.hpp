@@ -5,15 +5,21 @@
 #include <glm/glm.hpp>
 #include <glm/mat4x4.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <map>
 #include <vector>
+#include <cstdint>
 #include <cctype>
 #include <string>
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
+#include "EntityRegistry.hpp"
+#include "ImportSettings.hpp"
 #include "Texture.hpp"
-#include "Shader.hpp"
+
+class Material;
+class TextureAtlas;
 
 struct Vertex {
     glm::vec3 Position;
@@ -21,46 +27,121 @@ struct Vertex {
     glm::vec2 TexCoords;
 };
 
+// Index range drawn with one material. Model imports gather the faces of
+// every aiMesh sharing a material into one submesh, its indices relative to
+// baseVertex.
+struct Submesh {
+    GLuint indexOffset = 0;
+    GLsizei indexCount = 0;
+    GLint baseVertex = 0;
+    glm::vec3 color{ 1.0f };
+    Texture* texture = nullptr;
+    Material* material = nullptr;   // shared material resolved by the scene
+};
+
+// Geometry, GL buffers and materials of an entity. Transform, name, light
+// and tags live in the registry's component pools, the setters and getters
+// below read and write the entity's components.
 class Mesh3D {
 public:
-    Mesh3D();
+    // The entity must have a TransformComponent and a NameComponent
+    Mesh3D(EntityRegistry& registry, Entity entity);
 
-    bool LoadModel(const std::string& filepath);
+    // CPU-only import, safe to call from a worker thread. InitializeModel()
+    // must follow on the GL thread.
+    bool LoadModel(const std::string& filepath, const ImportSettings& settings = ImportSettings::Production());
+    // Atlas that small model textures are packed into from now on, nullptr
+    // loads every model texture as its own GL texture
+    static void SetTextureAtlas(TextureAtlas* atlas);
 
     void SpecifyVertices(std::vector<GLfloat> vertices, std::vector<GLuint> indicies);
     void Initialize();
     void InitializeModel();
-    void Draw(Shader* shader);
-    void DrawModel(Shader* shader);
+    // Every submesh, material state is bound by the caller
+    void Draw();
+    void DrawModel();
+    void DrawSubmesh(size_t index);
+    // Positions only from the packed position stream, for depth passes that
+    // set their own uniforms
+    void DrawDepth();
     void CleanUp();
 
     void UpdateBuffers();
 
     // Setters
     void SetTexture(Texture* texture);
+    // Material the whole object is drawn with. Otherwise each submesh is
+    // given a shared material matching its color and texture by the scene
+    // (SetSharedMaterial), which SetColor and SetTexture drop again. Both
+    // apply to every submesh.
+    void SetMaterial(Material* material);
+    void SetSharedMaterial(size_t submesh, Material* material);
     void SetPosition(const glm::vec3& pos);
     void SetRotation(float angle, const glm::vec3& axis);
     void SetScale(const glm::vec3& scale);
     void SetColor(const glm::vec3& color);
     void SetName(const std::string name);
     void SetLightEmitter(bool isLightEmitter);
+    void SetLightRadius(float radius);
+    void SetLightIntensity(float intensity);
+    // Static objects are not expected to move after placement, shadow maps
+    // cache them and only re-render when GetTransformVersion() changes
+    void SetStatic(bool isStatic);
+    // Occluders are rasterized into the CPU occlusion buffer, pick large
+    // objects with few triangles
+    void SetOccluder(bool isOccluder);
     void Stretch(char axis, int scale);
 
     // Getters
-    std::string GetName() const { return m_name; }
-    glm::vec3 GetPosition() const { return m_position; }
+    Entity GetEntity() const { return m_entity; }
+    const std::string& GetName() const;
+    glm::vec3 GetPosition() const { return GetTransform().position; }
     glm::vec3 GetColor() const { return m_color; }
-    bool IsLightEmitter() const { return m_isLightEmitter; }
+    Texture* GetTexture() const { return m_texture; }
+    // The first submesh's material when submeshes differ
+    Material* GetMaterial() const { return GetMaterial(0); }
+    Material* GetMaterial(size_t submesh) const;
+    const std::vector<Submesh>& GetSubmeshes() const { return m_submeshes; }
+    bool IsLightEmitter() const;
+    float GetLightRadius() const;
+    float GetLightIntensity() const;
+    bool IsStatic() const;
+    bool IsOccluder() const;
+    uint32_t GetTransformVersion() const { return GetTransform().version; }
+
+    // Object space bounds of the vertex data, valid after Initialize()
+    glm::vec3 GetBoundsMin() const { return m_boundsMin; }
+    glm::vec3 GetBoundsMax() const { return m_boundsMax; }
+    // World space bounding sphere for the given model matrix
+    void GetBoundingSphere(const glm::mat4& model, glm::vec3& center, float& radius) const;
     
     std::vector<Vertex> GetProcessedVerticies() const { return m_processedVertices; }
+    // CPU copies of the object space positions and triangle indices, the
+    // indices of each submesh relative to its baseVertex
+    const std::vector<glm::vec3>& GetPositions() const { return m_positions; }
+    const std::vector<GLuint>& GetIndices() const { return m_processedIndices.empty() ? m_indices : m_processedIndices; }
 
     glm::mat4 GetModelMatrix() const;
+
+    // Interpolation between simulation ticks. StorePreviousTransform() is
+    // called at the start of every tick, alpha blends previous -> current.
+    void StorePreviousTransform();
+    glm::vec3 GetInterpolatedPosition(float alpha) const;
+    glm::mat4 GetInterpolatedModelMatrix(float alpha) const;
     GLuint getVAO() const { return m_vertexArrayObject; }
     GLuint getVBO() const { return m_vertexBufferObject; }
     GLuint getIBO() const { return m_indexBufferObject; }
 private:
+    const TransformComponent& GetTransform() const { return m_registry->GetTransforms().Get(m_entity); }
+    TransformComponent& GetTransform() { return m_registry->GetTransforms().Get(m_entity); }
+
+    EntityRegistry* m_registry;
+    Entity m_entity;
+
     Texture* m_texture = nullptr;
-    std::vector<Texture> m_textures;
+    Material* m_material = nullptr;
+    bool m_hasOwnMaterial = false;
+    std::vector<Submesh> m_submeshes;
 
     std::vector<GLfloat> m_vertices;
     std::vector<GLuint> m_indices;
@@ -68,18 +149,29 @@ private:
     GLuint m_vertexBufferObject = 0;
     GLuint m_indexBufferObject = 0;
 
+    // Tightly packed xyz copy of the vertex positions sharing the index
+    // buffer, so depth-only passes fetch 12 bytes per vertex
+    GLuint m_positionArrayObject = 0;
+    GLuint m_positionBufferObject = 0;
+    std::vector<glm::vec3> m_positions;
+    void CreatePositionStream(const float* positions, size_t count, size_t stride);
+
     // Object Data
-    std::string m_name = "object";
-    glm::vec3 m_position{ 0.0f };
     glm::vec3 m_color{ 1.0f };
-    float m_rotationAngle{ 0.0f };
-    glm::vec3 m_rotationAxis{ 0.0f, 1.0f, 0.0f };
-    glm::vec3 m_scale{ 1.0f };
-    bool m_isLightEmitter = false;
-
-    // Assimp
-    void ProcessMesh(aiMesh* mesh, const aiScene* scene);
-    void ProcessNode(aiNode* node, const aiScene* scene);
+
+    glm::vec3 m_boundsMin{ 0.0f };
+    glm::vec3 m_boundsMax{ 0.0f };
+    void ComputeBounds(const float* positions, size_t count, size_t stride);
+
+    // Assimp, faces are gathered per material index before becoming submeshes.
+    // Vertices are moved by the transforms of the nodes above their mesh.
+    struct ImportGroup {
+        std::vector<Vertex> vertices;
+        std::vector<GLuint> indices;
+    };
+    void ProcessMesh(aiMesh* mesh, const glm::mat4& transform, std::map<unsigned int, ImportGroup>& groups);
+    void ProcessNode(aiNode* node, const aiScene* scene, const glm::mat4& parentTransform, std::map<unsigned int, ImportGroup>& groups);
+    void ProcessMaterial(const aiMaterial* material, std::vector<Vertex>& vertices, Submesh& submesh);
 
     std::vector<Vertex> m_processedVertices;
     std::vector<GLuint> m_processedIndices;
@@ -0,0 +1,88 @@
+#ifndef OCCLUSION_CULLER_HPP
+#define OCCLUSION_CULLER_HPP
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+#include "Frustum.hpp"
+#include "Scene.hpp"
+#include "Shader.hpp"
+
+// Frustum and hardware occlusion culling with temporal coherence, after
+// CHC++ (Mattausch et al.) without the hierarchy since the scene is a flat
+// object list:
+// - objects visible last frame are drawn first and re-queried only every
+//   few frames, using their own geometry as the query
+// - objects hidden last frame get a bounding box query, and their draw is
+//   issued under conditional rendering (GL_QUERY_NO_WAIT) so the GPU drops
+//   it if the box failed without the CPU ever waiting for the result
+// Results are read back the next frame, only once they are available.
+class OcclusionCuller {
+public:
+	struct Stats {
+		uint32_t frustumCulled = 0;
+		uint32_t visibleDrawn = 0;		// drawn unconditionally
+		uint32_t conditionalDrawn = 0;	// issued under conditional rendering
+		uint32_t boxQueries = 0;
+		uint32_t geometryQueries = 0;
+		uint32_t occluded = 0;			// results read back as hidden this frame
+	};
+
+	OcclusionCuller();
+
+	// boxShader is a position-only program with u_ModelMatrix, u_ViewMatrix
+	// and u_Projection (depthVert.glsl)
+	void Initialize(Shader* boxShader);
+	void CleanUp();
+	// Forgets all per-object state, call when objects are destroyed
+	void Reset();
+
+	void SetEnabled(bool enabled) { m_enabled = enabled; }
+	bool IsEnabled() const { return m_enabled; }
+	bool UsesConservativeQueries() const { return m_queryTarget == GL_ANY_SAMPLES_PASSED_CONSERVATIVE; }
+
+	// Culls items and calls draw() for the ones that may be visible. shader
+	// is the program draw() renders with, it is re-bound after box queries.
+	void Draw(const std::vector<DrawItem>& items, const glm::mat4& view, const glm::mat4& projection, const glm::vec3& eye,
+		Shader* shader, const std::function<void(const DrawItem&)>& draw);
+
+	const Stats& GetStats() const { return m_stats; }
+
+private:
+	// Visible objects are re-queried every kVisibleQueryInterval frames,
+	// staggered per object so queries spread over frames
+	static const uint32_t kVisibleQueryInterval = 8;
+
+	struct ObjectState {
+		GLuint query = 0;
+		bool pending = false;
+		bool visible = true;
+		uint32_t lastQueryFrame = 0;
+	};
+
+	ObjectState& GetState(Mesh3D* mesh);
+	void ReadResults();
+	void DrawBox(const DrawItem& item);
+
+	bool m_initialized = false;
+	bool m_enabled = true;
+	GLenum m_queryTarget = GL_ANY_SAMPLES_PASSED;
+	Shader* m_boxShader = nullptr;
+	GLuint m_boxArray = 0;
+	GLuint m_boxVertexBuffer = 0;
+	GLuint m_boxIndexBuffer = 0;
+
+	uint32_t m_frame = 0;
+	std::unordered_map<Mesh3D*, ObjectState> m_states;
+	Stats m_stats;
+
+	// Per frame
+	Frustum m_frustum;
+	std::vector<const DrawItem*> m_hidden;
+	std::vector<ObjectState*> m_hiddenStates;
+};
+
+#endif
@@ -0,0 +1,113 @@
+#ifndef PORTAL_SYSTEM_HPP
+#define PORTAL_SYSTEM_HPP
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Scene.hpp"
+
+// Cell and portal visibility for indoor levels. Cells are boxes (rooms,
+// corridors) joined by convex portal polygons (doorways, windows). Each
+// frame the camera frustum is narrowed through every portal it can see,
+// recursively from the camera's cell, and only objects inside the reached
+// cells and their narrowed frusta are gathered, so the cost follows the
+// visible cells rather than the level size.
+class PortalSystem {
+public:
+	static const int kMaxDepth = 16;	// portals crossed along one path
+	static const int kMaxViews = 256;	// narrowed frusta per frame
+
+	struct Stats {
+		uint32_t visibleCells = 0;
+		uint32_t views = 0;
+		uint32_t gathered = 0;
+	};
+
+	PortalSystem();
+
+	void SetEnabled(bool enabled) { m_enabled = enabled; }
+	bool IsEnabled() const { return m_enabled && !m_cells.empty(); }
+
+	int AddCell(const std::string& name, const glm::vec3& min, const glm::vec3& max);
+	// polygon is convex and planar, in world space, in either winding
+	int AddPortal(int cellA, int cellB, const std::vector<glm::vec3>& polygon);
+	// Drops cells, portals and objects
+	void Clear();
+
+	// Sorts the items' objects into cells. Static objects go to every cell
+	// their bounds touch, moving objects are located again each frame, and
+	// objects outside every cell are only frustum culled.
+	void AssignObjects(const std::vector<DrawItem>& items);
+	void ClearObjects();
+
+	int FindCell(const glm::vec3& point) const;
+	int GetCellCount() const { return static_cast<int>(m_cells.size()); }
+
+	// Walks the portals from the camera's cell. From outside every cell the
+	// whole level is treated as visible through the camera frustum.
+	void ComputeVisibility(const glm::mat4& viewProjection, const glm::vec3& eye);
+	bool IsCellVisible(int cell) const;
+	// Visible objects at the given interpolation, replacing items' contents
+	void GatherVisibleItems(float interpolation, std::vector<DrawItem>& items);
+
+	const Stats& GetStats() const { return m_stats; }
+
+private:
+	struct Cell {
+		std::string name;
+		glm::vec3 min;
+		glm::vec3 max;
+		std::vector<int> portals;
+		std::vector<int> objects;	// static objects, indices into m_objects
+		std::vector<int> views;		// this frame's frusta reaching the cell
+		uint32_t visibleFrame = 0;
+	};
+
+	struct Portal {
+		int cells[2];
+		std::vector<glm::vec3> polygon;
+		glm::vec4 plane;
+	};
+
+	// Inward facing planes m_planes[first, first + count)
+	struct View {
+		int first;
+		int count;
+	};
+
+	struct Object {
+		Mesh3D* mesh;
+		uint32_t gatheredFrame;
+	};
+
+	void Visit(int cell, int viewIndex, int fromPortal, int depth);
+	int AddView(const glm::vec4* planes, int count);
+	void MarkVisible(int cell);
+	DrawItem MakeItem(Mesh3D* mesh, float interpolation) const;
+	// True when the item's sphere is inside any of the views
+	bool InViews(const std::vector<int>& views, const DrawItem& item) const;
+
+	bool m_enabled = true;
+	std::vector<Cell> m_cells;
+	std::vector<Portal> m_portals;
+
+	std::vector<Object> m_objects;
+	std::vector<int> m_movingObjects;
+	std::vector<int> m_exteriorObjects;
+
+	// Per frame
+	uint32_t m_frame = 0;
+	glm::vec3 m_eye{ 0.0f };
+	glm::vec4 m_farPlane{ 0.0f };
+	std::vector<int> m_cameraViews;
+	std::vector<glm::vec4> m_planes;
+	std::vector<View> m_views;
+	std::vector<int> m_visibleCells;
+	std::vector<glm::vec3> m_clipped;
+	std::vector<glm::vec3> m_clipScratch;
+	std::vector<glm::vec4> m_portalPlanes;
+	Stats m_stats;
+};
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Scoped CPU timing markers recorded into per-thread ring buffers and
+// exported as Chrome trace JSON (chrome://tracing, ui.perfetto.dev).
+// Build with HORSE_PROFILER_ENABLED=0 to compile every marker out.
+#ifndef HORSE_PROFILER_ENABLED
+#define HORSE_PROFILER_ENABLED 1
+#endif
+
+struct ProfileEvent {
+	const char* name;	// must have static storage, e.g. a string literal
+	uint64_t start;		// ns since profiler epoch
+	uint64_t end;
+	uint32_t depth;
+};
+
+class Profiler {
+public:
+	static const uint32_t kEventsPerThread = 1 << 16;
+
+	// Events are only recorded while capturing
+	static void BeginCapture();
+	static void EndCapture();
+	static bool IsCapturing() { return s_capturing.load(std::memory_order_relaxed); }
+
+	static void SetThreadName(const std::string& name);
+
+	static uint64_t Now();
+	static void Record(const char* name, uint64_t start, uint64_t end, uint32_t depth);
+	static uint32_t& ThreadDepth();
+
+	// Writes every thread's buffered events. Call from a quiet point (no
+	// jobs running) so no buffer is written while being copied.
+	static bool WriteChromeTrace(const std::string& filepath);
+
+private:
+	static std::atomic<bool> s_capturing;
+};
+
+class ProfileScope {
+public:
+	explicit ProfileScope(const char* name) {
+		if (Profiler::IsCapturing()) {
+			m_name = name;
+			m_depth = Profiler::ThreadDepth()++;
+			m_start = Profiler::Now();
+		}
+	}
+
+	~ProfileScope() {
+		if (m_name) {
+			Profiler::Record(m_name, m_start, Profiler::Now(), m_depth);
+			Profiler::ThreadDepth()--;
+		}
+	}
+
+private:
+	const char* m_name = nullptr;
+	uint64_t m_start = 0;
+	uint32_t m_depth = 0;
+};
+
+#if HORSE_PROFILER_ENABLED
+#define HORSE_PROFILE_CONCAT_INNER(a, b) a##b
+#define HORSE_PROFILE_CONCAT(a, b) HORSE_PROFILE_CONCAT_INNER(a, b)
+#define HORSE_PROFILE_SCOPE(name) ProfileScope HORSE_PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define HORSE_PROFILE_FUNCTION() HORSE_PROFILE_SCOPE(__FUNCTION__)
+#define HORSE_PROFILE_THREAD(name) Profiler::SetThreadName(name)
+#else
+#define HORSE_PROFILE_SCOPE(name)
+#define HORSE_PROFILE_FUNCTION()
+#define HORSE_PROFILE_THREAD(name)
+#endif
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef RENDER_STATS_HPP
+#define RENDER_STATS_HPP
+
+#include <cstdint>
+
+// Per-frame renderer counters. Only touched from the GL thread.
+struct RenderStats {
+	uint64_t drawCalls = 0;
+	uint64_t triangles = 0;
+	uint64_t bufferUploads = 0;
+	uint64_t bufferUploadBytes = 0;
+	uint64_t textureUploads = 0;
+	uint64_t textureUploadBytes = 0;
+	uint64_t materialBinds = 0;
+	uint64_t textureBinds = 0;
+	uint64_t shaderBinds = 0;
+	uint64_t uniformUploads = 0;	// glUniform* calls, uniform buffers count as buffer uploads
+	uint64_t culledObjects = 0;		// rejected by portal, software or frustum culling
+
+	// Counters for the frame currently being rendered
+	static RenderStats& Current();
+	// Clears Current(), call at the start of every frame
+	static void Reset();
+
+	void CountDraw(uint64_t indexCount);
+	void CountBufferUpload(uint64_t bytes);
+	void CountTextureUpload(uint64_t bytes);
+	void CountMaterialBind();
+	void CountTextureBind();
+	void CountShaderBind();
+	void CountUniformUpload(uint64_t count = 1);
+	void CountCulled(uint64_t objects);
+
+	// Program, material and texture binds
+	uint64_t GetStateChanges() const { return shaderBinds + materialBinds + textureBinds; }
+};
+
+#endif
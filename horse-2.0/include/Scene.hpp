@@ -1,14 +1,38 @@
 #ifndef SCENE_H
 #define SCENE_H
 
+#include <cstdint>
 #include <iostream>
 #include <vector>
 #include <memory>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include "EntityRegistry.hpp"
 #include "MeshData.hpp"
 #include "Mesh3D.hpp"
 #include "Shader.hpp"
+#include "JobSystem.hpp"
+#include "Material.hpp"
+
+struct ModelRequest {
+	std::string name;
+	std::string filepath;
+	const ImportSettings* settings = nullptr;	// nullptr uses the scene's
+};
+
+// Object with its interpolated transform and bounds resolved for the
+// current frame, shared by passes that cull and draw the scene themselves
+struct DrawItem {
+	Mesh3D* mesh;
+	glm::mat4 model;
+	glm::vec3 center;	// world space bounding sphere
+	float radius;
+};
+
+class OcclusionCuller;
+class SoftwareOcclusion;
+class PortalSystem;
+class TextureStreamer;
 
 class Scene{
 public:
@@ -16,20 +40,82 @@ public:
 
 	Mesh3D* CreateObject(const std::string name, const MeshData& data);
 	Mesh3D* CreateModel(const std::string name, const std::string& filepath);
+	Mesh3D* CreateModel(const std::string name, const std::string& filepath, const ImportSettings& settings);
+	// Imports all models in parallel on the job system, then creates their GL
+	// resources on the calling thread. Results are in request order.
+	std::vector<Mesh3D*> CreateModels(const std::vector<ModelRequest>& requests);
 
 	Mesh3D* GetObject(const std::string name);
+	// Like GetObject() but quiet, for objects a scene need not have
+	Mesh3D* FindObject(const std::string& name);
+	std::vector<Mesh3D*> GetLightEmitters() const;
 	void PrepareDraw(int width, int height);
 	void DrawObjects(const glm::mat4& view, const glm::mat4& projection, Shader* shader);
 	void DrawLightSources(const glm::mat4& view, const glm::mat4& projection, Shader* lightShader);
+	// Depth only pass over the same objects as DrawObjects, using each
+	// mesh's position stream
+	void DrawDepth(const glm::mat4& view, const glm::mat4& projection, Shader* depthShader);
 	void UpdateAll();
+
+	// Every non-emitter object at the current interpolation
+	void GatherDrawItems(std::vector<DrawItem>& items) const;
+	// Changes whenever a static object is added, removed or moved
+	uint64_t GetStaticGeometryVersion() const;
+
+	// Fixed timestep support: snapshot transforms before each simulation
+	// tick and draw with the given blend factor between ticks
+	void StorePreviousTransforms();
+	void SetInterpolation(float alpha);
+	float GetInterpolation() const { return m_interpolation; }
 	void CleanUpAll();
 
+	// Post-processing of models created without their own settings,
+	// ImportSettings::Production() unless changed
+	void SetImportSettings(const ImportSettings& settings);
+	const ImportSettings& GetImportSettings() const { return m_importSettings; }
+
+	// Components of every object, for systems that iterate them directly
+	EntityRegistry& GetEntities() { return m_entities; }
+	const EntityRegistry& GetEntities() const { return m_entities; }
+
+	// Materials objects are drawn with, see Mesh3D::SetMaterial
+	MaterialLibrary& GetMaterials() { return m_materials; }
+
 	void SetShaderProgram(GLuint shader);
+	void SetJobSystem(JobSystem* jobSystem);
+	// DrawObjects culls through this when it is set and enabled
+	void SetOcclusionCuller(OcclusionCuller* culler);
+	// Objects hidden behind occluders on the CPU are skipped before the GPU
+	// culler sees them
+	void SetSoftwareOcclusion(SoftwareOcclusion* occlusion);
+	// Indoor levels: only objects in cells seen through portals are drawn.
+	// Objects are sorted into cells automatically as the scene changes.
+	void SetPortalSystem(PortalSystem* portals);
+	// Textures of the objects drawn are requested at their on-screen size
+	void SetTextureStreamer(TextureStreamer* streamer);
 private:
+	// Entity with a transform and a name, ready for a Mesh3D
+	Entity CreateEntity(const std::string& name);
+	Mesh3D* AddRenderable(Entity entity, std::unique_ptr<Mesh3D> mesh);
+	void RequestTextures(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& eye);
+	void SyncPortalObjects();
+	void ResolveMaterial(Mesh3D* obj);
+	void DrawObject(Mesh3D* obj);
+
 	std::string m_name;
-	std::vector<std::unique_ptr<Mesh3D>> m_objects;
-	std::vector<std::unique_ptr<Mesh3D>> m_lightSources;
+	EntityRegistry m_entities;
 	GLuint m_shaderProgram;
+	JobSystem* m_jobSystem = nullptr;
+	OcclusionCuller* m_occlusionCuller = nullptr;
+	SoftwareOcclusion* m_softwareOcclusion = nullptr;
+	PortalSystem* m_portalSystem = nullptr;
+	uint64_t m_portalStaticVersion = 0;
+	size_t m_portalObjectCount = SIZE_MAX;
+	TextureStreamer* m_textureStreamer = nullptr;
+	std::vector<DrawItem> m_drawItems;
+	MaterialLibrary m_materials;
+	ImportSettings m_importSettings = ImportSettings::Production();
+	float m_interpolation = 1.0f;
 };
 
 
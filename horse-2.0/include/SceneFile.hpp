@@ -0,0 +1,124 @@
+#ifndef SCENE_FILE_HPP
+#define SCENE_FILE_HPP
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "JobSystem.hpp"
+#include "Scene.hpp"
+#include "Texture.hpp"
+
+// Offset from the start of the blob on disk, a pointer once the blob is
+// loaded and relocated
+template <typename T>
+struct BlobPtr {
+	uint64_t value = 0;
+
+	T* Get() const { return reinterpret_cast<T*>(static_cast<uintptr_t>(value)); }
+	void Relocate(const char* base) { value = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(base + value)); }
+};
+
+// Files every object's model or texture refers to, loaded once each
+struct SceneAssetRecord {
+	enum Kind : uint32_t { Model, Texture };
+
+	BlobPtr<const char> path;
+	uint32_t kind;
+	uint32_t padding = 0;
+};
+
+struct SceneObjectRecord {
+	enum Shape : uint32_t { Cube, Pyramid, Wall, ModelShape };
+	enum Flags : uint32_t {
+		Static = 1 << 0,
+		Occluder = 1 << 1,
+		LightEmitter = 1 << 2,
+		HasColor = 1 << 3,		// models keep their material colors otherwise
+	};
+
+	BlobPtr<const char> name;
+	uint32_t shape;
+	uint32_t flags;
+	int32_t model;				// asset index, -1 for primitives
+	int32_t texture;			// asset index, -1 for none
+	float shapeSize[3];			// size of cubes and pyramids, length, width, height of walls
+	float position[3];
+	float rotationAngle;		// as passed to Mesh3D::SetRotation
+	float rotationAxis[3];
+	float scale[3];
+	float color[3];
+	float lightRadius;
+	float lightIntensity;
+};
+
+struct SceneFileHeader {
+	static const uint32_t kMagic = 0x4e435348;	// "HSCN"
+	static const uint32_t kVersion = 1;
+
+	uint32_t magic;
+	uint32_t version;
+	uint64_t size;				// whole blob in bytes
+	uint32_t objectCount;
+	uint32_t assetCount;
+	BlobPtr<SceneObjectRecord> objects;
+	BlobPtr<SceneAssetRecord> assets;
+};
+
+// Scene description authored as text and compiled into a relocatable
+// binary blob: a header, the object and asset tables and a string table,
+// with every reference stored as an offset. Loading is one read of the
+// file and one pass turning offsets into pointers. The asset table is the
+// manifest that lets every model import and texture decode start at once.
+//
+// Text format, one object per "object" line followed by its properties:
+//
+//   object <name> cube|pyramid [size]
+//   object <name> wall [length width height]
+//   object <name> model <path>
+//     position x y z
+//     rotation angle x y z
+//     scale x y z
+//     color r g b
+//     texture <path>
+//     light [radius intensity]
+//     static
+//     occluder
+//
+// Blank lines and lines starting with # are ignored.
+class SceneFile {
+public:
+	SceneFile();
+
+	// Text description to binary blob
+	static bool Compile(const std::string& textPath, const std::string& binaryPath);
+
+	// A compiled blob, or a text description compiled in memory
+	bool Load(const std::string& path);
+	// Creates the objects and returns them in file order. Model imports and
+	// texture decodes run in parallel on the job system, GL uploads on the
+	// calling thread. Models are added to the scene first, as one batch,
+	// then the primitives.
+	std::vector<Mesh3D*> Instantiate(Scene& scene, JobSystem* jobSystem);
+	// Textures created by Instantiate, after the scene's objects are gone
+	void CleanUp();
+
+	uint32_t GetObjectCount() const;
+	uint32_t GetAssetCount() const;
+	const SceneObjectRecord& GetObject(uint32_t index) const;
+	const SceneAssetRecord& GetAsset(uint32_t index) const;
+
+private:
+	static bool ParseText(const std::string& path, std::vector<uint64_t>& blob);
+	// Checks every offset and index before relocating, false for a blob
+	// that is truncated, from another version or corrupt
+	bool Relocate(uint64_t size);
+	static MeshData CreateShape(const SceneObjectRecord& object);
+
+	// uint64_t keeps the records 8 byte aligned
+	std::vector<uint64_t> m_blob;
+	SceneFileHeader* m_header = nullptr;
+	std::vector<std::unique_ptr<Texture>> m_textures;
+};
+
+#endif
@@ -21,7 +21,9 @@ public:
     void setBool(const std::string& name, bool value) const;
     void setInt(const std::string& name, int value) const;
     void setFloat(const std::string& name, float value) const;
+    void setUniformVec2(const std::string& name, const glm::vec2& value) const;
     void setUniformVec3(const std::string& name, const glm::vec3& value) const;
+    void setUniformIVec3(const std::string& name, const glm::ivec3& value) const;
     void setUniformMat4(const std::string& name, const glm::mat4x4& value) const;
 
     // Uniform getters
@@ -0,0 +1,122 @@
+#ifndef SHADOW_MAPS_HPP
+#define SHADOW_MAPS_HPP
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+#include "ClusteredLighting.hpp"
+#include "Frustum.hpp"
+#include "Scene.hpp"
+#include "Shader.hpp"
+
+struct DirectionalLight {
+	glm::vec3 direction;	// direction the light travels, world space
+	glm::vec3 color;
+	float intensity;
+};
+
+// Shadow maps for the first kMaxPointShadows point lights (cube maps) and
+// one directional light (cascades). Every shadow view keeps two depth
+// layers: a cache holding only static casters, re-rendered when the light
+// or static geometry changes, and the layer the shaders sample, which is
+// the cache with this frame's dynamic casters drawn on top. Views whose
+// static cache and dynamic casters are unchanged since last frame are left
+// untouched.
+class ShadowMaps {
+public:
+	static const int kMaxPointShadows = 4;
+	static const int kCubeSize = 512;
+	static const int kCascadeCount = 3;
+	static const int kCascadeSize = 1024;
+
+	// Texture units used by Bind(), after the lighting and G-buffer units
+	static const int kPointShadowUnit = 7;
+	static const int kCascadeShadowUnit = 8;
+
+	ShadowMaps();
+
+	void Initialize();
+	void CleanUp();
+
+	void SetEnabled(bool enabled) { m_enabled = enabled; }
+	bool IsEnabled() const { return m_enabled; }
+	void SetDirectionalLight(const DirectionalLight& light) { m_sun = light; }
+	const DirectionalLight& GetDirectionalLight() const { return m_sun; }
+	// Cascades cover the view from the near plane out to this distance
+	void SetShadowDistance(float distance) { m_shadowDistance = distance; }
+
+	// Brings every shadow view up to date. lights must be in the order given
+	// to ClusteredLighting, the first kMaxPointShadows of them cast shadows.
+	// Leaves framebuffer 0 bound.
+	void Update(const Scene& scene, const std::vector<PointLight>& lights, Shader* depthShader,
+		const glm::mat4& view, const glm::mat4& projection, float nearPlane, float farPlane);
+	// Binds the shadow maps and sets the shadow and sun uniforms on the
+	// active program
+	void Bind(Shader* shader);
+
+	// Shadow views (cube faces or cascades) rendered during the last Update
+	int GetStaticViewsRendered() const { return m_staticViewsRendered; }
+	int GetDynamicViewsRendered() const { return m_dynamicViewsRendered; }
+	size_t GetMemoryBytes() const;
+
+private:
+	struct ShadowView {
+		glm::mat4 viewProjection{ 1.0f };
+		uint64_t dynamicHash = 0;	// dynamic casters and transforms last drawn
+	};
+
+	struct PointShadow {
+		bool valid = false;
+		glm::vec3 position{ 0.0f };
+		float radius = 0.0f;
+		uint64_t staticVersion = 0;
+		ShadowView faces[6];
+	};
+
+	struct Cascade {
+		bool valid = false;
+		uint64_t staticVersion = 0;
+		float splitDepth = 0.0f;
+		ShadowView view;
+	};
+
+	GLuint CreateDepthArray(GLenum target, GLenum internalFormat, int size, int layers);
+	void UpdatePointShadow(int slot, const PointLight& light, uint64_t staticVersion);
+	void UpdateCascades(const glm::mat4& view, const glm::mat4& projection, float nearPlane, float farPlane, uint64_t staticVersion);
+	glm::mat4 FitCascade(const glm::vec3 corners[8]) const;
+	// Renders one view: optionally refreshes its static cache, then copies
+	// the cache into the sampled layer and adds the dynamic casters
+	void RenderView(ShadowView& view, bool refreshStatic, GLuint cacheTexture, GLuint texture, int layer, int size);
+	void DrawCasters(const std::vector<const DrawItem*>& casters);
+
+	bool m_initialized = false;
+	bool m_enabled = true;
+
+	DirectionalLight m_sun = { glm::vec3(-0.3f, -1.0f, -0.2f), glm::vec3(0.6f, 0.65f, 0.8f), 0.35f };
+	float m_shadowDistance = 40.0f;
+
+	PointShadow m_pointShadows[kMaxPointShadows];
+	int m_pointShadowCount = 0;
+	Cascade m_cascades[kCascadeCount];
+
+	// Per frame
+	Shader* m_depthShader = nullptr;
+	std::vector<DrawItem> m_items;
+	std::vector<const DrawItem*> m_staticCasters;
+	std::vector<const DrawItem*> m_dynamicCasters;
+	int m_staticViewsRendered = 0;
+	int m_dynamicViewsRendered = 0;
+
+	// Cube map arrays, layer = slot * 6 + face
+	GLuint m_pointCache = 0;
+	GLuint m_pointShadowMaps = 0;
+	// 2D arrays, layer = cascade
+	GLuint m_cascadeCache = 0;
+	GLuint m_cascadeShadowMaps = 0;
+
+	GLuint m_drawFramebuffer = 0;
+	GLuint m_readFramebuffer = 0;
+};
+
+#endif
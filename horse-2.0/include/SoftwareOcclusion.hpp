@@ -0,0 +1,90 @@
+#ifndef SOFTWARE_OCCLUSION_HPP
+#define SOFTWARE_OCCLUSION_HPP
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+#include "JobSystem.hpp"
+#include "Scene.hpp"
+
+// CPU occlusion culling against a low resolution depth buffer. Occluder
+// meshes (Mesh3D::SetOccluder) are rasterized in horizontal bands on the job
+// system, then each object's bounding box is tested against the buffer.
+// Neither step touches GL, so results are available the same frame and
+// the culler runs without a GPU.
+//
+// Depth is NDC z, which is affine in screen space for both perspective and
+// orthographic projections. Pixels are covered only when their center is
+// inside an occluder triangle and boxes test every pixel they touch, so an
+// object is never culled while any part of it could show.
+class SoftwareOcclusion {
+public:
+	static const int kWidth = 320;
+	static const int kHeight = 192;
+	static const int kBandHeight = 16;	// rows per rasterization job
+
+	struct Stats {
+		uint32_t occluders = 0;
+		uint32_t triangles = 0;		// occluder triangles set up this frame
+		uint32_t tested = 0;
+		uint32_t culled = 0;
+		bool rasterized = false;	// false when the last buffer was reused
+	};
+
+	SoftwareOcclusion();
+
+	void SetJobSystem(JobSystem* jobSystem) { m_jobSystem = jobSystem; }
+	void SetEnabled(bool enabled) { m_enabled = enabled; }
+	bool IsEnabled() const { return m_enabled; }
+	// AVX2 is picked at runtime, the scalar path gives the same results
+	static bool HasAvx2();
+	void SetUseSimd(bool useSimd) { m_useSimd = useSimd && HasAvx2(); }
+	bool IsUsingSimd() const { return m_useSimd; }
+
+	// Rasterizes the occluders among items. Skipped when the view and every
+	// occluder transform match the previous call.
+	void Update(const std::vector<DrawItem>& items, const glm::mat4& viewProjection);
+	// Removes the items hidden behind occluders, occluders are always kept
+	void Cull(std::vector<DrawItem>& items);
+	// Tests an object space box under model against the current buffer
+	bool IsOccluded(const glm::mat4& model, const glm::vec3& boundsMin, const glm::vec3& boundsMax) const;
+
+	// Rasterizes a fixed wall with the scalar and AVX2 paths and tests boxes
+	// around it. Needs no GL context, prints what failed.
+	static bool SelfCheck();
+
+	// kWidth * kHeight NDC depths, bottom row first, 1.0 where uncovered
+	const float* GetDepthBuffer() const { return m_depth.data(); }
+	const Stats& GetStats() const { return m_stats; }
+
+private:
+	// Set up in pixel space, x and y are sampled at pixel centers
+	struct ScreenTriangle {
+		float edgeA[3], edgeB[3], edgeC[3];	// inside where A * x + B * y + C >= 0
+		float depthA, depthB, depthC;		// NDC z = A * x + B * y + C
+		int minX, maxX, minY, maxY;			// inclusive pixel bounds
+	};
+
+	void SetupTriangles(const DrawItem& item);
+	// Triangles of indices into m_clip, offset by baseVertex
+	void AddTriangles(const GLuint* indices, size_t indexCount, GLint baseVertex);
+	void Rasterize();
+	void RasterizeBand(int band);
+	void RasterizeTriangleScalar(const ScreenTriangle& triangle, int y0, int y1, float* depth) const;
+	void RasterizeTriangleAvx2(const ScreenTriangle& triangle, int y0, int y1, float* depth) const;
+	bool IsRectOccludedScalar(int x0, int y0, int x1, int y1, float depth) const;
+	bool IsRectOccludedAvx2(int x0, int y0, int x1, int y1, float depth) const;
+
+	JobSystem* m_jobSystem = nullptr;
+	bool m_enabled = true;
+	bool m_useSimd = false;
+
+	glm::mat4 m_viewProjection{ 1.0f };
+	uint64_t m_hash = 0;
+	std::vector<ScreenTriangle> m_triangles;
+	std::vector<glm::vec4> m_clip;
+	std::vector<float> m_depth;
+	Stats m_stats;
+};
+
+#endif
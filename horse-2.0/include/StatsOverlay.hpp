@@ -0,0 +1,81 @@
+#ifndef STATS_OVERLAY_HPP
+#define STATS_OVERLAY_HPP
+
+#include <glad/glad.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "RenderStats.hpp"
+#include "Shader.hpp"
+
+// Renderer counters, GPU memory and frame times of the last kHistory
+// frames, drawn as text with a frame time graph in the top left corner. The
+// text comes from a built in 5x7 bitmap font and everything is one draw
+// call, so the overlay barely shows up in what it measures.
+class StatsOverlay {
+public:
+	static const int kHistory = 120;
+
+	struct FrameSample {
+		RenderStats counters;
+		double cpuMs = 0.0;
+		double gpuMs = 0.0;		// from GpuProfiler, a few frames behind
+		double frameMs = 0.0;	// wall clock since the previous EndFrame(), 0 for the first
+	};
+
+	StatsOverlay();
+
+	// shader is overlayVert.glsl / overlayFrag.glsl
+	void Initialize(Shader* shader);
+	void CleanUp();
+
+	// Records RenderStats::Current() with the frame's times. Call once per
+	// frame after the scene is drawn and before Draw(). The wall clock frame
+	// time, presenting and frame limiting included, is measured between calls.
+	void EndFrame(double cpuMs, double gpuMs);
+
+	void SetVisible(bool visible) { m_visible = visible; }
+	bool IsVisible() const { return m_visible; }
+
+	// Most recent frame, and the mean of the recorded ones
+	const FrameSample& GetLast() const;
+	FrameSample GetAverage() const;
+	// Worst CPU frame time in the history
+	double GetMaxCpuMs() const;
+	// The lines the overlay shows
+	std::vector<std::string> GetLines() const;
+
+	// Into the currently bound framebuffer, when visible
+	void Draw(int width, int height);
+
+private:
+	struct OverlayVertex {
+		float x, y;
+		float u, v;
+		float r, g, b, a;
+	};
+
+	// Glyphs are kCellWidth x kCellHeight texels, scaled by kScale
+	static const int kCellWidth = 6;
+	static const int kCellHeight = 8;
+	static const int kScale = 2;
+
+	void CreateFontTexture();
+	void AddQuad(float x, float y, float width, float height, int glyph, const float color[4]);
+	void AddText(float x, float y, const std::string& text, const float color[4]);
+
+	Shader* m_shader = nullptr;
+	GLuint m_fontTexture = 0;
+	GLuint m_vertexArray = 0;
+	GLuint m_vertexBuffer = 0;
+	size_t m_bufferCapacity = 0;
+	std::vector<OverlayVertex> m_vertices;
+
+	std::vector<FrameSample> m_history;
+	int m_next = 0;		// ring position of the next sample
+	std::chrono::steady_clock::time_point m_lastEndFrame;
+	bool m_hasLastEndFrame = false;
+	bool m_visible = false;
+};
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef STRESS_SCENE_HPP
+#define STRESS_SCENE_HPP
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "PortalSystem.hpp"
+#include "Scene.hpp"
+#include "Texture.hpp"
+
+struct StressSceneConfig {
+	uint32_t seed = 1;
+	int cubes = 1000;
+	int pyramids = 0;
+	int models = 0;				// instances, cycling through modelPaths
+	int textures = 0;			// distinct GL textures spread over the primitives
+	int lights = 4;
+	int walls = 0;				// large static occluders
+	int rooms = 0;				// rooms per side of an indoor grid joined by doorways
+	float movingFraction = 0.1f;	// share of objects animated every tick
+	float extent = 40.0f;		// objects are placed in [-extent, extent] on x and z
+
+	std::vector<std::string> modelPaths = {
+		"./assets/models/tamagotchi/Kitten/Kitten_01.obj",
+		"./assets/models/tamagotchi/Frog/Frog_01.obj",
+	};
+	std::vector<std::string> texturePaths = {
+		"./assets/textures/container.jpg",
+		"./assets/textures/kaden.jpg",
+	};
+};
+
+// Seeded generator for large reproducible scenes. The same seed and config
+// always produce the same layout, so frame times can be compared across
+// runs and charted against object count.
+class StressScene {
+public:
+	StressScene();
+
+	// Rooms become cells and doorways portals of portals, when given
+	void Generate(Scene& scene, const StressSceneConfig& config, PortalSystem* portals = nullptr);
+	// Moves the animated objects, call from the simulation tick
+	void Update(float time);
+	void CleanUp();
+
+	size_t GetObjectCount() const { return m_objectCount; }
+	size_t GetMovingCount() const { return m_movers.size(); }
+
+private:
+	struct Mover {
+		Mesh3D* mesh;
+		glm::vec3 origin;
+		float radius;
+		float speed;
+		float phase;
+	};
+
+	void GenerateRooms(Scene& scene, const StressSceneConfig& config, PortalSystem* portals);
+
+	// Portable generator so layouts match across standard libraries
+	float Random();
+	float Random(float min, float max);
+	glm::vec3 RandomColor();
+
+	uint32_t m_state = 1;
+	size_t m_objectCount = 0;
+	std::vector<Mover> m_movers;
+	std::vector<std::unique_ptr<Texture>> m_textures;
+};
+
+#endif
@@ -6,19 +6,53 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+class TextureArray;
+class TextureArrayPool;
+class TextureStreamer;
+
 class Texture {
 public:
 	Texture();
 	
 	bool LoadTexture(const std::string& filepath);
+
+	// Split loading: decoding touches no GL state and may run on a worker
+	// thread, Upload() must run on the thread owning the GL context.
+	bool LoadImageData(const std::string& filepath);
+	bool Upload();
+	bool HasPendingUpload() const { return m_pixels != nullptr; }
+
+	// Uploads pixels kept by the caller, replacing any previous contents.
+	// maxLevel caps the mip chain, -1 for the full chain.
+	void UploadPixels(int width, int height, int channels, const unsigned char* pixels, int maxLevel = -1);
+
+	// Pool that textures uploaded from now on are packed into, nullptr keeps
+	// them standalone GL_TEXTURE_2D objects
+	static void SetArrayPool(TextureArrayPool* pool);
+	// Streamer that large textures uploaded from now on start in with only
+	// their mip tail resident, it takes precedence over the array pool
+	static void SetStreamer(TextureStreamer* streamer);
+
+	// Set when the texture lives in a layer of a texture array, Bind() then
+	// does nothing and the array is bound instead
+	TextureArray* GetArray() const { return m_array; }
+	int GetLayer() const { return m_layer; }
+	GLuint GetID() const { return m_textureID; }
+
 	void Bind(GLuint textureUnit = 0);
 	void Unbind();
 	void CleanUp();
 
 private:
+	friend class TextureStreamer;
+
 	GLuint m_textureID = 0;
 	int m_width, m_height, m_channels;
 	std::string m_filepath;
+	unsigned char* m_pixels = nullptr;
+	TextureArray* m_array = nullptr;
+	int m_layer = -1;
+	TextureStreamer* m_streamer = nullptr;
 };
 
 
@@ -0,0 +1,72 @@
+#ifndef TEXTURE_ARRAY_HPP
+#define TEXTURE_ARRAY_HPP
+
+#include <glad/glad.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+// One GL_TEXTURE_2D_ARRAY of equally sized layers sharing a pixel format.
+// Textures packed into the same array are told apart by their layer, so
+// draws switching between them keep the same texture bound. The array
+// starts with room for one layer and doubles up to maxCapacity as layers
+// are added, so a size only one texture has costs no more than on its own.
+class TextureArray {
+public:
+	TextureArray(int width, int height, int channels, int maxCapacity);
+	~TextureArray();
+
+	// Copies the tightly packed pixels into a free layer, growing the array
+	// when needed, -1 when full
+	int AddLayer(const unsigned char* pixels);
+	void ReleaseLayer(int layer);
+
+	// Regenerates mipmaps first when layers were added since the last bind
+	void Bind(GLuint textureUnit);
+
+	bool Matches(int width, int height, int channels) const;
+	bool IsFull() const { return m_freeLayers.empty() && m_layerCount == m_maxCapacity; }
+	GLuint GetID() const { return m_textureID; }
+	int GetLayerCount() const { return m_layerCount - static_cast<int>(m_freeLayers.size()); }
+
+private:
+	void Allocate(int capacity);
+	// Moves the layers into a larger texture. The texture name changes,
+	// binders compare arrays by pointer and rebind every frame.
+	bool Grow(int capacity);
+	// Layers in use against the whole array, for GpuMemory
+	void ReportUsage() const;
+
+	GLuint m_textureID = 0;
+	int m_width;
+	int m_height;
+	int m_channels;
+	int m_capacity = 0;				// layers allocated
+	int m_maxCapacity;
+	int m_layerCount = 0;			// layers ever handed out
+	std::vector<int> m_freeLayers;	// released layers below m_layerCount
+	bool m_mipsDirty = false;
+	std::string m_poolName;
+};
+
+// Arrays for every size and format in use. A texture goes into the first
+// array matching it with room left, a new array is made when none has.
+class TextureArrayPool {
+public:
+	static const int kLayersPerArray = 16;
+
+	TextureArrayPool();
+
+	// Returns the array the pixels were placed in and its layer, or nullptr
+	// when no array took them and the texture should stay standalone
+	TextureArray* Add(int width, int height, int channels, const unsigned char* pixels, int& layer);
+	void CleanUp();
+
+	size_t GetArrayCount() const { return m_arrays.size(); }
+
+private:
+	std::vector<std::unique_ptr<TextureArray>> m_arrays;
+	int m_maxLayers = 0;
+};
+
+#endif
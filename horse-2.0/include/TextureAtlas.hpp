@@ -0,0 +1,75 @@
+#ifndef TEXTURE_ATLAS_HPP
+#define TEXTURE_ATLAS_HPP
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+#include "Texture.hpp"
+
+// Where a packed image ended up. Image UVs in [0, 1] map to
+// offset + uv * scale on the page.
+struct AtlasRegion {
+	Texture* page = nullptr;
+	glm::vec2 offset{ 0.0f };
+	glm::vec2 scale{ 1.0f };
+};
+
+// Packs small model textures into shared RGBA pages with a skyline packer,
+// so models using different small textures draw with one texture bound.
+// Every image is surrounded by a gutter of repeated edge texels and placed
+// on a grid matching the mip chain, so filtering never reads a neighbour
+// at any of the page's mip levels.
+class TextureAtlas {
+public:
+	static const int kPageSize = 2048;
+	static const int kMaxImageSize = 512;	// larger images stay standalone textures
+	static const int kMipLevels = 4;
+	static const int kGutter = 1 << (kMipLevels - 1);	// one texel at the last level
+
+	TextureAtlas();
+
+	// Decodes and packs the image, once per path. CPU only and safe to call
+	// from worker threads. False when the image is too large or fails to
+	// load, the caller then loads it as a standalone texture.
+	bool Add(const std::string& filepath, AtlasRegion& region);
+	// Uploads pages changed since the last call, on the GL thread
+	void Upload();
+	void CleanUp();
+
+	size_t GetPageCount() const;
+	size_t GetImageCount() const;
+
+private:
+	struct SkylineNode {
+		int x;
+		int y;
+		int width;
+	};
+
+	struct Page {
+		std::vector<unsigned char> pixels;
+		std::vector<SkylineNode> skyline;
+		std::unique_ptr<Texture> texture;
+		bool dirty = false;
+	};
+
+	Page* CreatePage();
+	// Lowest position along the skyline fitting width x height, false when
+	// the page has no room
+	bool FindPosition(const Page& page, int width, int height, int& nodeIndex, int& x, int& y) const;
+	void PlaceRect(Page& page, int nodeIndex, int x, int y, int width, int height);
+	void CopyWithGutter(Page& page, int x, int y, const unsigned char* pixels, int width, int height);
+
+	mutable std::mutex m_mutex;
+	std::vector<std::unique_ptr<Page>> m_pages;
+	std::map<std::string, AtlasRegion> m_regions;
+	std::set<std::string> m_rejected;
+	uint64_t m_imageTexels = 0;		// texels of packed images, without gutters
+};
+
+#endif
@@ -0,0 +1,100 @@
+#ifndef TEXTURE_STREAMER_HPP
+#define TEXTURE_STREAMER_HPP
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "JobSystem.hpp"
+#include "Texture.hpp"
+
+// Mip streaming for large textures. A registered texture starts with only
+// its small mip tail resident; finer levels are decoded from disk on the
+// job system once meshes using the texture cover enough of the screen to
+// need them. Resident levels are kept under a byte budget, evicting the
+// finest levels of the least recently used textures first.
+class TextureStreamer {
+public:
+	static const int kMinStreamedSize = 1024;	// smaller textures load whole
+	static const int kTailSize = 64;			// levels this size and smaller never leave
+	static const int kMaxLoadsInFlight = 4;
+	static const uint64_t kMaxUploadBytesPerFrame = 16ull << 20;
+
+	struct Stats {
+		uint32_t textures = 0;
+		uint32_t loadsInFlight = 0;
+		uint32_t levelsStreamed = 0;	// this frame
+		uint32_t levelsEvicted = 0;		// this frame
+		uint64_t residentBytes = 0;
+		uint64_t uploadedBytes = 0;		// this frame
+	};
+
+	TextureStreamer();
+
+	void SetJobSystem(JobSystem* jobSystem) { m_jobSystem = jobSystem; }
+	void SetBudget(uint64_t bytes) { m_budget = bytes; }
+	uint64_t GetBudget() const { return m_budget; }
+
+	// Takes over a texture with decoded pixels pending upload, uploading
+	// only its mip tail. False when the texture is too small to stream.
+	bool Register(Texture* texture);
+	// Waits for a pending load, the texture's levels stay as they are
+	void Remove(Texture* texture);
+
+	// A mesh drawn with the texture covers screenFraction of the viewport
+	// height this frame
+	void Request(const Texture* texture, float screenFraction);
+	// Once per frame on the GL thread: uploads finished loads, evicts over
+	// budget, and starts loads for the last frame's requests
+	void Update(int viewportHeight);
+	// Evicts levels until bytes are freed or only mip tails are left, and
+	// lowers the budget so they are not streamed back in. Returns the bytes
+	// freed, for GpuMemory's pressure callbacks.
+	uint64_t Trim(uint64_t bytes);
+	void CleanUp();
+
+	const Stats& GetStats() const { return m_stats; }
+
+private:
+	struct Entry {
+		Texture* texture;
+		std::string filepath;
+		int width;
+		int height;
+		int channels;
+		int levelCount;
+		int tailLevel;				// first level of the permanent tail
+		int residentLevel;			// finest resident level, GL_TEXTURE_BASE_LEVEL
+		int wantedLevel;			// finest level the last frame's requests need
+		float requestedFraction = 0.0f;
+		bool failed = false;		// the file could not be read again
+		uint64_t lastUsedFrame = 0;
+
+		// Load in flight, levels [loadLevel, residentLevel) once counter is zero
+		bool loading = false;
+		int loadLevel = 0;
+		JobCounter counter;
+		std::vector<std::vector<unsigned char>> loadedLevels;
+	};
+
+	uint64_t LevelBytes(const Entry& entry, int level) const;
+	// Levels generated by box filtering from level 0 down to lastLevel
+	static void BuildMips(const unsigned char* pixels, int width, int height, int channels, int lastLevel,
+		std::vector<std::vector<unsigned char>>& levels);
+	void UploadLevel(Entry& entry, int level, const unsigned char* pixels);
+	void SetBaseLevel(Entry& entry, int level);
+	bool EvictLevel(bool neededToo);
+	void StartLoad(Entry& entry, int level);
+
+	JobSystem* m_jobSystem = nullptr;
+	uint64_t m_budget = 256ull << 20;
+	uint64_t m_frame = 0;
+	uint64_t m_pendingBytes = 0;	// levels of loads in flight
+	std::vector<std::unique_ptr<Entry>> m_entries;
+	std::unordered_map<const Texture*, Entry*> m_lookup;
+	Stats m_stats;
+};
+
+#endif
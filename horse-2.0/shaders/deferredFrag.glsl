@@ -0,0 +1,138 @@
+#version 410 core
+out vec4 color;
+
+// G-buffer, see DeferredRenderer
+uniform sampler2D u_gAlbedo;
+uniform sampler2D u_gNormal;
+uniform sampler2D u_gDepth;
+
+uniform mat4 u_ViewMatrix;
+uniform mat4 u_InverseViewProjection;
+uniform vec3 u_viewPos;
+uniform vec3 u_ambientColor;
+
+// Clustered lights, see ClusteredLighting
+uniform samplerBuffer u_lightData;      // per light: position + radius, color + intensity
+uniform usamplerBuffer u_clusterData;   // per cluster: offset, count into u_lightIndices
+uniform usamplerBuffer u_lightIndices;
+uniform ivec3 u_clusterCount;
+uniform vec2 u_viewportSize;
+uniform float u_clusterNear;
+uniform float u_clusterLogScale;        // slices / log(far / near)
+
+// Shadows and the sun, see ShadowMaps
+uniform bool u_shadowsEnabled;
+uniform samplerCubeArrayShadow u_pointShadows;  // layer = light index
+uniform int u_shadowedLightCount;                // lights [0, count) have a cube map
+uniform sampler2DArrayShadow u_cascadeShadows;
+uniform mat4 u_cascadeMatrices[3];
+uniform vec3 u_cascadeSplits;                    // far view depth of each cascade
+uniform vec3 u_sunDirection;
+uniform vec3 u_sunColor;                         // color * intensity, zero when off
+
+// 1 = lit, 0 = shadowed. The maps hold distance / radius.
+float pointShadow(int light, vec3 fragPos, vec3 norm, vec4 positionRadius) {
+    vec3 toFrag = fragPos + norm * 0.02f - positionRadius.xyz;
+    float depth = length(toFrag) / positionRadius.w - 0.002f;
+    return texture(u_pointShadows, vec4(toFrag, float(light)), depth);
+}
+
+float sunShadow(vec3 fragPos, vec3 norm, float viewDepth) {
+    if (viewDepth > u_cascadeSplits.z) {
+        return 1.0f;
+    }
+    int cascade = viewDepth > u_cascadeSplits.x ? (viewDepth > u_cascadeSplits.y ? 2 : 1) : 0;
+
+    // Normal offset grows with the cascade's texel size
+    vec4 shadowPos = u_cascadeMatrices[cascade] * vec4(fragPos + norm * (0.03f * float(cascade + 1)), 1.0f);
+    vec3 coords = shadowPos.xyz / shadowPos.w * 0.5f + 0.5f;
+    return texture(u_cascadeShadows, vec4(coords.xy, float(cascade), coords.z - 0.0005f));
+}
+
+vec3 decodeNormal(vec2 e) {
+    e = e * 2.0f - 1.0f;
+    vec3 n = vec3(e, 1.0f - abs(e.x) - abs(e.y));
+    if (n.z < 0.0f) {
+        n.xy = (1.0f - abs(n.yx)) * vec2(n.x >= 0.0f ? 1.0f : -1.0f, n.y >= 0.0f ? 1.0f : -1.0f);
+    }
+    return normalize(n);
+}
+
+int clusterIndex(float viewDepth) {
+    ivec2 tile = ivec2(gl_FragCoord.xy / u_viewportSize * vec2(u_clusterCount.xy));
+    tile = clamp(tile, ivec2(0), u_clusterCount.xy - 1);
+
+    int slice = int(log(max(viewDepth, u_clusterNear) / u_clusterNear) * u_clusterLogScale);
+    slice = clamp(slice, 0, u_clusterCount.z - 1);
+
+    return tile.x + u_clusterCount.x * (tile.y + u_clusterCount.y * slice);
+}
+
+void main() {
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    float depth = texelFetch(u_gDepth, pixel, 0).r;
+    if (depth >= 1.0f) {
+        // Nothing was drawn here, keep the clear color
+        discard;
+    }
+
+    vec4 albedoSpecular = texelFetch(u_gAlbedo, pixel, 0);
+    vec3 norm = decodeNormal(texelFetch(u_gNormal, pixel, 0).rg);
+
+    // World position from the depth buffer
+    vec4 ndc = vec4(gl_FragCoord.xy / u_viewportSize * 2.0f - 1.0f, depth * 2.0f - 1.0f, 1.0f);
+    vec4 world = u_InverseViewProjection * ndc;
+    vec3 fragPos = world.xyz / world.w;
+    float viewDepth = -(u_ViewMatrix * vec4(fragPos, 1.0f)).z;
+
+    vec3 viewDir = normalize(u_viewPos - fragPos);
+
+    // Ambient
+    vec3 lighting = u_ambientColor;
+
+    // Sun
+    float sunDiff = max(dot(norm, -u_sunDirection), 0.0f);
+    if (sunDiff > 0.0f) {
+        float shadow = u_shadowsEnabled ? sunShadow(fragPos, norm, viewDepth) : 1.0f;
+        vec3 sunReflect = reflect(u_sunDirection, norm);
+        float sunSpec = pow(max(dot(viewDir, sunReflect), 0.0f), 32);
+        lighting += shadow * (sunDiff + albedoSpecular.a * sunSpec) * u_sunColor;
+    }
+
+    uvec2 cluster = texelFetch(u_clusterData, clusterIndex(viewDepth)).xy;
+    for (uint i = 0u; i < cluster.y; i++) {
+        int light = int(texelFetch(u_lightIndices, int(cluster.x + i)).r);
+        vec4 positionRadius = texelFetch(u_lightData, light * 2);
+        vec4 colorIntensity = texelFetch(u_lightData, light * 2 + 1);
+
+        vec3 toLight = positionRadius.xyz - fragPos;
+        float distance = length(toLight);
+        if (distance >= positionRadius.w) {
+            continue;
+        }
+
+        // Same falloff and shading model as frag.glsl
+        float falloff = distance / positionRadius.w;
+        float attenuation = clamp(1.0f - falloff * falloff * falloff * falloff, 0.0f, 1.0f);
+        attenuation *= attenuation;
+        if (light < u_shadowedLightCount) {
+            attenuation *= pointShadow(light, fragPos, norm, positionRadius);
+        }
+        vec3 lightColor = colorIntensity.rgb * colorIntensity.a * attenuation;
+
+        // Diffuse
+        vec3 lightDir = toLight / distance;
+        float diff = max(dot(norm, lightDir), 0.0f);
+        vec3 diffuse = diff * lightColor;
+
+        // Specular
+        vec3 reflectDir = reflect(-lightDir, norm);
+        float spec = pow(max(dot(viewDir, reflectDir), 0.0f), 32);
+        vec3 specular = albedoSpecular.a * spec * lightColor;
+
+        lighting += diffuse + specular;
+    }
+
+    color = vec4(lighting * albedoSpecular.rgb, 1.0);
+    gl_FragDepth = depth;
+}
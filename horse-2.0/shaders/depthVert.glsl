@@ -0,0 +1,13 @@
+#version 410 core
+layout(location=0) in vec3 position;
+
+// Same transform as vert.glsl so the color pass can test with GL_EQUAL
+invariant gl_Position;
+
+uniform mat4 u_ModelMatrix;
+uniform mat4 u_ViewMatrix;
+uniform mat4 u_Projection;
+
+void main() {
+    gl_Position = u_Projection * u_ViewMatrix * u_ModelMatrix * vec4(position, 1.0f);
+}
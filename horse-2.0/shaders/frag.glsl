@@ -5,44 +5,129 @@ in vec3 v_vertexColors;
 in vec2 v_texCoords;
 in vec3 v_fragPos;
 in vec3 v_normal;
+in float v_viewDepth;
 
 uniform sampler2D textureSampler;
-uniform vec3 u_lightPos;
-uniform vec3 u_lightColor;
-uniform vec3 u_objectColor;
+uniform sampler2DArray u_textureArray;
 uniform vec3 u_viewPos;
+uniform vec3 u_ambientColor;
 
-uniform bool u_useTexture;
+// Per material, see MaterialLibrary
+layout(std140) uniform MaterialBlock {
+    vec4 u_baseColor;       // rgb color
+    vec4 u_materialParams;  // x specular strength, y shininess, z 0 none, 1 textureSampler, 2 u_textureArray, w layer
+};
+
+// Clustered lights, see ClusteredLighting
+uniform samplerBuffer u_lightData;      // per light: position + radius, color + intensity
+uniform usamplerBuffer u_clusterData;   // per cluster: offset, count into u_lightIndices
+uniform usamplerBuffer u_lightIndices;
+uniform ivec3 u_clusterCount;
+uniform vec2 u_viewportSize;
+uniform float u_clusterNear;
+uniform float u_clusterLogScale;        // slices / log(far / near)
+
+// Shadows and the sun, see ShadowMaps
+uniform bool u_shadowsEnabled;
+uniform samplerCubeArrayShadow u_pointShadows;  // layer = light index
+uniform int u_shadowedLightCount;                // lights [0, count) have a cube map
+uniform sampler2DArrayShadow u_cascadeShadows;
+uniform mat4 u_cascadeMatrices[3];
+uniform vec3 u_cascadeSplits;                    // far view depth of each cascade
+uniform vec3 u_sunDirection;
+uniform vec3 u_sunColor;                         // color * intensity, zero when off
+
+// 1 = lit, 0 = shadowed. The maps hold distance / radius.
+float pointShadow(int light, vec3 fragPos, vec3 norm, vec4 positionRadius) {
+    vec3 toFrag = fragPos + norm * 0.02f - positionRadius.xyz;
+    float depth = length(toFrag) / positionRadius.w - 0.002f;
+    return texture(u_pointShadows, vec4(toFrag, float(light)), depth);
+}
+
+float sunShadow(vec3 fragPos, vec3 norm, float viewDepth) {
+    if (viewDepth > u_cascadeSplits.z) {
+        return 1.0f;
+    }
+    int cascade = viewDepth > u_cascadeSplits.x ? (viewDepth > u_cascadeSplits.y ? 2 : 1) : 0;
+
+    // Normal offset grows with the cascade's texel size
+    vec4 shadowPos = u_cascadeMatrices[cascade] * vec4(fragPos + norm * (0.03f * float(cascade + 1)), 1.0f);
+    vec3 coords = shadowPos.xyz / shadowPos.w * 0.5f + 0.5f;
+    return texture(u_cascadeShadows, vec4(coords.xy, float(cascade), coords.z - 0.0005f));
+}
+
+int clusterIndex() {
+    ivec2 tile = ivec2(gl_FragCoord.xy / u_viewportSize * vec2(u_clusterCount.xy));
+    tile = clamp(tile, ivec2(0), u_clusterCount.xy - 1);
+
+    int slice = int(log(max(v_viewDepth, u_clusterNear) / u_clusterNear) * u_clusterLogScale);
+    slice = clamp(slice, 0, u_clusterCount.z - 1);
+
+    return tile.x + u_clusterCount.x * (tile.y + u_clusterCount.y * slice);
+}
 
 void main() {
-    // Ambient
-    float ambientStrength = 0.1f;
-    vec3 ambient = ambientStrength * u_lightColor;
-    
-    // Diffuse
     vec3 norm = normalize(v_normal);
-    vec3 lightDir = normalize(u_lightPos - v_fragPos);
-    float diff = max(dot(norm, lightDir), 0.2f);
-    vec3 diffuse = diff * u_lightColor;
-    
-    // Specular
-    float specularStrength = 1.0f;
     vec3 viewDir = normalize(u_viewPos - v_fragPos);
-    vec3 reflectDir = reflect(-lightDir, norm);
-    float spec = pow(max(dot(viewDir, reflectDir), 0.0f), 32);
-    vec3 specular = specularStrength * spec * u_lightColor;
-    
+
+    // Ambient
+    vec3 lighting = u_ambientColor;
+
+    // Sun
+    float sunDiff = max(dot(norm, -u_sunDirection), 0.0f);
+    if (sunDiff > 0.0f) {
+        float shadow = u_shadowsEnabled ? sunShadow(v_fragPos, norm, v_viewDepth) : 1.0f;
+        vec3 sunReflect = reflect(u_sunDirection, norm);
+        float sunSpec = pow(max(dot(viewDir, sunReflect), 0.0f), u_materialParams.y);
+        lighting += shadow * (sunDiff + u_materialParams.x * sunSpec) * u_sunColor;
+    }
+
+    uvec2 cluster = texelFetch(u_clusterData, clusterIndex()).xy;
+    for (uint i = 0u; i < cluster.y; i++) {
+        int light = int(texelFetch(u_lightIndices, int(cluster.x + i)).r);
+        vec4 positionRadius = texelFetch(u_lightData, light * 2);
+        vec4 colorIntensity = texelFetch(u_lightData, light * 2 + 1);
+
+        vec3 toLight = positionRadius.xyz - v_fragPos;
+        float distance = length(toLight);
+        if (distance >= positionRadius.w) {
+            continue;
+        }
+
+        // Smooth window so the light fades out exactly at its radius
+        float falloff = distance / positionRadius.w;
+        float attenuation = clamp(1.0f - falloff * falloff * falloff * falloff, 0.0f, 1.0f);
+        attenuation *= attenuation;
+        if (light < u_shadowedLightCount) {
+            attenuation *= pointShadow(light, v_fragPos, norm, positionRadius);
+        }
+        vec3 lightColor = colorIntensity.rgb * colorIntensity.a * attenuation;
+
+        // Diffuse
+        vec3 lightDir = toLight / distance;
+        float diff = max(dot(norm, lightDir), 0.0f);
+        vec3 diffuse = diff * lightColor;
+
+        // Specular
+        float specularStrength = u_materialParams.x;
+        vec3 reflectDir = reflect(-lightDir, norm);
+        float spec = pow(max(dot(viewDir, reflectDir), 0.0f), u_materialParams.y);
+        vec3 specular = specularStrength * spec * lightColor;
+
+        lighting += diffuse + specular;
+    }
+
     // Combine
-    vec3 result = (ambient + diffuse + specular) * u_objectColor;
-    
-    
+    vec3 result = lighting * u_baseColor.rgb;
+
     // Texture blending
-    if (u_useTexture) {
+    if (u_materialParams.z > 1.5f) {
+        vec4 texColor = texture(u_textureArray, vec3(v_texCoords, u_materialParams.w));
+        color = vec4(result * texColor.rgb, 1.0);
+    } else if (u_materialParams.z > 0.5f) {
         vec4 texColor = texture(textureSampler, v_texCoords);
         color = vec4(result * texColor.rgb, 1.0);
     } else {
         color = vec4(result, 1.0);
     }
-
-    //color = texture(textureSampler, v_texCoords);
-}
\ No newline at end of file
+}
@@ -0,0 +1,41 @@
+#version 410 core
+layout(location=0) out vec4 g_albedo;    // rgb albedo, a specular strength
+layout(location=1) out vec2 g_normal;    // octahedral normal in [0, 1]
+
+in vec3 v_vertexColors;
+in vec2 v_texCoords;
+in vec3 v_fragPos;
+in vec3 v_normal;
+in float v_viewDepth;
+
+uniform sampler2D textureSampler;
+uniform sampler2DArray u_textureArray;
+
+// Per material, see MaterialLibrary. Shininess is not stored, the lighting
+// pass uses the default exponent.
+layout(std140) uniform MaterialBlock {
+    vec4 u_baseColor;
+    vec4 u_materialParams;  // x specular strength, y shininess, z 0 none, 1 textureSampler, 2 u_textureArray, w layer
+};
+
+// Folds the unit sphere onto an octahedron and unfolds it into a square
+vec2 encodeNormal(vec3 n) {
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    vec2 e = n.xy;
+    if (n.z < 0.0f) {
+        e = (1.0f - abs(n.yx)) * vec2(n.x >= 0.0f ? 1.0f : -1.0f, n.y >= 0.0f ? 1.0f : -1.0f);
+    }
+    return e * 0.5f + 0.5f;
+}
+
+void main() {
+    vec3 albedo = u_baseColor.rgb;
+    if (u_materialParams.z > 1.5f) {
+        albedo *= texture(u_textureArray, vec3(v_texCoords, u_materialParams.w)).rgb;
+    } else if (u_materialParams.z > 0.5f) {
+        albedo *= texture(textureSampler, v_texCoords).rgb;
+    }
+
+    g_albedo = vec4(albedo, u_materialParams.x);
+    g_normal = encodeNormal(normalize(v_normal));
+}
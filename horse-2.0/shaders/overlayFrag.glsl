@@ -0,0 +1,12 @@
+#version 410 core
+in vec2 v_texCoord;
+in vec4 v_color;
+
+// Glyph coverage in the red channel
+uniform sampler2D u_Font;
+
+out vec4 color;
+
+void main() {
+    color = vec4(v_color.rgb, v_color.a * texture(u_Font, v_texCoord).r);
+}
@@ -0,0 +1,16 @@
+#version 410 core
+layout(location=0) in vec2 position;	// pixels from the top left corner
+layout(location=1) in vec2 texCoord;
+layout(location=2) in vec4 color;
+
+uniform vec2 u_ScreenSize;
+
+out vec2 v_texCoord;
+out vec4 v_color;
+
+void main() {
+    vec2 ndc = position / u_ScreenSize * 2.0 - 1.0;
+    gl_Position = vec4(ndc.x, -ndc.y, 0.0, 1.0);
+    v_texCoord = texCoord;
+    v_color = color;
+}
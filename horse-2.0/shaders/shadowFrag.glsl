@@ -0,0 +1,18 @@
+#version 410 core
+
+in vec3 v_fragPos;
+
+// Point lights store distance / radius so any direction can be compared,
+// the sun keeps regular depth
+uniform bool u_linearDepth;
+uniform vec3 u_lightPos;
+uniform float u_lightRadius;
+
+void main() {
+    if (u_linearDepth) {
+        gl_FragDepth = length(v_fragPos - u_lightPos) / u_lightRadius;
+    }
+    else {
+        gl_FragDepth = gl_FragCoord.z;
+    }
+}
@@ -0,0 +1,13 @@
+#version 410 core
+layout(location=0) in vec3 position;
+
+out vec3 v_fragPos;
+
+uniform mat4 u_ModelMatrix;
+uniform mat4 u_LightViewProjection;
+
+void main() {
+    vec4 worldPosition = u_ModelMatrix * vec4(position, 1.0f);
+    v_fragPos = worldPosition.xyz;
+    gl_Position = u_LightViewProjection * worldPosition;
+}
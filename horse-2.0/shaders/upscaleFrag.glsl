@@ -0,0 +1,30 @@
+#version 410 core
+out vec4 color;
+
+// Scene rendered into the bottom left of a larger target, see DynamicResolution
+uniform sampler2D u_Source;
+uniform vec2 u_OutputSize;
+uniform vec2 u_UvScale;         // rendered size / target size
+uniform vec2 u_SourceTexel;     // 1 / target size
+uniform float u_Sharpness;
+
+vec3 Sample(vec2 uv) {
+    // Half a texel inside the rendered region, nothing outside it was drawn
+    return texture(u_Source, clamp(uv, 0.5f * u_SourceTexel, u_UvScale - 0.5f * u_SourceTexel)).rgb;
+}
+
+void main() {
+    vec2 uv = gl_FragCoord.xy / u_OutputSize * u_UvScale;
+    vec3 center = Sample(uv);
+    vec3 north = Sample(uv + vec2(0.0f, u_SourceTexel.y));
+    vec3 south = Sample(uv - vec2(0.0f, u_SourceTexel.y));
+    vec3 east = Sample(uv + vec2(u_SourceTexel.x, 0.0f));
+    vec3 west = Sample(uv - vec2(u_SourceTexel.x, 0.0f));
+
+    // Unsharp mask limited to the neighbourhood's range, so edges get
+    // crisper without ringing
+    vec3 sharpened = center + u_Sharpness * (4.0f * center - north - south - east - west) * 0.25f;
+    vec3 low = min(center, min(min(north, south), min(east, west)));
+    vec3 high = max(center, max(max(north, south), max(east, west)));
+    color = vec4(clamp(sharpened, low, high), 1.0f);
+}
@@ -9,6 +9,11 @@ out vec3 v_vertexColors;
 out vec2 v_texCoords;
 out vec3 v_fragPos;
 out vec3 v_normal;
+out float v_viewDepth;
+
+// Must match depthVert.glsl bit for bit for the GL_EQUAL pass after a
+// depth pre-pass
+invariant gl_Position;
 
 uniform mat4 u_ModelMatrix;
 uniform mat4 u_ViewMatrix;
@@ -22,6 +27,9 @@ void main() {
 	v_vertexColors = vertexColors;
 	v_texCoords = texCoords;
 
+	// Positive distance along the view direction, selects the cluster slice
+	v_viewDepth = -(u_ViewMatrix * vec4(v_fragPos, 1.0f)).z;
+
 	// MVP Matrix
 	vec4 newPosition = u_Projection * u_ViewMatrix * u_ModelMatrix * vec4(position, 1.0f);
 
@@ -1,6 +1,17 @@
 #include "App.hpp"
+#include "GpuMemory.hpp"
 #include <iostream>
 
+#if defined(__linux__)
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#define HORSE_HEADLESS_EGL 1
+
+static void* GetEglProcAddress(const char* name) {
+    return reinterpret_cast<void*>(eglGetProcAddress(name));
+}
+#endif
+
 App::App() {
     screenWidth = 0;
     screenHeight = 0;
@@ -53,7 +64,148 @@ void App::Initialize() {
     }
 }
 
+void App::InitializeHeadless() {
+    headless = true;
+
+#if defined(HORSE_HEADLESS_EGL)
+    // Prefer Mesa's surfaceless platform, it needs no X/Wayland display
+    EGLDisplay display = EGL_NO_DISPLAY;
+    auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+    if (getPlatformDisplay) {
+        display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    }
+    if (display == EGL_NO_DISPLAY) {
+        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    }
+
+    EGLint major = 0, minor = 0;
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor)) {
+        std::cout << "Could not initialize EGL display: " << eglGetError() << std::endl;
+        exit(1);
+    }
+
+    const EGLint configAttributes[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, 8,
+        EGL_GREEN_SIZE, 8,
+        EGL_BLUE_SIZE, 8,
+        EGL_DEPTH_SIZE, 24,
+        EGL_NONE
+    };
+    EGLConfig config;
+    EGLint configCount = 0;
+    if (!eglChooseConfig(display, configAttributes, &config, 1, &configCount) || configCount == 0) {
+        std::cout << "Could not find an EGL config" << std::endl;
+        exit(1);
+    }
+
+    eglBindAPI(EGL_OPENGL_API);
+
+    // Same 4.1 core context the windowed path asks SDL for
+    const EGLint contextAttributes[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 4,
+        EGL_CONTEXT_MINOR_VERSION, 1,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+    if (context == EGL_NO_CONTEXT) {
+        std::cout << "Could not create EGL context: " << eglGetError() << std::endl;
+        exit(1);
+    }
+
+    if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+        std::cout << "Could not make surfaceless EGL context current: " << eglGetError() << std::endl;
+        exit(1);
+    }
+
+    eglDisplay = display;
+    eglContext = context;
+#else
+    // No EGL, use a window that is never shown
+    Initialize();
+    SDL_HideWindow(window);
+#endif
+}
+
+void App::LoadGL() {
+    int loaded = 0;
+#if defined(HORSE_HEADLESS_EGL)
+    if (eglContext) {
+        loaded = gladLoadGLLoader(GetEglProcAddress);
+    }
+    else
+#endif
+    {
+        loaded = gladLoadGLLoader(SDL_GL_GetProcAddress);
+    }
+
+    if (!loaded) {
+        std::cout << "Could not initialize glad.\n" << std::endl;
+        exit(1);
+    }
+
+    if (!headless) {
+        return;
+    }
+
+    // Offscreen target standing in for the window's back buffer
+    glGenRenderbuffers(1, &colorRenderbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorRenderbuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, screenWidth, screenHeight);
+
+    glGenRenderbuffers(1, &depthRenderbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthRenderbuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, screenWidth, screenHeight);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    // Depth is padded to 32 bits on most hardware
+    uint64_t targetBytes = static_cast<uint64_t>(screenWidth) * screenHeight * 4;
+    GpuMemory::Get().TrackRenderbuffer(colorRenderbuffer, targetBytes, "offscreen framebuffer");
+    GpuMemory::Get().TrackRenderbuffer(depthRenderbuffer, targetBytes, "offscreen framebuffer");
+
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorRenderbuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthRenderbuffer);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cout << "Offscreen framebuffer is incomplete" << std::endl;
+        exit(1);
+    }
+}
+
+void App::SwapBuffers() {
+    if (headless) {
+        // Nothing to present, wait for the GPU so frame times include its work
+        glFinish();
+        return;
+    }
+    SDL_GL_SwapWindow(window);
+}
+
 void App::Terminate() {
+    if (framebuffer != 0) {
+        glDeleteFramebuffers(1, &framebuffer);
+        glDeleteRenderbuffers(1, &colorRenderbuffer);
+        glDeleteRenderbuffers(1, &depthRenderbuffer);
+        GpuMemory::Get().ReleaseRenderbuffer(colorRenderbuffer);
+        GpuMemory::Get().ReleaseRenderbuffer(depthRenderbuffer);
+        framebuffer = 0;
+    }
+
+#if defined(HORSE_HEADLESS_EGL)
+    if (eglContext) {
+        eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        eglDestroyContext(eglDisplay, eglContext);
+        eglTerminate(eglDisplay);
+        eglContext = nullptr;
+        eglDisplay = nullptr;
+        return;
+    }
+#endif
+
     SDL_DestroyWindow(window);
     SDL_Quit();
 }
@@ -75,5 +227,7 @@ void App::setHeight(int value) {
 SDL_Window* App::getWindow() { return window; }
 SDL_GLContext App::getContext() { return openGlContext; }
 bool App::isActive() { return active; }
+bool App::isHeadless() { return headless; }
+GLuint App::getFramebuffer() { return framebuffer; }
 int App::getWidth() { return screenWidth; }
 int App::getHeight() { return screenHeight; }
\ No newline at end of file
@@ -0,0 +1,197 @@
+#include "Benchmark.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <sstream>
+
+bool BenchmarkOptions::Parse(int argc, char* argv[], BenchmarkOptions& options) {
+    bool benchmark = false;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--benchmark") {
+            benchmark = true;
+        }
+        else if (arg == "--windowed") {
+            options.headless = false;
+        }
+        else if (arg == "--frames" && hasValue) {
+            options.frames = std::atoi(argv[++i]);
+        }
+        else if (arg == "--warmup" && hasValue) {
+            options.warmupFrames = std::atoi(argv[++i]);
+        }
+        else if (arg == "--width" && hasValue) {
+            options.width = std::atoi(argv[++i]);
+        }
+        else if (arg == "--height" && hasValue) {
+            options.height = std::atoi(argv[++i]);
+        }
+        else if (arg == "--camera-path" && hasValue) {
+            options.cameraPath = argv[++i];
+        }
+        else if (arg == "--csv") {
+            options.csv = true;
+        }
+        else if (arg == "--deferred") {
+            options.deferred = true;
+        }
+        else if (arg == "--no-shadows") {
+            options.shadows = false;
+        }
+        else if (arg == "--depth-prepass") {
+            options.depthPrepass = true;
+        }
+        else if (arg == "--no-occlusion") {
+            options.occlusion = false;
+        }
+        else if (arg == "--no-software-occlusion") {
+            options.softwareOcclusion = false;
+        }
+        else if (arg == "--no-simd") {
+            options.simd = false;
+        }
+        else if (arg == "--no-portals") {
+            options.portals = false;
+        }
+        else if (arg == "--no-texture-arrays") {
+            options.textureArrays = false;
+        }
+        else if (arg == "--no-atlas") {
+            options.textureAtlas = false;
+        }
+        else if (arg == "--no-streaming") {
+            options.textureStreaming = false;
+        }
+        else if (arg == "--texture-budget" && hasValue) {
+            options.textureBudgetMB = std::atoi(argv[++i]);
+        }
+        else if (arg == "--gpu-budget" && hasValue) {
+            options.gpuBudgetMB = std::atoi(argv[++i]);
+        }
+        else if (arg == "--import" && hasValue) {
+            bool printTimings = options.importSettings.printTimings;
+            if (!ImportSettings::FromName(argv[++i], options.importSettings)) {
+                std::cerr << "Unknown import preset: " << argv[i] << std::endl;
+            }
+            options.importSettings.printTimings = printTimings;
+        }
+        else if (arg == "--import-timings") {
+            options.importSettings.printTimings = true;
+        }
+        else if (arg == "--scene" && hasValue) {
+            options.scenePath = argv[++i];
+        }
+        else if (arg == "--dynamic-resolution" && hasValue) {
+            options.dynamicResolutionMs = std::atof(argv[++i]);
+        }
+        else if (arg == "--upscale" && hasValue) {
+            std::string mode = argv[++i];
+            if (mode == "sharpen" || mode == "bilinear") {
+                options.sharpenUpscale = mode == "sharpen";
+            }
+            else {
+                std::cerr << "Unknown upscale filter: " << mode << std::endl;
+            }
+        }
+        // Stress scene
+        else if (arg == "--stress") {
+            options.stress = true;
+        }
+        else if (arg == "--seed" && hasValue) {
+            options.stressConfig.seed = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (arg == "--cubes" && hasValue) {
+            options.stressConfig.cubes = std::atoi(argv[++i]);
+        }
+        else if (arg == "--pyramids" && hasValue) {
+            options.stressConfig.pyramids = std::atoi(argv[++i]);
+        }
+        else if (arg == "--models" && hasValue) {
+            options.stressConfig.models = std::atoi(argv[++i]);
+        }
+        else if (arg == "--textures" && hasValue) {
+            options.stressConfig.textures = std::atoi(argv[++i]);
+        }
+        else if (arg == "--lights" && hasValue) {
+            options.stressConfig.lights = std::atoi(argv[++i]);
+        }
+        else if (arg == "--moving" && hasValue) {
+            options.stressConfig.movingFraction = static_cast<float>(std::atof(argv[++i]));
+        }
+        else if (arg == "--walls" && hasValue) {
+            options.stressConfig.walls = std::atoi(argv[++i]);
+        }
+        else if (arg == "--rooms" && hasValue) {
+            options.stressConfig.rooms = std::atoi(argv[++i]);
+        }
+        else if (arg == "--extent" && hasValue) {
+            options.stressConfig.extent = static_cast<float>(std::atof(argv[++i]));
+        }
+    }
+
+    options.frames = std::max(options.frames, 1);
+    options.warmupFrames = std::max(options.warmupFrames, 0);
+    options.width = std::max(options.width, 1);
+    options.height = std::max(options.height, 1);
+    return benchmark;
+}
+
+void FrameStatistics::Add(double ms) {
+    m_samples.push_back(ms);
+    m_sortedValid = false;
+}
+
+void FrameStatistics::Clear() {
+    m_samples.clear();
+    m_sorted.clear();
+    m_sortedValid = false;
+}
+
+double FrameStatistics::GetMin() const {
+    return m_samples.empty() ? 0.0 : *std::min_element(m_samples.begin(), m_samples.end());
+}
+
+double FrameStatistics::GetMax() const {
+    return m_samples.empty() ? 0.0 : *std::max_element(m_samples.begin(), m_samples.end());
+}
+
+double FrameStatistics::GetMean() const {
+    if (m_samples.empty()) {
+        return 0.0;
+    }
+    return std::accumulate(m_samples.begin(), m_samples.end(), 0.0) / m_samples.size();
+}
+
+double FrameStatistics::GetPercentile(double percentile) const {
+    if (m_samples.empty()) {
+        return 0.0;
+    }
+    if (!m_sortedValid) {
+        m_sorted = m_samples;
+        std::sort(m_sorted.begin(), m_sorted.end());
+        m_sortedValid = true;
+    }
+
+    // Nearest rank
+    double rank = percentile / 100.0 * (m_sorted.size() - 1);
+    size_t index = static_cast<size_t>(rank + 0.5);
+    return m_sorted[std::min(index, m_sorted.size() - 1)];
+}
+
+void FrameStatistics::Print(std::ostream& out, const std::string& label) const {
+    // Formatted apart so the caller's stream keeps its own precision
+    std::ostringstream text;
+    text << std::fixed << std::setprecision(3)
+        << label << " (" << GetCount() << " frames, ms):"
+        << " min " << GetMin()
+        << " mean " << GetMean()
+        << " p50 " << GetPercentile(50.0)
+        << " p95 " << GetPercentile(95.0)
+        << " p99 " << GetPercentile(99.0)
+        << " max " << GetMax() << std::endl;
+    out << text.str();
+}
@@ -8,6 +8,7 @@
 
 Camera::Camera() {
     m_eye = glm::vec3(0.0f, 0.0f, 0.0f);
+    m_previousEye = m_eye;
     m_lookDirection = glm::vec3(0.0f, 0.0f, -1.0f);
     m_upVector = glm::vec3(0.0f, 1.0f, 0.0f);
 
@@ -86,6 +87,13 @@ void Camera::SetFovy(float fovy) {
     m_projectionMatrix = glm::perspective(glm::radians(fovy), m_aspect, m_near, m_far);
 }
 
+void Camera::SetPose(const glm::vec3& eye, const glm::vec3& target) {
+    m_eye = eye;
+    if (glm::length(target - eye) > 0.0f) {
+        m_lookDirection = glm::normalize(target - eye);
+    }
+}
+
 // Getters
 float Camera::GetFovy() { return m_fovy; }
 
@@ -98,4 +106,17 @@ glm::mat4 Camera::GetProjectionMatrix() const {
 
 glm::mat4 Camera::GetViewMatrix() const {
     return glm::lookAt(m_eye, m_eye + m_lookDirection, m_upVector);
+}
+
+void Camera::StorePreviousState() {
+    m_previousEye = m_eye;
+}
+
+glm::vec3 Camera::GetInterpolatedEye(float alpha) const {
+    return glm::mix(m_previousEye, m_eye, alpha);
+}
+
+glm::mat4 Camera::GetInterpolatedViewMatrix(float alpha) const {
+    glm::vec3 eye = GetInterpolatedEye(alpha);
+    return glm::lookAt(eye, eye + m_lookDirection, m_upVector);
 }
\ No newline at end of file
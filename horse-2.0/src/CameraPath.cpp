@@ -0,0 +1,101 @@
+#include "CameraPath.hpp"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+CameraPath::CameraPath() {
+}
+
+bool CameraPath::Load(const std::string& filepath) {
+    std::ifstream file(filepath.c_str());
+    if (!file.is_open()) {
+        std::cerr << "Could not open camera path: " << filepath << std::endl;
+        return false;
+    }
+
+    m_keys.clear();
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        lineNumber++;
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+
+        std::istringstream stream(line);
+        CameraKey key;
+        if (!(stream >> key.time >> key.eye.x >> key.eye.y >> key.eye.z >> key.target.x >> key.target.y >> key.target.z)) {
+            std::cerr << "Camera path " << filepath << ":" << lineNumber << ": expected 7 numbers" << std::endl;
+            continue;
+        }
+        AddKey(key.time, key.eye, key.target);
+    }
+
+    if (m_keys.empty()) {
+        std::cerr << "Camera path has no keys: " << filepath << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void CameraPath::AddKey(float time, const glm::vec3& eye, const glm::vec3& target) {
+    CameraKey key = { time, eye, target };
+    auto it = std::upper_bound(m_keys.begin(), m_keys.end(), time,
+        [](float t, const CameraKey& k) { return t < k.time; });
+    m_keys.insert(it, key);
+}
+
+float CameraPath::GetDuration() const {
+    return m_keys.empty() ? 0.0f : m_keys.back().time;
+}
+
+void CameraPath::Sample(float time, glm::vec3& eye, glm::vec3& target) const {
+    if (m_keys.empty()) {
+        eye = glm::vec3(0.0f);
+        target = glm::vec3(0.0f, 0.0f, -1.0f);
+        return;
+    }
+    if (m_keys.size() == 1 || GetDuration() <= 0.0f) {
+        eye = m_keys[0].eye;
+        target = m_keys[0].target;
+        return;
+    }
+
+    time = std::fmod(time, GetDuration());
+
+    // Segment [i, i + 1] containing time
+    size_t i = 0;
+    while (i + 2 < m_keys.size() && m_keys[i + 1].time <= time) {
+        i++;
+    }
+
+    const CameraKey& k1 = m_keys[i];
+    const CameraKey& k2 = m_keys[i + 1];
+    const CameraKey& k0 = m_keys[i > 0 ? i - 1 : i];
+    const CameraKey& k3 = m_keys[i + 2 < m_keys.size() ? i + 2 : i + 1];
+
+    float span = k2.time - k1.time;
+    float t = span > 0.0f ? glm::clamp((time - k1.time) / span, 0.0f, 1.0f) : 0.0f;
+    float t2 = t * t;
+    float t3 = t2 * t;
+
+    // Uniform Catmull-Rom
+    eye = 0.5f * ((2.0f * k1.eye) +
+        (-k0.eye + k2.eye) * t +
+        (2.0f * k0.eye - 5.0f * k1.eye + 4.0f * k2.eye - k3.eye) * t2 +
+        (-k0.eye + 3.0f * k1.eye - 3.0f * k2.eye + k3.eye) * t3);
+    target = glm::mix(k1.target, k2.target, t);
+}
+
+CameraPath CameraPath::CreateOrbit(const glm::vec3& center, float radius, float height, float duration, int keyCount) {
+    CameraPath path;
+    for (int i = 0; i <= keyCount; i++) {
+        float t = static_cast<float>(i) / keyCount;
+        float angle = t * 2.0f * 3.14159265f;
+        glm::vec3 eye = center + glm::vec3(radius * sin(angle), height, radius * cos(angle));
+        path.AddKey(t * duration, eye, center);
+    }
+    return path;
+}
@@ -0,0 +1,240 @@
+#include "ClusteredLighting.hpp"
+#include "GpuMemory.hpp"
+#include "Profiler.hpp"
+#include "RenderStats.hpp"
+#include <algorithm>
+#include <cmath>
+
+static const int kTilesPerSlice = ClusteredLighting::kClustersX * ClusteredLighting::kClustersY;
+
+ClusteredLighting::ClusteredLighting() {
+}
+
+void ClusteredLighting::Initialize() {
+    if (m_initialized) {
+        return;
+    }
+
+    CreateBuffer(m_lightData, GL_RGBA32F);
+    CreateBuffer(m_clusterData, GL_RG32UI);
+    CreateBuffer(m_lightIndexData, GL_R32UI);
+
+    m_clusters.resize(kClusterCount);
+    m_sliceIndices.resize(kClustersZ);
+    m_initialized = true;
+}
+
+void ClusteredLighting::CleanUp() {
+    if (!m_initialized) {
+        return;
+    }
+
+    TextureBuffer* buffers[] = { &m_lightData, &m_clusterData, &m_lightIndexData };
+    for (TextureBuffer* target : buffers) {
+        glDeleteTextures(1, &target->texture);
+        glDeleteBuffers(1, &target->buffer);
+        GpuMemory::Get().ReleaseBuffer(target->buffer);
+        target->texture = 0;
+        target->buffer = 0;
+    }
+    m_initialized = false;
+}
+
+void ClusteredLighting::SetJobSystem(JobSystem* jobSystem) {
+    m_jobSystem = jobSystem;
+}
+
+void ClusteredLighting::Update(const std::vector<PointLight>& lights, const glm::mat4& view, const glm::mat4& projection, float nearPlane, float farPlane) {
+    HORSE_PROFILE_FUNCTION();
+
+    m_near = nearPlane;
+    m_far = farPlane;
+
+    size_t lightCount = std::min(lights.size(), static_cast<size_t>(kMaxLights));
+    m_lights.assign(lights.begin(), lights.begin() + lightCount);
+
+    // Screen/depth footprint of every light, culling the ones off screen
+    m_ranges.resize(lightCount);
+    std::vector<uint32_t> visible;
+    visible.reserve(lightCount);
+    for (size_t i = 0; i < lightCount; i++) {
+        if (ComputeRange(m_lights[i], view, projection, m_ranges[i])) {
+            visible.push_back(static_cast<uint32_t>(i));
+        }
+    }
+
+    // Each depth slice is binned independently into its own index list
+    auto binSlices = [&](uint32_t begin, uint32_t end) {
+        for (uint32_t z = begin; z < end; z++) {
+            uint32_t counts[kTilesPerSlice] = {};
+            uint32_t offsets[kTilesPerSlice];
+            uint32_t filled[kTilesPerSlice] = {};
+
+            for (uint32_t light : visible) {
+                const ClusterRange& range = m_ranges[light];
+                if ((int)z < range.minZ || (int)z > range.maxZ) {
+                    continue;
+                }
+                for (int y = range.minY; y <= range.maxY; y++) {
+                    for (int x = range.minX; x <= range.maxX; x++) {
+                        counts[y * kClustersX + x]++;
+                    }
+                }
+            }
+
+            uint32_t total = 0;
+            for (int i = 0; i < kTilesPerSlice; i++) {
+                counts[i] = std::min(counts[i], static_cast<uint32_t>(kMaxLightsPerCluster));
+                offsets[i] = total;
+                total += counts[i];
+            }
+
+            std::vector<uint32_t>& indices = m_sliceIndices[z];
+            indices.resize(total);
+            for (uint32_t light : visible) {
+                const ClusterRange& range = m_ranges[light];
+                if ((int)z < range.minZ || (int)z > range.maxZ) {
+                    continue;
+                }
+                for (int y = range.minY; y <= range.maxY; y++) {
+                    for (int x = range.minX; x <= range.maxX; x++) {
+                        int tile = y * kClustersX + x;
+                        if (filled[tile] < counts[tile]) {
+                            indices[offsets[tile] + filled[tile]++] = light;
+                        }
+                    }
+                }
+            }
+
+            for (int i = 0; i < kTilesPerSlice; i++) {
+                m_clusters[z * kTilesPerSlice + i] = glm::uvec2(offsets[i], counts[i]);
+            }
+        }
+    };
+
+    if (m_jobSystem && m_jobSystem->IsInitialized() && !visible.empty()) {
+        m_jobSystem->ParallelFor(kClustersZ, 2, binSlices);
+    }
+    else {
+        binSlices(0, kClustersZ);
+    }
+
+    // Stitch the slices into one index list
+    m_lightIndices.clear();
+    for (int z = 0; z < kClustersZ; z++) {
+        uint32_t base = static_cast<uint32_t>(m_lightIndices.size());
+        for (int i = 0; i < kTilesPerSlice; i++) {
+            m_clusters[z * kTilesPerSlice + i].x += base;
+        }
+        m_lightIndices.insert(m_lightIndices.end(), m_sliceIndices[z].begin(), m_sliceIndices[z].end());
+    }
+
+    // Two texels per light: position + radius, color + intensity
+    std::vector<float> lightData;
+    lightData.reserve(m_lights.size() * 8);
+    for (const auto& light : m_lights) {
+        float texels[8] = {
+            light.position.x, light.position.y, light.position.z, light.radius,
+            light.color.r, light.color.g, light.color.b, light.intensity
+        };
+        lightData.insert(lightData.end(), texels, texels + 8);
+    }
+
+    Upload(m_lightData, lightData.data(), lightData.size() * sizeof(float));
+    Upload(m_clusterData, m_clusters.data(), m_clusters.size() * sizeof(glm::uvec2));
+    Upload(m_lightIndexData, m_lightIndices.data(), m_lightIndices.size() * sizeof(uint32_t));
+}
+
+void ClusteredLighting::Bind(Shader* shader, int viewportWidth, int viewportHeight) {
+    glActiveTexture(GL_TEXTURE0 + kLightDataUnit);
+    glBindTexture(GL_TEXTURE_BUFFER, m_lightData.texture);
+    glActiveTexture(GL_TEXTURE0 + kClusterDataUnit);
+    glBindTexture(GL_TEXTURE_BUFFER, m_clusterData.texture);
+    glActiveTexture(GL_TEXTURE0 + kLightIndexUnit);
+    glBindTexture(GL_TEXTURE_BUFFER, m_lightIndexData.texture);
+    glActiveTexture(GL_TEXTURE0);
+
+    shader->setInt("u_lightData", kLightDataUnit);
+    shader->setInt("u_clusterData", kClusterDataUnit);
+    shader->setInt("u_lightIndices", kLightIndexUnit);
+    shader->setUniformIVec3("u_clusterCount", glm::ivec3(kClustersX, kClustersY, kClustersZ));
+    shader->setUniformVec2("u_viewportSize", glm::vec2(static_cast<float>(viewportWidth), static_cast<float>(viewportHeight)));
+    shader->setFloat("u_clusterNear", m_near);
+    shader->setFloat("u_clusterLogScale", kClustersZ / std::log(m_far / m_near));
+}
+
+void ClusteredLighting::CreateBuffer(TextureBuffer& target, GLenum format) {
+    glGenBuffers(1, &target.buffer);
+    glBindBuffer(GL_TEXTURE_BUFFER, target.buffer);
+    // Never leave a texture buffer without storage
+    uint32_t zero[4] = {};
+    glBufferData(GL_TEXTURE_BUFFER, sizeof(zero), zero, GL_STREAM_DRAW);
+    GpuMemory::Get().TrackBuffer(target.buffer, GpuMemory::UniformBuffers, sizeof(zero), "clustered lighting");
+
+    glGenTextures(1, &target.texture);
+    glBindTexture(GL_TEXTURE_BUFFER, target.texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, format, target.buffer);
+
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void ClusteredLighting::Upload(TextureBuffer& target, const void* data, size_t bytes) {
+    if (bytes == 0) {
+        return;
+    }
+
+    // Orphan and refill, the driver hands back fresh storage instead of
+    // waiting for last frame's draws
+    glBindBuffer(GL_TEXTURE_BUFFER, target.buffer);
+    glBufferData(GL_TEXTURE_BUFFER, bytes, data, GL_STREAM_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    RenderStats::Current().CountBufferUpload(bytes);
+    GpuMemory::Get().TrackBuffer(target.buffer, GpuMemory::UniformBuffers, bytes, "clustered lighting");
+}
+
+bool ClusteredLighting::ComputeRange(const PointLight& light, const glm::mat4& view, const glm::mat4& projection, ClusterRange& range) const {
+    glm::vec3 center = glm::vec3(view * glm::vec4(light.position, 1.0f));
+    float radius = light.radius;
+
+    // View space looks down -z, work with positive depth
+    float depthMin = -center.z - radius;
+    float depthMax = -center.z + radius;
+    if (depthMax < m_near || depthMin > m_far) {
+        return false;
+    }
+    depthMin = std::max(depthMin, m_near);
+    depthMax = std::min(depthMax, m_far);
+
+    // Conservative NDC extents of the light's bounding box: x / depth is
+    // extreme at the nearest depth for positive x, the farthest for negative
+    auto ndcMin = [&](float low, float scale) { return scale * low / (low < 0.0f ? depthMin : depthMax); };
+    auto ndcMax = [&](float high, float scale) { return scale * high / (high > 0.0f ? depthMin : depthMax); };
+
+    float xMin = ndcMin(center.x - radius, projection[0][0]);
+    float xMax = ndcMax(center.x + radius, projection[0][0]);
+    float yMin = ndcMin(center.y - radius, projection[1][1]);
+    float yMax = ndcMax(center.y + radius, projection[1][1]);
+    if (xMax < -1.0f || xMin > 1.0f || yMax < -1.0f || yMin > 1.0f) {
+        return false;
+    }
+
+    auto tile = [](float ndc, int count) {
+        int index = static_cast<int>(std::floor((ndc * 0.5f + 0.5f) * count));
+        return std::min(std::max(index, 0), count - 1);
+    };
+
+    range.minX = tile(xMin, kClustersX);
+    range.maxX = tile(xMax, kClustersX);
+    range.minY = tile(yMin, kClustersY);
+    range.maxY = tile(yMax, kClustersY);
+    range.minZ = SliceForDepth(depthMin);
+    range.maxZ = SliceForDepth(depthMax);
+    return true;
+}
+
+int ClusteredLighting::SliceForDepth(float depth) const {
+    // Exponential slices, matching the lookup in frag.glsl
+    int slice = static_cast<int>(std::log(depth / m_near) / std::log(m_far / m_near) * kClustersZ);
+    return std::min(std::max(slice, 0), kClustersZ - 1);
+}
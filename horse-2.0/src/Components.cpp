@@ -0,0 +1,36 @@
+#include "Components.hpp"
+
+glm::mat4 TransformComponent::GetModelMatrix() const {
+    glm::mat4 model = glm::mat4(1.0f);
+    model = glm::translate(model, position);
+    model = glm::rotate(model, rotationAngle, rotationAxis);
+    model = glm::scale(model, scale);
+    return model;
+}
+
+glm::vec3 TransformComponent::GetInterpolatedPosition(float alpha) const {
+    // Exact for objects at rest, shadow caches compare positions
+    if (!hasPrevious || previousPosition == position) {
+        return position;
+    }
+    return glm::mix(previousPosition, position, alpha);
+}
+
+glm::mat4 TransformComponent::GetInterpolatedModelMatrix(float alpha) const {
+    if (!hasPrevious) {
+        return GetModelMatrix();
+    }
+
+    glm::mat4 model = glm::mat4(1.0f);
+    model = glm::translate(model, glm::mix(previousPosition, position, alpha));
+    model = glm::rotate(model, glm::mix(previousRotationAngle, rotationAngle, alpha), rotationAxis);
+    model = glm::scale(model, glm::mix(previousScale, scale, alpha));
+    return model;
+}
+
+void TransformComponent::StorePrevious() {
+    previousPosition = position;
+    previousRotationAngle = rotationAngle;
+    previousScale = scale;
+    hasPrevious = true;
+}
@@ -0,0 +1,142 @@
+#include "DeferredRenderer.hpp"
+#include "GpuMemory.hpp"
+#include "Profiler.hpp"
+#include "RenderStats.hpp"
+#include <iostream>
+
+DeferredRenderer::DeferredRenderer() {
+}
+
+void DeferredRenderer::Initialize(int width, int height) {
+    if (m_initialized) {
+        return;
+    }
+
+    glGenVertexArrays(1, &m_emptyVertexArray);
+    CreateTargets(width, height);
+    m_viewportWidth = width;
+    m_viewportHeight = height;
+    m_initialized = true;
+}
+
+void DeferredRenderer::CleanUp() {
+    if (!m_initialized) {
+        return;
+    }
+
+    DestroyTargets();
+    glDeleteVertexArrays(1, &m_emptyVertexArray);
+    m_emptyVertexArray = 0;
+    m_initialized = false;
+}
+
+void DeferredRenderer::BeginGeometryPass(int width, int height) {
+    HORSE_PROFILE_FUNCTION();
+
+    if (width > m_width || height > m_height || width * 2 < m_width || height * 2 < m_height) {
+        DestroyTargets();
+        CreateTargets(width, height);
+    }
+    m_viewportWidth = width;
+    m_viewportHeight = height;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    glViewport(0, 0, m_viewportWidth, m_viewportHeight);
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_LESS);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+
+void DeferredRenderer::Shade(Shader* shader, GLuint targetFramebuffer, const glm::mat4& view, const glm::mat4& projection,
+    const glm::vec3& viewPos, const glm::vec3& ambientColor, ClusteredLighting& lighting) {
+    HORSE_PROFILE_FUNCTION();
+
+    glBindFramebuffer(GL_FRAMEBUFFER, targetFramebuffer);
+    glViewport(0, 0, m_viewportWidth, m_viewportHeight);
+
+    shader->useProgram();
+    lighting.Bind(shader, m_viewportWidth, m_viewportHeight);
+
+    glActiveTexture(GL_TEXTURE0 + kAlbedoUnit);
+    glBindTexture(GL_TEXTURE_2D, m_albedo);
+    glActiveTexture(GL_TEXTURE0 + kNormalUnit);
+    glBindTexture(GL_TEXTURE_2D, m_normal);
+    glActiveTexture(GL_TEXTURE0 + kDepthUnit);
+    glBindTexture(GL_TEXTURE_2D, m_depth);
+    glActiveTexture(GL_TEXTURE0);
+
+    shader->setInt("u_gAlbedo", kAlbedoUnit);
+    shader->setInt("u_gNormal", kNormalUnit);
+    shader->setInt("u_gDepth", kDepthUnit);
+    shader->setUniformMat4("u_ViewMatrix", view);
+    shader->setUniformMat4("u_InverseViewProjection", glm::inverse(projection * view));
+    shader->setUniformVec3("u_viewPos", viewPos);
+    shader->setUniformVec3("u_ambientColor", ambientColor);
+
+    // The pass copies the G-buffer depth through gl_FragDepth, which works
+    // whatever depth format the target has (a blit needs them to match)
+    glDepthFunc(GL_ALWAYS);
+    glBindVertexArray(m_emptyVertexArray);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    RenderStats::Current().CountDraw(3);
+    glBindVertexArray(0);
+    glDepthFunc(GL_LESS);
+}
+
+size_t DeferredRenderer::GetMemoryBytes() const {
+    // RGBA8 + RG16 + DEPTH24 (stored as 32 bits on most hardware)
+    return static_cast<size_t>(m_width) * static_cast<size_t>(m_height) * (4 + 4 + 4);
+}
+
+void DeferredRenderer::CreateTargets(int width, int height) {
+    m_width = width;
+    m_height = height;
+
+    // Every texel is read with texelFetch, so no filtering or mips are needed
+    auto createTarget = [width, height](GLenum internalFormat, GLenum format, GLenum type) {
+        GLuint texture = 0;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, nullptr);
+        GpuMemory::Get().TrackTexture(texture, GpuMemory::RenderTargets, GpuMemory::TextureBytes(width, height, 1, 4), "G-buffer");
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        return texture;
+    };
+
+    m_albedo = createTarget(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE);
+    m_normal = createTarget(GL_RG16, GL_RG, GL_UNSIGNED_SHORT);
+    m_depth = createTarget(GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenFramebuffers(1, &m_framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_albedo, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, m_normal, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, m_depth, 0);
+
+    GLenum drawBuffers[] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+    glDrawBuffers(2, drawBuffers);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cout << "G-buffer framebuffer is incomplete" << std::endl;
+        exit(1);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void DeferredRenderer::DestroyTargets() {
+    GLuint textures[] = { m_albedo, m_normal, m_depth };
+    glDeleteTextures(3, textures);
+    for (GLuint texture : textures) {
+        GpuMemory::Get().ReleaseTexture(texture);
+    }
+    glDeleteFramebuffers(1, &m_framebuffer);
+    m_albedo = 0;
+    m_normal = 0;
+    m_depth = 0;
+    m_framebuffer = 0;
+}
@@ -0,0 +1,188 @@
+#include "DynamicResolution.hpp"
+#include "GpuMemory.hpp"
+#include "GpuProfiler.hpp"
+#include "Profiler.hpp"
+#include "RenderStats.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+DynamicResolution::DynamicResolution() {
+}
+
+void DynamicResolution::Initialize(Shader* upscaleShader, int width, int height) {
+    m_shader = upscaleShader;
+    glGenVertexArrays(1, &m_emptyVertexArray);
+    CreateTarget(width, height);
+}
+
+void DynamicResolution::CleanUp() {
+    DestroyTarget();
+    if (m_emptyVertexArray != 0) {
+        glDeleteVertexArrays(1, &m_emptyVertexArray);
+        m_emptyVertexArray = 0;
+    }
+}
+
+void DynamicResolution::SetEnabled(bool enabled) {
+    m_enabled = enabled;
+    m_scale = enabled ? ClampScale(m_settings.maxScale) : 1.0f;
+    m_measuredMs = 0.0;
+    m_samples = 0;
+    m_framesSinceChange = 0;
+}
+
+void DynamicResolution::SetSettings(const Settings& settings) {
+    m_settings = settings;
+    // Below half the upscale blurs too much to be worth it, and the
+    // G-buffer reallocates once a pass uses less than half of it
+    m_settings.minScale = std::max(m_settings.minScale, 0.5f);
+    m_settings.maxScale = std::min(std::max(m_settings.maxScale, m_settings.minScale), 1.0f);
+    m_scale = ClampScale(m_scale);
+}
+
+void DynamicResolution::Resize(int width, int height) {
+    if (width == m_width && height == m_height) {
+        return;
+    }
+    DestroyTarget();
+    CreateTarget(width, height);
+}
+
+float DynamicResolution::ClampScale(float scale) const {
+    return std::min(std::max(scale, m_settings.minScale), m_settings.maxScale);
+}
+
+int DynamicResolution::GetRenderWidth() const {
+    return std::max(1, static_cast<int>(m_width * m_scale + 0.5f));
+}
+
+int DynamicResolution::GetRenderHeight() const {
+    return std::max(1, static_cast<int>(m_height * m_scale + 0.5f));
+}
+
+void DynamicResolution::Update(double gpuMs) {
+    if (!m_enabled) {
+        return;
+    }
+
+    // Timer queries report frames rendered before the last change
+    m_framesSinceChange++;
+    if (gpuMs <= 0.0 || m_framesSinceChange <= GpuProfiler::kFrameLatency) {
+        return;
+    }
+    m_measuredMs += gpuMs;
+    m_samples++;
+    if (m_framesSinceChange < kSettleFrames) {
+        return;
+    }
+
+    double ms = m_measuredMs / m_samples;
+    m_measuredMs = 0.0;
+    m_samples = 0;
+
+    // GPU time goes roughly with the pixel count, the square of the scale.
+    // Aim 10% under the target so ordinary variance does not miss it, and
+    // only grow when well under it, at most two steps at a time.
+    double aimMs = m_settings.targetMs * 0.9;
+    float scale = m_scale;
+    if (ms > m_settings.targetMs) {
+        scale = static_cast<float>(m_scale * std::sqrt(aimMs / ms));
+    }
+    else if (ms < m_settings.targetMs * 0.75) {
+        scale = std::min(static_cast<float>(m_scale * std::sqrt(aimMs / ms)), m_scale + 2.0f * kScaleStep);
+    }
+    scale = ClampScale(std::floor(scale / kScaleStep + 1e-3f) * kScaleStep);
+
+    if (std::fabs(scale - m_scale) > 0.5f * kScaleStep) {
+        m_scale = scale;
+        m_framesSinceChange = 0;
+    }
+    else {
+        // Keep averaging at this scale, its times are already current
+        m_framesSinceChange = GpuProfiler::kFrameLatency;
+    }
+}
+
+void DynamicResolution::Resolve(GLuint outputFramebuffer) {
+    HORSE_PROFILE_FUNCTION();
+
+    int renderWidth = GetRenderWidth();
+    int renderHeight = GetRenderHeight();
+    bool sharpen = m_settings.upscale == Sharpen && m_settings.sharpness > 0.0f && m_shader &&
+        (renderWidth != m_width || renderHeight != m_height);
+
+    if (!sharpen) {
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, m_framebuffer);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, outputFramebuffer);
+        glBlitFramebuffer(0, 0, renderWidth, renderHeight, 0, 0, m_width, m_height, GL_COLOR_BUFFER_BIT,
+            renderWidth == m_width && renderHeight == m_height ? GL_NEAREST : GL_LINEAR);
+        glBindFramebuffer(GL_FRAMEBUFFER, outputFramebuffer);
+        return;
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, outputFramebuffer);
+    glViewport(0, 0, m_width, m_height);
+    glDisable(GL_DEPTH_TEST);
+
+    m_shader->useProgram();
+    m_shader->setInt("u_Source", 0);
+    m_shader->setUniformVec2("u_OutputSize", glm::vec2(static_cast<float>(m_width), static_cast<float>(m_height)));
+    m_shader->setUniformVec2("u_UvScale", glm::vec2(static_cast<float>(renderWidth) / m_width, static_cast<float>(renderHeight) / m_height));
+    m_shader->setUniformVec2("u_SourceTexel", glm::vec2(1.0f / m_width, 1.0f / m_height));
+    m_shader->setFloat("u_Sharpness", m_settings.sharpness);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, m_color);
+
+    glBindVertexArray(m_emptyVertexArray);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    RenderStats::Current().CountDraw(3);
+    glBindVertexArray(0);
+    glEnable(GL_DEPTH_TEST);
+}
+
+void DynamicResolution::CreateTarget(int width, int height) {
+    m_width = width;
+    m_height = height;
+
+    // Linear filtering, the upscale samples between texels
+    glGenTextures(1, &m_color);
+    glBindTexture(GL_TEXTURE_2D, m_color);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    GpuMemory::Get().TrackTexture(m_color, GpuMemory::RenderTargets, GpuMemory::TextureBytes(width, height, 1, 4), "dynamic resolution");
+
+    glGenRenderbuffers(1, &m_depth);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_depth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    GpuMemory::Get().TrackRenderbuffer(m_depth, static_cast<uint64_t>(width) * height * 4, "dynamic resolution");
+
+    glGenFramebuffers(1, &m_framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_color, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_depth);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cout << "Dynamic resolution framebuffer is incomplete" << std::endl;
+        exit(1);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void DynamicResolution::DestroyTarget() {
+    if (m_framebuffer == 0) {
+        return;
+    }
+    glDeleteFramebuffers(1, &m_framebuffer);
+    glDeleteTextures(1, &m_color);
+    glDeleteRenderbuffers(1, &m_depth);
+    GpuMemory::Get().ReleaseTexture(m_color);
+    GpuMemory::Get().ReleaseRenderbuffer(m_depth);
+    m_framebuffer = 0;
+    m_color = 0;
+    m_depth = 0;
+}
@@ -0,0 +1,83 @@
+#include "EntityRegistry.hpp"
+#include "Mesh3D.hpp"
+
+EntityRegistry::EntityRegistry() {
+}
+
+// Out of line so RenderableComponent destroys a complete Mesh3D
+EntityRegistry::~EntityRegistry() {
+}
+
+Entity EntityRegistry::Create() {
+    Entity entity;
+    if (!m_freeIndices.empty()) {
+        entity.index = m_freeIndices.back();
+        m_freeIndices.pop_back();
+    }
+    else {
+        entity.index = static_cast<uint32_t>(m_generations.size());
+        m_generations.push_back(0);
+        m_alive.push_back(false);
+    }
+    entity.generation = m_generations[entity.index];
+    m_alive[entity.index] = true;
+    return entity;
+}
+
+void EntityRegistry::Destroy(Entity entity) {
+    if (!IsAlive(entity)) {
+        return;
+    }
+
+    m_transforms.Remove(entity);
+    m_renderables.Remove(entity);
+    m_lights.Remove(entity);
+    m_names.Remove(entity);
+    m_tags.Remove(entity);
+
+    m_generations[entity.index]++;
+    m_alive[entity.index] = false;
+    m_freeIndices.push_back(entity.index);
+}
+
+bool EntityRegistry::IsAlive(Entity entity) const {
+    return entity.index < m_generations.size() && m_alive[entity.index] &&
+        m_generations[entity.index] == entity.generation;
+}
+
+void EntityRegistry::Clear() {
+    m_transforms.Clear();
+    m_renderables.Clear();
+    m_lights.Clear();
+    m_names.Clear();
+    m_tags.Clear();
+
+    // Outstanding handles stay stale once their indices are reused
+    m_freeIndices.clear();
+    for (uint32_t i = static_cast<uint32_t>(m_generations.size()); i > 0; i--) {
+        m_generations[i - 1]++;
+        m_alive[i - 1] = false;
+        m_freeIndices.push_back(i - 1);
+    }
+}
+
+bool EntityRegistry::HasTag(Entity entity, uint32_t flag) const {
+    const TagComponent* tags = m_tags.TryGet(entity);
+    return tags && (tags->flags & flag) != 0;
+}
+
+void EntityRegistry::SetTag(Entity entity, uint32_t flag, bool enabled) {
+    TagComponent* tags = m_tags.TryGet(entity);
+    if (!tags) {
+        if (!enabled) {
+            return;
+        }
+        tags = &m_tags.Add(entity);
+    }
+    if (enabled) {
+        tags->flags |= flag;
+    }
+    else {
+        tags->flags &= ~flag;
+    }
+}
@@ -0,0 +1,42 @@
+#include "FixedTimestep.hpp"
+
+FixedTimestep::FixedTimestep(double tickRate, int maxTicksPerFrame) {
+    m_tickDuration = 1.0 / tickRate;
+    m_maxTicksPerFrame = maxTicksPerFrame;
+}
+
+void FixedTimestep::Reset() {
+    m_lastCounter = SDL_GetPerformanceCounter();
+    m_accumulator = 0.0;
+    m_frameTime = 0.0;
+}
+
+int FixedTimestep::Advance() {
+    Uint64 counter = SDL_GetPerformanceCounter();
+    m_frameTime = static_cast<double>(counter - m_lastCounter) / static_cast<double>(SDL_GetPerformanceFrequency());
+    m_lastCounter = counter;
+
+    m_accumulator += m_frameTime;
+
+    int ticks = static_cast<int>(m_accumulator / m_tickDuration);
+    if (ticks > m_maxTicksPerFrame) {
+        // Falling behind, drop the backlog instead of spiralling
+        ticks = m_maxTicksPerFrame;
+        m_accumulator = ticks * m_tickDuration;
+    }
+
+    m_accumulator -= ticks * m_tickDuration;
+    return ticks;
+}
+
+void FixedTimestep::SetTickRate(double tickRate) {
+    m_tickDuration = 1.0 / tickRate;
+}
+
+float FixedTimestep::GetAlpha() const {
+    return static_cast<float>(m_accumulator / m_tickDuration);
+}
+
+double FixedTimestep::Now() {
+    return static_cast<double>(SDL_GetPerformanceCounter()) / static_cast<double>(SDL_GetPerformanceFrequency());
+}
@@ -0,0 +1,116 @@
+#include "FrameLimiter.hpp"
+#include "FixedTimestep.hpp"
+#include "Profiler.hpp"
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+FrameLimiter::FrameLimiter() {
+}
+
+FrameLimiter::VSync FrameLimiter::SetVSync(VSync mode) {
+    if (SDL_GL_SetSwapInterval(static_cast<int>(mode)) != 0) {
+        if (mode == VSyncAdaptive && SDL_GL_SetSwapInterval(1) == 0) {
+            std::cout << "Adaptive VSync is not supported, using VSync" << std::endl;
+            mode = VSyncOn;
+        }
+        else {
+            std::cout << "Could not set swap interval: " << SDL_GetError() << std::endl;
+            return m_vsync;
+        }
+    }
+    m_vsync = mode;
+    return m_vsync;
+}
+
+const char* FrameLimiter::GetVSyncName(VSync mode) {
+    switch (mode) {
+    case VSyncOn: return "on";
+    case VSyncAdaptive: return "adaptive";
+    default: return "off";
+    }
+}
+
+bool FrameLimiter::VSyncFromName(const char* name, VSync& mode) {
+    if (std::strcmp(name, "off") == 0) {
+        mode = VSyncOff;
+    }
+    else if (std::strcmp(name, "on") == 0) {
+        mode = VSyncOn;
+    }
+    else if (std::strcmp(name, "adaptive") == 0) {
+        mode = VSyncAdaptive;
+    }
+    else {
+        return false;
+    }
+    return true;
+}
+
+void FrameLimiter::UpdateIdleState(Uint32 windowFlags) {
+    IdleState state = Active;
+    if (windowFlags & (SDL_WINDOW_HIDDEN | SDL_WINDOW_MINIMIZED)) {
+        state = Hidden;
+    }
+    else if (!(windowFlags & SDL_WINDOW_INPUT_FOCUS)) {
+        state = Unfocused;
+    }
+
+    if (state != m_idleState) {
+        m_idleState = state;
+        Reset();
+    }
+}
+
+double FrameLimiter::GetTargetFrameRate() const {
+    if (m_idleState != Active && m_idleFrameRate > 0.0) {
+        return m_frameCap > 0.0 ? std::fmin(m_frameCap, m_idleFrameRate) : m_idleFrameRate;
+    }
+    return m_frameCap;
+}
+
+void FrameLimiter::Reset() {
+    m_nextFrame = 0.0;
+}
+
+void FrameLimiter::Wait() {
+    HORSE_PROFILE_FUNCTION();
+
+    m_waitMs = 0.0;
+    double fps = GetTargetFrameRate();
+    if (fps <= 0.0) {
+        m_nextFrame = 0.0;
+        return;
+    }
+
+    double frameDuration = 1.0 / fps;
+    double now = FixedTimestep::Now();
+    if (m_nextFrame == 0.0 || now - m_nextFrame > frameDuration) {
+        // First capped frame, or more than a frame late: schedule from now
+        // rather than rushing frames to catch up
+        m_nextFrame = now + frameDuration;
+    }
+    else {
+        m_nextFrame += frameDuration;
+    }
+
+    double start = now;
+    double remainingMs = (m_nextFrame - now) * 1000.0;
+    while (remainingMs > m_delayMean + std::sqrt(m_delayVariance)) {
+        double before = FixedTimestep::Now();
+        SDL_Delay(1);
+        double delayMs = (FixedTimestep::Now() - before) * 1000.0;
+        remainingMs -= delayMs;
+
+        // Exponentially weighted, so timer resolution changes are picked up.
+        // A single preempted delay is clamped so it does not turn the margin
+        // into several milliseconds of spinning.
+        double delta = std::fmin(delayMs, m_delayMean * 4.0) - m_delayMean;
+        m_delayMean += 0.05 * delta;
+        m_delayVariance = 0.95 * (m_delayVariance + 0.05 * delta * delta);
+    }
+    while (FixedTimestep::Now() < m_nextFrame) {
+    }
+
+    m_waitMs = (FixedTimestep::Now() - start) * 1000.0;
+}
@@ -0,0 +1,52 @@
+#include "Frustum.hpp"
+#include <cmath>
+
+Frustum::Frustum() {
+}
+
+Frustum::Frustum(const glm::mat4& viewProjection) {
+    Set(viewProjection);
+}
+
+void Frustum::Set(const glm::mat4& viewProjection) {
+    // Rows of the matrix, glm is column major
+    glm::vec4 row[4];
+    for (int i = 0; i < 4; i++) {
+        row[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+    }
+
+    m_planes[Left] = row[3] + row[0];
+    m_planes[Right] = row[3] - row[0];
+    m_planes[Bottom] = row[3] + row[1];
+    m_planes[Top] = row[3] - row[1];
+    m_planes[Near] = row[3] + row[2];
+    m_planes[Far] = row[3] - row[2];
+
+    // Normalized so plane distances are in world units
+    for (glm::vec4& plane : m_planes) {
+        float length = std::sqrt(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+        plane = plane / length;
+    }
+}
+
+bool Frustum::IntersectsSphere(const glm::vec3& center, float radius) const {
+    for (const glm::vec4& plane : m_planes) {
+        if (plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w < -radius) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Frustum::IntersectsBox(const glm::vec3& min, const glm::vec3& max) const {
+    for (const glm::vec4& plane : m_planes) {
+        // Corner furthest along the plane normal
+        glm::vec3 corner(plane.x >= 0.0f ? max.x : min.x,
+                         plane.y >= 0.0f ? max.y : min.y,
+                         plane.z >= 0.0f ? max.z : min.z);
+        if (plane.x * corner.x + plane.y * corner.y + plane.z * corner.z + plane.w < 0.0f) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,199 @@
+#include "GpuMemory.hpp"
+#include "Profiler.hpp"
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+static double ToMiB(uint64_t bytes) {
+    return bytes / (1024.0 * 1024.0);
+}
+
+GpuMemory::GpuMemory() {
+}
+
+GpuMemory& GpuMemory::Get() {
+    static GpuMemory s_memory;
+    return s_memory;
+}
+
+const char* GpuMemory::GetCategoryName(Category category) {
+    switch (category) {
+    case VertexBuffers: return "vertex buffers";
+    case IndexBuffers: return "index buffers";
+    case UniformBuffers: return "uniform buffers";
+    case Textures: return "textures";
+    case RenderTargets: return "render targets";
+    default: return "unknown";
+    }
+}
+
+void GpuMemory::TrackBuffer(GLuint buffer, Category category, uint64_t bytes, const std::string& asset) {
+    Track(Buffer, buffer, category, bytes, asset);
+}
+
+void GpuMemory::TrackTexture(GLuint texture, Category category, uint64_t bytes, const std::string& asset) {
+    Track(Texture, texture, category, bytes, asset);
+}
+
+void GpuMemory::TrackRenderbuffer(GLuint renderbuffer, uint64_t bytes, const std::string& asset) {
+    Track(Renderbuffer, renderbuffer, RenderTargets, bytes, asset);
+}
+
+void GpuMemory::ReleaseBuffer(GLuint buffer) {
+    Release(Buffer, buffer);
+}
+
+void GpuMemory::ReleaseTexture(GLuint texture) {
+    Release(Texture, texture);
+}
+
+void GpuMemory::ReleaseRenderbuffer(GLuint renderbuffer) {
+    Release(Renderbuffer, renderbuffer);
+}
+
+void GpuMemory::Track(ObjectType type, GLuint name, Category category, uint64_t bytes, const std::string& asset) {
+    if (name == 0) {
+        return;
+    }
+
+    Release(type, name);
+    if (bytes == 0) {
+        return;
+    }
+
+    m_allocations[std::make_pair(static_cast<int>(type), name)] = { category, bytes, asset };
+    m_categoryBytes[category] += bytes;
+    m_categoryPeaks[category] = std::max(m_categoryPeaks[category], m_categoryBytes[category]);
+    m_total += bytes;
+    m_peak = std::max(m_peak, m_total);
+}
+
+void GpuMemory::Release(ObjectType type, GLuint name) {
+    auto it = m_allocations.find(std::make_pair(static_cast<int>(type), name));
+    if (it == m_allocations.end()) {
+        return;
+    }
+
+    m_categoryBytes[it->second.category] -= it->second.bytes;
+    m_total -= it->second.bytes;
+    m_allocations.erase(it);
+}
+
+void GpuMemory::ReportPool(const std::string& name, uint64_t capacity, uint64_t used) {
+    m_pools[name] = { capacity, used };
+}
+
+void GpuMemory::RemovePool(const std::string& name) {
+    m_pools.erase(name);
+}
+
+void GpuMemory::AddPressureCallback(const std::string& name, PressureCallback callback) {
+    m_callbacks.push_back(std::make_pair(name, callback));
+}
+
+void GpuMemory::CheckBudget() {
+    if (m_budget == 0) {
+        return;
+    }
+
+    uint64_t limit = static_cast<uint64_t>(m_budget * kPressureThreshold);
+    if (m_total <= limit) {
+        return;
+    }
+
+    HORSE_PROFILE_FUNCTION();
+    for (auto& callback : m_callbacks) {
+        uint64_t wanted = m_total - limit;
+        uint64_t freed = callback.second(wanted);
+        if (freed > 0) {
+            std::cout << "GPU memory over " << ToMiB(limit) << " MiB, " << callback.first << " released "
+                << ToMiB(freed) << " MiB" << std::endl;
+        }
+        if (m_total <= limit) {
+            return;
+        }
+    }
+}
+
+std::vector<std::pair<std::string, uint64_t>> GpuMemory::GetAssets() const {
+    std::map<std::string, uint64_t> assets;
+    for (const auto& allocation : m_allocations) {
+        assets[allocation.second.asset] += allocation.second.bytes;
+    }
+
+    std::vector<std::pair<std::string, uint64_t>> sorted(assets.begin(), assets.end());
+    std::sort(sorted.begin(), sorted.end(), [](const std::pair<std::string, uint64_t>& a, const std::pair<std::string, uint64_t>& b) {
+        return a.second > b.second;
+    });
+    return sorted;
+}
+
+uint64_t GpuMemory::QueryDeviceMemory() {
+    // Both report KiB. ATI only has free memory, the closest it gets.
+    GLint kib[4] = {};
+    if (GLAD_GL_NVX_gpu_memory_info) {
+        glGetIntegerv(GL_GPU_MEMORY_INFO_DEDICATED_VIDMEM_NVX, kib);
+    }
+    else if (GLAD_GL_ATI_meminfo) {
+        glGetIntegerv(GL_TEXTURE_FREE_MEMORY_ATI, kib);
+    }
+    return static_cast<uint64_t>(kib[0]) * 1024;
+}
+
+uint64_t GpuMemory::TextureBytes(int width, int height, int layers, int bytesPerTexel, int levels) {
+    uint64_t bytes = 0;
+    for (int level = 0; levels < 0 || level < levels; level++) {
+        int levelWidth = std::max(1, width >> level);
+        int levelHeight = std::max(1, height >> level);
+        bytes += static_cast<uint64_t>(levelWidth) * levelHeight * layers * bytesPerTexel;
+        if (levelWidth == 1 && levelHeight == 1) {
+            break;
+        }
+    }
+    return bytes;
+}
+
+std::string GpuMemory::GetSummary() const {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(1);
+    out << "VRAM " << ToMiB(m_total) << " MiB";
+    if (m_budget > 0) {
+        out << " / " << ToMiB(m_budget);
+    }
+    out << " (peak " << ToMiB(m_peak) << ")";
+    for (int category = 0; category < CategoryCount; category++) {
+        out << " | " << GetCategoryName(static_cast<Category>(category)) << " " << ToMiB(m_categoryBytes[category]);
+    }
+    return out.str();
+}
+
+void GpuMemory::Print(std::ostream& out) const {
+    // Formatted apart so the caller's stream keeps its own precision
+    std::ostringstream text;
+    text << std::fixed << std::setprecision(2);
+    text << "GPU memory: " << ToMiB(m_total) << " MiB, peak " << ToMiB(m_peak) << " MiB";
+    if (m_budget > 0) {
+        text << ", budget " << ToMiB(m_budget) << " MiB";
+    }
+    text << std::endl;
+
+    for (int category = 0; category < CategoryCount; category++) {
+        text << "  " << GetCategoryName(static_cast<Category>(category)) << ": " << ToMiB(m_categoryBytes[category])
+            << " MiB, peak " << ToMiB(m_categoryPeaks[category]) << " MiB" << std::endl;
+    }
+
+    // Unused capacity inside pools is allocated but holds nothing
+    for (const auto& pool : m_pools) {
+        double unused = pool.second.capacity > 0 ? 100.0 * (pool.second.capacity - pool.second.used) / pool.second.capacity : 0.0;
+        text << "  pool " << pool.first << ": " << ToMiB(pool.second.used) << " of " << ToMiB(pool.second.capacity)
+            << " MiB used, " << std::setprecision(1) << unused << "% unused" << std::setprecision(2) << std::endl;
+    }
+
+    const size_t kLargestAssets = 10;
+    std::vector<std::pair<std::string, uint64_t>> assets = GetAssets();
+    for (size_t i = 0; i < assets.size() && i < kLargestAssets; i++) {
+        text << "  " << (assets[i].first.empty() ? "(unnamed)" : assets[i].first) << ": " << ToMiB(assets[i].second) << " MiB" << std::endl;
+    }
+    out << text.str();
+}
@@ -0,0 +1,216 @@
+#include "GpuProfiler.hpp"
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+static const int kQueriesPerFrame = GpuProfiler::kMaxScopesPerFrame * 2 + 2;
+
+GpuProfiler::GpuProfiler() {
+    m_frameStats.name = "Frame";
+}
+
+void GpuProfiler::Initialize() {
+    if (m_initialized) {
+        return;
+    }
+
+    for (auto& slot : m_frames) {
+        glGenQueries(kQueriesPerFrame, slot.queries);
+        slot.scopes.reserve(kMaxScopesPerFrame);
+    }
+    m_initialized = true;
+}
+
+void GpuProfiler::CleanUp() {
+    if (!m_initialized) {
+        return;
+    }
+
+    for (auto& slot : m_frames) {
+        glDeleteQueries(kQueriesPerFrame, slot.queries);
+        slot.pending = false;
+    }
+    CloseCsv();
+    m_initialized = false;
+}
+
+void GpuProfiler::BeginFrame() {
+    if (!m_initialized) {
+        return;
+    }
+
+    // This slot was last used kFrameLatency frames ago, collect its results
+    FrameSlot& slot = m_frames[m_currentFrame];
+    if (slot.pending) {
+        ResolveFrame(slot);
+    }
+
+    slot.usedQueries = 0;
+    slot.scopes.clear();
+    slot.frameNumber = m_frameNumber;
+    m_openScopes.clear();
+
+    glQueryCounter(slot.queries[slot.usedQueries++], GL_TIMESTAMP);
+    m_inFrame = true;
+}
+
+void GpuProfiler::EndFrame() {
+    if (!m_initialized || !m_inFrame) {
+        return;
+    }
+
+    while (!m_openScopes.empty()) {
+        EndScope();
+    }
+
+    FrameSlot& slot = m_frames[m_currentFrame];
+    glQueryCounter(slot.queries[slot.usedQueries++], GL_TIMESTAMP);
+    slot.pending = true;
+
+    m_inFrame = false;
+    m_currentFrame = (m_currentFrame + 1) % kFrameLatency;
+    m_frameNumber++;
+}
+
+void GpuProfiler::BeginScope(const std::string& name) {
+    FrameSlot& slot = m_frames[m_currentFrame];
+
+    // Keep one query in reserve for the end of frame timestamp
+    if (!m_inFrame || slot.usedQueries + 3 > kQueriesPerFrame) {
+        m_openScopes.push_back(-1);
+        return;
+    }
+
+    ScopeRecord record;
+    record.depth = static_cast<int>(m_openScopes.size());
+    record.statIndex = GetStatIndex(name, record.depth);
+    record.beginQuery = slot.usedQueries++;
+    record.endQuery = -1;
+    glQueryCounter(slot.queries[record.beginQuery], GL_TIMESTAMP);
+
+    m_openScopes.push_back(static_cast<int>(slot.scopes.size()));
+    slot.scopes.push_back(record);
+}
+
+void GpuProfiler::EndScope() {
+    if (m_openScopes.empty()) {
+        return;
+    }
+
+    int index = m_openScopes.back();
+    m_openScopes.pop_back();
+    if (index < 0) {
+        return;
+    }
+
+    FrameSlot& slot = m_frames[m_currentFrame];
+    ScopeRecord& record = slot.scopes[index];
+    record.endQuery = slot.usedQueries++;
+    glQueryCounter(slot.queries[record.endQuery], GL_TIMESTAMP);
+}
+
+const GpuProfiler::ScopeStats* GpuProfiler::GetScope(const std::string& name) const {
+    auto it = m_statLookup.find(name);
+    if (it == m_statLookup.end()) {
+        return nullptr;
+    }
+    return &m_stats[it->second];
+}
+
+std::string GpuProfiler::GetSummary() const {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(2);
+    out << "GPU " << m_frameStats.averageMs << " ms";
+    for (const auto& stats : m_stats) {
+        out << " | " << stats.name << " " << stats.averageMs;
+    }
+    return out.str();
+}
+
+bool GpuProfiler::OpenCsv(const std::string& filepath) {
+    CloseCsv();
+    m_csv.open(filepath, std::ios::out | std::ios::trunc);
+    if (!m_csv.is_open()) {
+        std::cerr << "Could not open GPU profile output: " << filepath << std::endl;
+        return false;
+    }
+
+    m_csv << "frame,scope,depth,ms\n";
+    return true;
+}
+
+void GpuProfiler::CloseCsv() {
+    if (m_csv.is_open()) {
+        m_csv.close();
+    }
+}
+
+void GpuProfiler::ResolveFrame(FrameSlot& slot) {
+    slot.pending = false;
+
+    // Queries complete in order, so the end of frame timestamp being ready
+    // means every query in the slot is
+    GLint available = 0;
+    glGetQueryObjectiv(slot.queries[slot.usedQueries - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available) {
+        m_droppedFrames++;
+        return;
+    }
+
+    GLuint64 timestamps[kQueriesPerFrame];
+    for (int i = 0; i < slot.usedQueries; i++) {
+        glGetQueryObjectui64v(slot.queries[i], GL_QUERY_RESULT, &timestamps[i]);
+    }
+
+    double frameMs = (timestamps[slot.usedQueries - 1] - timestamps[0]) / 1.0e6;
+    Accumulate(m_frameStats, frameMs);
+    if (m_csv.is_open()) {
+        m_csv << slot.frameNumber << "," << m_frameStats.name << ",-1," << frameMs << "\n";
+    }
+
+    for (const auto& record : slot.scopes) {
+        if (record.endQuery < 0) {
+            continue;
+        }
+
+        double ms = (timestamps[record.endQuery] - timestamps[record.beginQuery]) / 1.0e6;
+        ScopeStats& stats = m_stats[record.statIndex];
+        Accumulate(stats, ms);
+
+        if (m_csv.is_open()) {
+            m_csv << slot.frameNumber << "," << stats.name << "," << record.depth << "," << ms << "\n";
+        }
+    }
+}
+
+void GpuProfiler::Accumulate(ScopeStats& stats, double ms) {
+    stats.lastMs = ms;
+    if (stats.samples == 0) {
+        stats.averageMs = ms;
+        stats.minMs = ms;
+        stats.maxMs = ms;
+    }
+    else {
+        // Exponential moving average, roughly the last 20 frames
+        stats.averageMs += (ms - stats.averageMs) * 0.05;
+        stats.minMs = ms < stats.minMs ? ms : stats.minMs;
+        stats.maxMs = ms > stats.maxMs ? ms : stats.maxMs;
+    }
+    stats.samples++;
+}
+
+int GpuProfiler::GetStatIndex(const std::string& name, int depth) {
+    auto it = m_statLookup.find(name);
+    if (it != m_statLookup.end()) {
+        return it->second;
+    }
+
+    ScopeStats stats;
+    stats.name = name;
+    stats.depth = depth;
+    m_stats.push_back(stats);
+
+    int index = static_cast<int>(m_stats.size()) - 1;
+    m_statLookup[name] = index;
+    return index;
+}
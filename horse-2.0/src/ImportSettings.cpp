@@ -0,0 +1,120 @@
+#include "ImportSettings.hpp"
+#include "Profiler.hpp"
+#include <assimp/postprocess.h>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+// Post-processing steps in the order Assimp runs them when given together.
+// Assimp splits large meshes in two passes, by triangle count before
+// normals are generated and by vertex count after vertices are joined. The
+// flag runs both at once, so it goes after JoinIdenticalVertices where the
+// vertex limit sees the same meshes. Normals are then generated before the
+// triangle split and stay smooth across the seams it makes.
+struct ImportStep {
+    unsigned int flag;
+    const char* name;
+};
+
+static const ImportStep kImportSteps[] = {
+    { aiProcess_RemoveRedundantMaterials, "RemoveRedundantMaterials" },
+    { aiProcess_OptimizeGraph, "OptimizeGraph" },
+    { aiProcess_Triangulate, "Triangulate" },
+    { aiProcess_OptimizeMeshes, "OptimizeMeshes" },
+    { aiProcess_GenSmoothNormals, "GenSmoothNormals" },
+    { aiProcess_JoinIdenticalVertices, "JoinIdenticalVertices" },
+    { aiProcess_SplitLargeMeshes, "SplitLargeMeshes" },
+    { aiProcess_ImproveCacheLocality, "ImproveCacheLocality" },
+    { aiProcess_FlipUVs, "FlipUVs" },
+};
+
+ImportSettings ImportSettings::Preview() {
+    return ImportSettings();
+}
+
+ImportSettings ImportSettings::Production() {
+    ImportSettings settings;
+    settings.joinIdenticalVertices = true;
+    settings.improveCacheLocality = true;
+    settings.optimizeMeshes = true;
+    settings.optimizeGraph = true;
+    settings.splitLargeMeshes = true;
+    settings.removeRedundantMaterials = true;
+    return settings;
+}
+
+bool ImportSettings::FromName(const std::string& name, ImportSettings& settings) {
+    if (name == "preview") {
+        settings = Preview();
+        return true;
+    }
+    if (name == "production") {
+        settings = Production();
+        return true;
+    }
+    return false;
+}
+
+unsigned int ImportSettings::GetFlags() const {
+    unsigned int flags = aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs;
+    if (joinIdenticalVertices) flags |= aiProcess_JoinIdenticalVertices;
+    if (improveCacheLocality) flags |= aiProcess_ImproveCacheLocality;
+    if (optimizeMeshes) flags |= aiProcess_OptimizeMeshes;
+    if (optimizeGraph) flags |= aiProcess_OptimizeGraph;
+    if (splitLargeMeshes) flags |= aiProcess_SplitLargeMeshes;
+    if (removeRedundantMaterials) flags |= aiProcess_RemoveRedundantMaterials;
+    return flags;
+}
+
+const aiScene* ImportSettings::Import(Assimp::Importer& importer, const std::string& filepath) const {
+    HORSE_PROFILE_FUNCTION();
+
+    using Clock = std::chrono::high_resolution_clock;
+    auto elapsedMs = [](Clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    };
+
+    std::ostringstream timings;
+    timings << std::fixed << std::setprecision(2);
+    Clock::time_point importStart = Clock::now();
+
+    if (splitLargeMeshes) {
+        importer.SetPropertyInteger(AI_CONFIG_PP_SLM_VERTEX_LIMIT, splitVertexLimit);
+        importer.SetPropertyInteger(AI_CONFIG_PP_SLM_TRIANGLE_LIMIT, splitTriangleLimit);
+    }
+
+    const aiScene* scene = importer.ReadFile(filepath, 0);
+    timings << "read " << elapsedMs(importStart) << " ms";
+
+    // One step at a time, close to passing every flag to ReadFile (see
+    // kImportSteps for where it differs)
+    unsigned int flags = GetFlags();
+    for (const ImportStep& step : kImportSteps) {
+        if (!scene || !(flags & step.flag)) {
+            continue;
+        }
+        Clock::time_point stepStart = Clock::now();
+        scene = importer.ApplyPostProcessing(step.flag);
+        timings << ", " << step.name << " " << elapsedMs(stepStart) << " ms";
+    }
+
+    if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
+        std::cout << "Error! Assimp: " << importer.GetErrorString() << std::endl;
+        return nullptr;
+    }
+
+    if (printTimings) {
+        // Built first so lines of models imported in parallel do not interleave
+        unsigned int vertices = 0;
+        for (unsigned int i = 0; i < scene->mNumMeshes; i++) {
+            vertices += scene->mMeshes[i]->mNumVertices;
+        }
+        std::ostringstream line;
+        line << std::fixed << std::setprecision(2) << "Imported " << filepath << " in " << elapsedMs(importStart)
+            << " ms, " << scene->mNumMeshes << " meshes, " << scene->mNumMaterials << " materials, " << vertices
+            << " vertices (" << timings.str() << ")\n";
+        std::cout << line.str() << std::flush;
+    }
+    return scene;
+}
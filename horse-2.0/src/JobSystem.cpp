@@ -0,0 +1,357 @@
+#include "JobSystem.hpp"
+#include "Profiler.hpp"
+#include <chrono>
+#include <iostream>
+#include <string>
+
+// Index of the worker running on this thread, or kNoWorker for threads that
+// were never registered with the job system.
+static const unsigned int kNoWorker = ~0u;
+static thread_local unsigned int t_workerIndex = kNoWorker;
+
+// Work-stealing queue
+WorkStealingQueue::WorkStealingQueue() : m_jobs(new std::atomic<Job*>[kCapacity]) {
+    for (int64_t i = 0; i < kCapacity; i++) {
+        m_jobs[i].store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+bool WorkStealingQueue::Push(Job* job) {
+    int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+    int64_t top = m_top.load(std::memory_order_acquire);
+    if (bottom - top >= kCapacity) {
+        return false;
+    }
+
+    m_jobs[bottom & (kCapacity - 1)].store(job, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    m_bottom.store(bottom + 1, std::memory_order_relaxed);
+    return true;
+}
+
+Job* WorkStealingQueue::Pop() {
+    int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+    m_bottom.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t top = m_top.load(std::memory_order_relaxed);
+
+    if (top > bottom) {
+        // Queue was empty
+        m_bottom.store(bottom + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    Job* job = m_jobs[bottom & (kCapacity - 1)].load(std::memory_order_relaxed);
+    if (top == bottom) {
+        // Last job, race against stealers for it
+        if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            job = nullptr;
+        }
+        m_bottom.store(bottom + 1, std::memory_order_relaxed);
+    }
+    return job;
+}
+
+Job* WorkStealingQueue::Steal() {
+    int64_t top = m_top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t bottom = m_bottom.load(std::memory_order_acquire);
+
+    if (top >= bottom) {
+        return nullptr;
+    }
+
+    Job* job = m_jobs[top & (kCapacity - 1)].load(std::memory_order_relaxed);
+    if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+        // Lost the race to another stealer or the owner
+        return nullptr;
+    }
+    return job;
+}
+
+int64_t WorkStealingQueue::Size() const {
+    int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+    int64_t top = m_top.load(std::memory_order_relaxed);
+    return bottom > top ? bottom - top : 0;
+}
+
+// Job system
+JobSystem::JobSystem() {
+}
+
+JobSystem::~JobSystem() {
+    Shutdown();
+}
+
+void JobSystem::Initialize(unsigned int workerCount) {
+    if (IsInitialized()) {
+        return;
+    }
+
+    if (workerCount == 0) {
+        unsigned int cores = std::thread::hardware_concurrency();
+        workerCount = cores > 1 ? cores - 1 : 1;
+    }
+
+    // Worker 0 is the calling thread
+    unsigned int queueCount = workerCount + 1;
+    for (unsigned int i = 0; i < queueCount; i++) {
+        m_queues.push_back(std::make_unique<WorkStealingQueue>());
+        m_jobPools.push_back(std::unique_ptr<Job[]>(new Job[kMaxJobsPerWorker]));
+        m_allocatedJobs.push_back(0);
+    }
+
+    t_workerIndex = 0;
+    m_running = true;
+    for (unsigned int i = 1; i < queueCount; i++) {
+        m_threads.emplace_back(&JobSystem::WorkerLoop, this, i);
+    }
+}
+
+void JobSystem::Shutdown() {
+    if (!IsInitialized()) {
+        return;
+    }
+
+    m_running = false;
+    m_wakeCondition.notify_all();
+    for (auto& thread : m_threads) {
+        thread.join();
+    }
+
+    m_threads.clear();
+
+    // Finish what the background threads left behind so no counter is
+    // left waiting
+    BackgroundJob job;
+    while (PopBackgroundJob(job)) {
+        ExecuteBackground(job);
+    }
+
+    m_queues.clear();
+    m_jobPools.clear();
+    m_allocatedJobs.clear();
+    m_pendingJobs = 0;
+    t_workerIndex = kNoWorker;
+}
+
+void JobSystem::Run(const std::function<void()>& function, JobCounter* counter, JobCounter* dependency) {
+    if (counter) {
+        counter->value.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    unsigned int index = t_workerIndex;
+    if (!IsInitialized() || index == kNoWorker) {
+        // Not called from a worker: run inline rather than racing the owner of a queue
+        if (dependency) {
+            Wait(dependency);
+        }
+        function();
+        if (counter) {
+            counter->value.fetch_sub(1, std::memory_order_release);
+        }
+        return;
+    }
+
+    Job* job = AllocateJob();
+    job->function = function;
+    job->counter = counter;
+    job->dependency = dependency;
+
+    if (!m_queues[index]->Push(job)) {
+        // Queue full, run it here instead
+        Execute(job);
+        return;
+    }
+
+    m_pendingJobs.fetch_add(1, std::memory_order_release);
+    m_wakeCondition.notify_one();
+}
+
+void JobSystem::RunBackground(const std::function<void()>& function, JobCounter* counter) {
+    if (counter) {
+        counter->value.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    BackgroundJob job;
+    job.function = function;
+    job.counter = counter;
+    if (m_threads.empty()) {
+        // No background threads to hand it to
+        ExecuteBackground(job);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_backgroundMutex);
+        m_backgroundJobs.push_back(std::move(job));
+    }
+    m_pendingBackgroundJobs.fetch_add(1, std::memory_order_release);
+    m_wakeCondition.notify_one();
+}
+
+void JobSystem::Wait(JobCounter* counter) {
+    // Help out with other jobs while the counter drains
+    while (counter->value.load(std::memory_order_acquire) > 0) {
+        Job* job = (IsInitialized() && t_workerIndex != kNoWorker) ? GetJob() : nullptr;
+        if (job) {
+            Execute(job);
+        }
+        else {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void JobSystem::ParallelFor(uint32_t count, uint32_t batchSize, const std::function<void(uint32_t begin, uint32_t end)>& func) {
+    if (count == 0) {
+        return;
+    }
+    if (batchSize == 0) {
+        batchSize = 1;
+    }
+
+    // Keep the batch count well under the per-worker job pool, so a large
+    // loop does not have to wait for slots to free up
+    const uint32_t maxBatches = kMaxJobsPerWorker / 2;
+    if ((count + batchSize - 1) / batchSize > maxBatches) {
+        batchSize = (count + maxBatches - 1) / maxBatches;
+    }
+
+    JobCounter counter;
+    for (uint32_t begin = 0; begin < count; begin += batchSize) {
+        uint32_t end = begin + batchSize < count ? begin + batchSize : count;
+        Run([&func, begin, end]() { func(begin, end); }, &counter);
+    }
+    Wait(&counter);
+}
+
+double JobSystem::MeasureSchedulingOverhead(uint32_t jobCount) {
+    const uint32_t batch = kMaxJobsPerWorker / 2;
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t submitted = 0; submitted < jobCount; submitted += batch) {
+        JobCounter counter;
+        uint32_t n = jobCount - submitted < batch ? jobCount - submitted : batch;
+        for (uint32_t i = 0; i < n; i++) {
+            Run([]() {}, &counter);
+        }
+        Wait(&counter);
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    double ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+    return jobCount > 0 ? ns / jobCount : 0.0;
+}
+
+Job* JobSystem::AllocateJob() {
+    unsigned int index = t_workerIndex;
+    for (;;) {
+        // Only this worker allocates from its pool, other threads merely
+        // clear busy once a job finishes
+        for (uint32_t i = 0; i < kMaxJobsPerWorker; i++) {
+            uint32_t slot = m_allocatedJobs[index]++ & (kMaxJobsPerWorker - 1);
+            Job* job = &m_jobPools[index][slot];
+            if (!job->busy.load(std::memory_order_acquire)) {
+                job->busy.store(true, std::memory_order_relaxed);
+                return job;
+            }
+        }
+
+        Job* other = GetJob();
+        if (other) {
+            Execute(other);
+        }
+        else {
+            std::this_thread::yield();
+        }
+    }
+}
+
+Job* JobSystem::GetJob() {
+    unsigned int index = t_workerIndex;
+    Job* job = m_queues[index]->Pop();
+
+    if (!job) {
+        // Steal from the other workers, starting with our neighbour
+        unsigned int queueCount = static_cast<unsigned int>(m_queues.size());
+        for (unsigned int i = 1; i < queueCount && !job; i++) {
+            job = m_queues[(index + i) % queueCount]->Steal();
+        }
+    }
+
+    if (!job) {
+        return nullptr;
+    }
+    m_pendingJobs.fetch_sub(1, std::memory_order_acquire);
+
+    // Dependencies not done yet, put the job back for later
+    if (job->dependency && job->dependency->value.load(std::memory_order_acquire) > 0) {
+        if (m_queues[index]->Push(job)) {
+            m_pendingJobs.fetch_add(1, std::memory_order_release);
+            return nullptr;
+        }
+        Wait(job->dependency);
+    }
+    return job;
+}
+
+void JobSystem::Execute(Job* job) {
+    // Run from a local so nothing the job does can touch its own slot
+    std::function<void()> function = std::move(job->function);
+    JobCounter* counter = job->counter;
+    job->function = nullptr;
+    function();
+
+    job->busy.store(false, std::memory_order_release);
+    if (counter) {
+        counter->value.fetch_sub(1, std::memory_order_release);
+    }
+}
+
+bool JobSystem::PopBackgroundJob(BackgroundJob& job) {
+    std::lock_guard<std::mutex> lock(m_backgroundMutex);
+    if (m_backgroundJobs.empty()) {
+        return false;
+    }
+    job = std::move(m_backgroundJobs.front());
+    m_backgroundJobs.pop_front();
+    m_pendingBackgroundJobs.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
+
+void JobSystem::ExecuteBackground(BackgroundJob& job) {
+    job.function();
+    job.function = nullptr;
+    if (job.counter) {
+        job.counter->value.fetch_sub(1, std::memory_order_release);
+    }
+}
+
+void JobSystem::WorkerLoop(unsigned int index) {
+    t_workerIndex = index;
+    HORSE_PROFILE_THREAD("Worker " + std::to_string(index));
+
+    while (m_running) {
+        Job* job = GetJob();
+        if (job) {
+            Execute(job);
+            continue;
+        }
+
+        // Frame jobs first, long jobs only once those run out
+        BackgroundJob background;
+        if (PopBackgroundJob(background)) {
+            ExecuteBackground(background);
+            continue;
+        }
+
+        // Nothing to do, sleep until new work is submitted. The timeout covers
+        // a wake-up racing the predicate check.
+        std::unique_lock<std::mutex> lock(m_wakeMutex);
+        m_wakeCondition.wait_for(lock, std::chrono::milliseconds(1), [this]() {
+            return m_pendingJobs.load(std::memory_order_acquire) > 0 ||
+                m_pendingBackgroundJobs.load(std::memory_order_acquire) > 0 || !m_running;
+        });
+    }
+}
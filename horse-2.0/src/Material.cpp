@@ -0,0 +1,184 @@
+#include "Material.hpp"
+#include "GpuMemory.hpp"
+#include "Profiler.hpp"
+#include "RenderStats.hpp"
+#include <algorithm>
+#include <cstring>
+
+static_assert(sizeof(MaterialBlock) == 32, "MaterialBlock must match the std140 block");
+
+Material::Material(const std::string& name, uint32_t slot)
+    : m_name(name), m_slot(slot) {
+}
+
+void Material::SetColor(const glm::vec3& color) {
+    m_color = color;
+    m_dirty = true;
+}
+
+void Material::SetSpecular(float strength, float shininess) {
+    m_specularStrength = strength;
+    m_shininess = shininess;
+    m_dirty = true;
+}
+
+void Material::SetTexture(Texture* texture) {
+    m_texture = texture;
+    m_dirty = true;
+}
+
+MaterialLibrary::MaterialLibrary() {
+}
+
+Material* MaterialLibrary::Create(const std::string& name) {
+    uint32_t slot = static_cast<uint32_t>(m_materials.size());
+    m_materials.push_back(std::unique_ptr<Material>(new Material(name, slot)));
+    return m_materials.back().get();
+}
+
+Material* MaterialLibrary::GetDefault(const glm::vec3& color, Texture* texture) {
+    auto key = std::make_tuple(color.x, color.y, color.z, texture);
+    auto it = m_defaults.find(key);
+    if (it != m_defaults.end()) {
+        return it->second;
+    }
+
+    Material* material = Create("default");
+    material->SetColor(color);
+    material->SetTexture(texture);
+    m_defaults[key] = material;
+    return material;
+}
+
+void MaterialLibrary::PrepareShader(Shader* shader) {
+    if (std::find(m_preparedPrograms.begin(), m_preparedPrograms.end(), shader->shaderProgram) != m_preparedPrograms.end()) {
+        return;
+    }
+
+    GLuint blockIndex = glGetUniformBlockIndex(shader->shaderProgram, "MaterialBlock");
+    if (blockIndex != GL_INVALID_INDEX) {
+        glUniformBlockBinding(shader->shaderProgram, blockIndex, kBindingPoint);
+    }
+    shader->useProgram();
+    shader->setInt("textureSampler", kTextureUnit);
+    shader->setInt("u_textureArray", kArrayTextureUnit);
+    m_preparedPrograms.push_back(shader->shaderProgram);
+}
+
+void MaterialLibrary::Reserve(size_t count) {
+    if (m_stride == 0) {
+        GLint alignment = 256;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+        m_stride = (sizeof(MaterialBlock) + alignment - 1) / alignment * alignment;
+    }
+
+    m_capacity = std::max<size_t>(64, count);
+    m_staging.assign(m_capacity * m_stride, 0);
+    if (m_buffer == 0) {
+        glGenBuffers(1, &m_buffer);
+    }
+    glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+    glBufferData(GL_UNIFORM_BUFFER, m_staging.size(), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    GpuMemory::Get().TrackBuffer(m_buffer, GpuMemory::UniformBuffers, m_staging.size(), "materials");
+
+    // New storage, every slot has to be written again
+    for (auto& material : m_materials) {
+        material->m_dirty = true;
+    }
+    m_bound = nullptr;
+}
+
+void MaterialLibrary::Upload() {
+    HORSE_PROFILE_FUNCTION();
+
+    if (m_materials.size() > m_capacity) {
+        Reserve(m_materials.size() * 2);
+    }
+
+    // One upload covering every changed slot
+    size_t first = m_materials.size();
+    size_t last = 0;
+    for (auto& material : m_materials) {
+        if (!material->m_dirty) {
+            continue;
+        }
+
+        MaterialBlock block;
+        block.baseColor = glm::vec4(material->m_color, 1.0f);
+        block.params = glm::vec4(material->m_specularStrength, material->m_shininess, kNoTexture, 0.0f);
+        if (material->m_texture && material->m_texture->GetArray()) {
+            block.params.z = kArrayTexture;
+            block.params.w = static_cast<float>(material->m_texture->GetLayer());
+        }
+        else if (material->m_texture) {
+            block.params.z = kStandaloneTexture;
+        }
+        std::memcpy(m_staging.data() + material->m_slot * m_stride, &block, sizeof(block));
+
+        first = std::min<size_t>(first, material->m_slot);
+        last = std::max<size_t>(last, material->m_slot);
+        material->m_dirty = false;
+    }
+
+    if (first > last) {
+        return;
+    }
+
+    size_t offset = first * m_stride;
+    size_t size = (last - first) * m_stride + sizeof(MaterialBlock);
+    glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+    glBufferSubData(GL_UNIFORM_BUFFER, offset, size, m_staging.data() + offset);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    RenderStats::Current().CountBufferUpload(size);
+
+    // Slots are padded to the offset alignment, the padding counts as unused
+    GpuMemory::Get().ReportPool("material slots", m_staging.size(), m_materials.size() * sizeof(MaterialBlock));
+}
+
+void MaterialLibrary::Bind(const Material* material) {
+    if (material == m_bound) {
+        return;
+    }
+
+    glBindBufferRange(GL_UNIFORM_BUFFER, kBindingPoint, m_buffer, material->m_slot * m_stride, sizeof(MaterialBlock));
+    m_bound = material;
+    RenderStats::Current().CountMaterialBind();
+
+    Texture* texture = material->m_texture;
+    if (!texture) {
+        return;
+    }
+    TextureArray* array = texture->GetArray();
+    if (array && array != m_boundArray) {
+        array->Bind(kArrayTextureUnit);
+        m_boundArray = array;
+        RenderStats::Current().CountTextureBind();
+    }
+    else if (!array && texture != m_boundTexture) {
+        texture->Bind(kTextureUnit);
+        m_boundTexture = texture;
+        RenderStats::Current().CountTextureBind();
+    }
+}
+
+void MaterialLibrary::ResetBindings() {
+    m_bound = nullptr;
+    m_boundTexture = nullptr;
+    m_boundArray = nullptr;
+}
+
+void MaterialLibrary::CleanUp() {
+    if (m_buffer != 0) {
+        glDeleteBuffers(1, &m_buffer);
+        GpuMemory::Get().ReleaseBuffer(m_buffer);
+        GpuMemory::Get().RemovePool("material slots");
+        m_buffer = 0;
+    }
+    m_materials.clear();
+    m_defaults.clear();
+    m_preparedPrograms.clear();
+    m_staging.clear();
+    m_capacity = 0;
+    ResetBindings();
+}
@@ -1,41 +1,104 @@
 #include "Mesh3D.hpp"
+#include "GpuMemory.hpp"
+#include "Profiler.hpp"
+#include "RenderStats.hpp"
+#include "TextureAtlas.hpp"
+#include <algorithm>
+#include <cmath>
+
+static TextureAtlas* s_textureAtlas = nullptr;
+
+// Atlas entries cannot repeat, only meshes sampling inside the image can
+// have their UVs remapped onto a page
+static bool TexCoordsInUnitSquare(const std::vector<Vertex>& vertices) {
+    const float epsilon = 1e-3f;
+    for (const Vertex& vertex : vertices) {
+        if (vertex.TexCoords.x < -epsilon || vertex.TexCoords.x > 1.0f + epsilon ||
+            vertex.TexCoords.y < -epsilon || vertex.TexCoords.y > 1.0f + epsilon) {
+            return false;
+        }
+    }
+    return true;
+}
 
 // Setup functions
-Mesh3D::Mesh3D() {
+Mesh3D::Mesh3D(EntityRegistry& registry, Entity entity)
+    : m_registry(&registry), m_entity(entity) {
+}
+
+void Mesh3D::SetTextureAtlas(TextureAtlas* atlas) {
+    s_textureAtlas = atlas;
 }
 
 // Assimp
-bool Mesh3D::LoadModel(const std::string& filepath) {
+bool Mesh3D::LoadModel(const std::string& filepath, const ImportSettings& settings) {
+    HORSE_PROFILE_FUNCTION();
+
     Assimp::Importer importer;
+    const aiScene* scene = settings.Import(importer, filepath);
+    if (!scene) {
+        return false;
+    }
 
-    const aiScene* scene = importer.ReadFile(filepath,
-        aiProcess_Triangulate |
-        aiProcess_GenSmoothNormals |
-        aiProcess_FlipUVs);
+    std::map<unsigned int, ImportGroup> groups;
+    ProcessNode(scene->mRootNode, scene, glm::mat4(1.0f), groups);
+
+    // One submesh per material, all sharing the vertex and index buffers
+    for (auto& entry : groups) {
+        ImportGroup& group = entry.second;
+        Submesh submesh;
+        submesh.indexOffset = static_cast<GLuint>(m_processedIndices.size());
+        submesh.indexCount = static_cast<GLsizei>(group.indices.size());
+        submesh.baseVertex = static_cast<GLint>(m_processedVertices.size());
+        if (entry.first < scene->mNumMaterials) {
+            ProcessMaterial(scene->mMaterials[entry.first], group.vertices, submesh);
+        }
 
-    // Error checking
-    if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
-        std::cout << "Error! Assimp: " << importer.GetErrorString() << std::endl;
-        return false;
+        m_processedVertices.insert(m_processedVertices.end(), group.vertices.begin(), group.vertices.end());
+        m_processedIndices.insert(m_processedIndices.end(), group.indices.begin(), group.indices.end());
+        m_submeshes.push_back(submesh);
     }
 
-    ProcessNode(scene->mRootNode, scene);
+    // The first material stands for the model in GetColor and GetTexture
+    if (!m_submeshes.empty()) {
+        m_color = m_submeshes[0].color;
+        m_texture = m_submeshes[0].texture;
+    }
+    return true;
+}
+
+// Assimp matrices are row major, glm's columns are Assimp's columns
+static glm::mat4 ToMat4(const aiMatrix4x4& m) {
+    glm::mat4 result;
+    result[0] = glm::vec4(m.a1, m.b1, m.c1, m.d1);
+    result[1] = glm::vec4(m.a2, m.b2, m.c2, m.d2);
+    result[2] = glm::vec4(m.a3, m.b3, m.c3, m.d3);
+    result[3] = glm::vec4(m.a4, m.b4, m.c4, m.d4);
+    return result;
 }
 
-void Mesh3D::ProcessNode(aiNode* node, const aiScene* scene) {
+void Mesh3D::ProcessNode(aiNode* node, const aiScene* scene, const glm::mat4& parentTransform, std::map<unsigned int, ImportGroup>& groups) {
+    // The same placement OptimizeGraph would bake into the vertices, so
+    // imports with and without it match
+    glm::mat4 transform = parentTransform * ToMat4(node->mTransformation);
     for (unsigned int i = 0; i < node->mNumMeshes; i++) {
         aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-        ProcessMesh(mesh, scene);
+        ProcessMesh(mesh, transform, groups);
     }
 
     for (unsigned int i = 0; i < node->mNumChildren; i++) {
-        ProcessNode(node->mChildren[i], scene);
+        ProcessNode(node->mChildren[i], scene, transform, groups);
     }
 }
 
-void Mesh3D::ProcessMesh(aiMesh* mesh, const aiScene* scene) {
-    std::vector<Vertex> vertices;
-    std::vector<GLuint> indices;
+void Mesh3D::ProcessMesh(aiMesh* mesh, const glm::mat4& transform, std::map<unsigned int, ImportGroup>& groups) {
+    ImportGroup& group = groups[mesh->mMaterialIndex];
+    std::vector<Vertex>& vertices = group.vertices;
+    std::vector<GLuint>& indices = group.indices;
+
+    // Indices of this aiMesh follow the vertices already in the group
+    GLuint firstVertex = static_cast<GLuint>(vertices.size());
+    glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(transform)));
 
     // Process vertices
     for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
@@ -45,12 +108,14 @@ void Mesh3D::ProcessMesh(aiMesh* mesh, const aiScene* scene) {
         vertex.Position.x = mesh->mVertices[i].x;
         vertex.Position.y = mesh->mVertices[i].y;
         vertex.Position.z = mesh->mVertices[i].z;
+        vertex.Position = glm::vec3(transform * glm::vec4(vertex.Position, 1.0f));
 
         // Normals
         if (mesh->HasNormals()) {
             vertex.Normal.x = mesh->mNormals[i].x;
             vertex.Normal.y = mesh->mNormals[i].y;
             vertex.Normal.z = mesh->mNormals[i].z;
+            vertex.Normal = glm::normalize(normalMatrix * vertex.Normal);
         }
         else {
             vertex.Normal = glm::vec3(0.0f, 0.0f, 1.0f); // Default normal
@@ -73,41 +138,53 @@ void Mesh3D::ProcessMesh(aiMesh* mesh, const aiScene* scene) {
     for (unsigned int i = 0; i < mesh->mNumFaces; i++) {
         aiFace face = mesh->mFaces[i];
         for (unsigned int j = 0; j < face.mNumIndices; j++) {
-            indices.push_back(face.mIndices[j]);
+            indices.push_back(firstVertex + face.mIndices[j]);
         }
     }
+}
 
-    // Process materials
-    if (mesh->mMaterialIndex >= 0) {
-        aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
+void Mesh3D::ProcessMaterial(const aiMaterial* material, std::vector<Vertex>& vertices, Submesh& submesh) {
+    // Load diffuse color (Kd)
+    aiColor3D diffuseColor(1.0f, 1.0f, 1.0f); 
+    if (material->Get(AI_MATKEY_COLOR_DIFFUSE, diffuseColor) == AI_SUCCESS) {
+        submesh.color = glm::vec3(diffuseColor.r, diffuseColor.g, diffuseColor.b);
+    }
 
-        // Load diffuse color (Kd)
-        aiColor3D diffuseColor(1.0f, 1.0f, 1.0f); 
-        if (material->Get(AI_MATKEY_COLOR_DIFFUSE, diffuseColor) == AI_SUCCESS) {
-            m_color = glm::vec3(diffuseColor.r, diffuseColor.g, diffuseColor.b);
+    // Load texture
+    aiString texturePath;
+    if (material->GetTexture(aiTextureType_DIFFUSE, 0, &texturePath) == AI_SUCCESS) {
+        std::string fullPath = "./assets/models/" + std::string(texturePath.C_Str());
+
+        // Small textures share an atlas page, the UVs are moved onto
+        // the image's place on it
+        AtlasRegion region;
+        if (s_textureAtlas && TexCoordsInUnitSquare(vertices) && s_textureAtlas->Add(fullPath, region)) {
+            for (Vertex& vertex : vertices) {
+                vertex.TexCoords = region.offset + vertex.TexCoords * region.scale;
+            }
+            submesh.texture = region.page;
         }
         else {
-            m_color = glm::vec3(1.0f, 1.0f, 1.0f);
-        }
-
-        // Load texture
-        aiString texturePath;
-        if (material->GetTexture(aiTextureType_DIFFUSE, 0, &texturePath) == AI_SUCCESS) {
-            std::string fullPath = "./assets/models/" + std::string(texturePath.C_Str());
-            m_texture = new Texture();
-            if (!m_texture->LoadTexture(fullPath)) {
+            // Decode only, the GL upload happens in InitializeModel so
+            // loading can run off the render thread
+            submesh.texture = new Texture();
+            if (!submesh.texture->LoadImageData(fullPath)) {
                 std::cerr << "Failed to load texture: " << fullPath << std::endl;
-                delete m_texture;
-                m_texture = nullptr;
+                delete submesh.texture;
+                submesh.texture = nullptr;
             }
         }
     }
-
-    m_processedVertices.insert(m_processedVertices.end(), vertices.begin(), vertices.end());
-    m_processedIndices.insert(m_processedIndices.end(), indices.begin(), indices.end());
 }
 
 void Mesh3D::Initialize() {
+    ComputeBounds(m_vertices.data(), m_vertices.size() / 11, 11);
+
+    Submesh submesh;
+    submesh.indexCount = static_cast<GLsizei>(m_indices.size());
+    submesh.color = m_color;
+    submesh.texture = m_texture;
+    m_submeshes.assign(1, submesh);
 
     // VAO Specification
     glGenVertexArrays(1, &m_vertexArrayObject);
@@ -117,6 +194,8 @@ void Mesh3D::Initialize() {
     glGenBuffers(1, &m_vertexBufferObject);
     glBindBuffer(GL_ARRAY_BUFFER, m_vertexBufferObject);
     glBufferData(GL_ARRAY_BUFFER, m_vertices.size() * sizeof(GLfloat), m_vertices.data(), GL_STATIC_DRAW);
+    RenderStats::Current().CountBufferUpload(m_vertices.size() * sizeof(GLfloat));
+    GpuMemory::Get().TrackBuffer(m_vertexBufferObject, GpuMemory::VertexBuffers, m_vertices.size() * sizeof(GLfloat), GetName());
 
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(
@@ -165,15 +244,32 @@ void Mesh3D::Initialize() {
     glGenBuffers(1, &m_indexBufferObject);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBufferObject);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_indices.size() * sizeof(GLuint), m_indices.data(), GL_STATIC_DRAW);
+    RenderStats::Current().CountBufferUpload(m_indices.size() * sizeof(GLuint));
+    GpuMemory::Get().TrackBuffer(m_indexBufferObject, GpuMemory::IndexBuffers, m_indices.size() * sizeof(GLuint), GetName());
     
     glBindVertexArray(0);
     glDisableVertexAttribArray(0);
     glDisableVertexAttribArray(1);
     glDisableVertexAttribArray(2);
     glDisableVertexAttribArray(3);
+
+    CreatePositionStream(m_vertices.data(), m_vertices.size() / 11, 11);
 }
 
 void Mesh3D::InitializeModel() {
+    HORSE_PROFILE_FUNCTION();
+
+    for (Submesh& submesh : m_submeshes) {
+        if (submesh.texture && submesh.texture->HasPendingUpload()) {
+            submesh.texture->Upload();
+        }
+    }
+    if (s_textureAtlas) {
+        s_textureAtlas->Upload();
+    }
+
+    ComputeBounds(reinterpret_cast<const float*>(m_processedVertices.data()), m_processedVertices.size(), sizeof(Vertex) / sizeof(float));
+
     // VAO Specification
     glGenVertexArrays(1, &m_vertexArrayObject);
     glBindVertexArray(m_vertexArrayObject);
@@ -182,6 +278,8 @@ void Mesh3D::InitializeModel() {
     glGenBuffers(1, &m_vertexBufferObject);
     glBindBuffer(GL_ARRAY_BUFFER, m_vertexBufferObject);
     glBufferData(GL_ARRAY_BUFFER, m_processedVertices.size() * sizeof(Vertex), m_processedVertices.data(), GL_STATIC_DRAW);
+    RenderStats::Current().CountBufferUpload(m_processedVertices.size() * sizeof(Vertex));
+    GpuMemory::Get().TrackBuffer(m_vertexBufferObject, GpuMemory::VertexBuffers, m_processedVertices.size() * sizeof(Vertex), GetName());
 
     // Position attribute
     glEnableVertexAttribArray(0);
@@ -220,74 +318,99 @@ void Mesh3D::InitializeModel() {
     glGenBuffers(1, &m_indexBufferObject);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBufferObject);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_processedIndices.size() * sizeof(GLuint), m_processedIndices.data(), GL_STATIC_DRAW);
+    RenderStats::Current().CountBufferUpload(m_processedIndices.size() * sizeof(GLuint));
+    GpuMemory::Get().TrackBuffer(m_indexBufferObject, GpuMemory::IndexBuffers, m_processedIndices.size() * sizeof(GLuint), GetName());
 
     glBindVertexArray(0);
     glDisableVertexAttribArray(0);
     glDisableVertexAttribArray(1);
     glDisableVertexAttribArray(2);
-}
 
-void Mesh3D::SpecifyVertices(std::vector<GLfloat> vertices, std::vector<GLuint> indicies) {
-    m_vertices = vertices;
-    m_indices = indicies;
+    CreatePositionStream(reinterpret_cast<const float*>(m_processedVertices.data()), m_processedVertices.size(), sizeof(Vertex) / sizeof(float));
 }
 
-// Render functions
-void Mesh3D::Draw(Shader* shader) {
-    bool useTexture = (m_texture != nullptr);
-    shader->setBool("u_useTexture", useTexture);
+void Mesh3D::CreatePositionStream(const float* positions, size_t count, size_t stride) {
+    m_positions.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        m_positions[i] = glm::vec3(positions[i * stride], positions[i * stride + 1], positions[i * stride + 2]);
+    }
 
-    if (useTexture) {
-        glActiveTexture(GL_TEXTURE0);
-        m_texture->Bind();
-        shader->setInt("textureSampler", 0);
-    } 
+    glGenVertexArrays(1, &m_positionArrayObject);
+    glBindVertexArray(m_positionArrayObject);
 
-    // Handlle object color
-    shader->setUniformVec3("u_objectColor", m_color);
+    glGenBuffers(1, &m_positionBufferObject);
+    glBindBuffer(GL_ARRAY_BUFFER, m_positionBufferObject);
+    glBufferData(GL_ARRAY_BUFFER, m_positions.size() * sizeof(glm::vec3), m_positions.data(), GL_STATIC_DRAW);
+    RenderStats::Current().CountBufferUpload(m_positions.size() * sizeof(glm::vec3));
+    GpuMemory::Get().TrackBuffer(m_positionBufferObject, GpuMemory::VertexBuffers, m_positions.size() * sizeof(glm::vec3), GetName());
 
-    // Draw Mesh
-    glBindVertexArray(m_vertexArrayObject);
-    glBindBuffer(GL_ARRAY_BUFFER, m_vertexBufferObject);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(GLfloat) * 3, (void*)0);
+
+    // Same indices as the full vertex layout
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBufferObject);
-    glDrawElements(GL_TRIANGLES, m_indices.size(), GL_UNSIGNED_INT, 0);
+
     glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
 
-    if (useTexture) {
-        m_texture->Unbind();
+void Mesh3D::ComputeBounds(const float* positions, size_t count, size_t stride) {
+    if (count == 0) {
+        m_boundsMin = m_boundsMax = glm::vec3(0.0f);
+        return;
     }
-}
 
+    m_boundsMin = glm::vec3(positions[0], positions[1], positions[2]);
+    m_boundsMax = m_boundsMin;
+    for (size_t i = 1; i < count; i++) {
+        const float* p = positions + i * stride;
+        glm::vec3 position(p[0], p[1], p[2]);
+        m_boundsMin = glm::min(m_boundsMin, position);
+        m_boundsMax = glm::max(m_boundsMax, position);
+    }
+}
 
-void Mesh3D::DrawModel(Shader* shader) {
-    bool useTexture = (m_texture != nullptr);
-    shader->setBool("u_useTexture", useTexture);
+void Mesh3D::SpecifyVertices(std::vector<GLfloat> vertices, std::vector<GLuint> indicies) {
+    m_vertices = vertices;
+    m_indices = indicies;
+}
 
-    if (useTexture) {
-        glActiveTexture(GL_TEXTURE0);
-        m_texture->Bind();
-        shader->setInt("textureSampler", 0);
+// Render functions
+void Mesh3D::Draw() {
+    // Material state is bound by the caller, see MaterialLibrary::Bind
+    for (size_t i = 0; i < m_submeshes.size(); i++) {
+        DrawSubmesh(i);
     }
+}
 
-    // Handlle object color
-    shader->setUniformVec3("u_objectColor", m_color);
+void Mesh3D::DrawModel() {
+    Draw();
+}
 
-    // Draw Model
+void Mesh3D::DrawSubmesh(size_t index) {
+    const Submesh& submesh = m_submeshes[index];
     glBindVertexArray(m_vertexArrayObject);
-    glBindBuffer(GL_ARRAY_BUFFER, m_vertexBufferObject);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBufferObject);
-    glDrawElements(GL_TRIANGLES, m_processedIndices.size(), GL_UNSIGNED_INT, 0);
+    glDrawElementsBaseVertex(GL_TRIANGLES, submesh.indexCount, GL_UNSIGNED_INT,
+        (void*)(submesh.indexOffset * sizeof(GLuint)), submesh.baseVertex);
+    RenderStats::Current().CountDraw(submesh.indexCount);
     glBindVertexArray(0);
+}
 
-    if (useTexture) {
-        m_texture->Unbind();
+void Mesh3D::DrawDepth() {
+    // Submeshes only differ in material, the position stream draws them all
+    glBindVertexArray(m_positionArrayObject);
+    for (const Submesh& submesh : m_submeshes) {
+        glDrawElementsBaseVertex(GL_TRIANGLES, submesh.indexCount, GL_UNSIGNED_INT,
+            (void*)(submesh.indexOffset * sizeof(GLuint)), submesh.baseVertex);
+        RenderStats::Current().CountDraw(submesh.indexCount);
     }
+    glBindVertexArray(0);
 }
-    
 
 void Mesh3D::CleanUp() {
     if (m_vertexArrayObject != 0) {
         glDeleteBuffers(1, &m_vertexBufferObject);
+        GpuMemory::Get().ReleaseBuffer(m_vertexBufferObject);
         m_vertexBufferObject = 0;
     }
     if (m_vertexArrayObject != 0) {
@@ -296,8 +419,16 @@ void Mesh3D::CleanUp() {
     }
     if (m_indexBufferObject != 0) {
         glDeleteBuffers(1, &m_indexBufferObject);
+        GpuMemory::Get().ReleaseBuffer(m_indexBufferObject);
         m_indexBufferObject = 0;
     }
+    if (m_positionArrayObject != 0) {
+        glDeleteVertexArrays(1, &m_positionArrayObject);
+        glDeleteBuffers(1, &m_positionBufferObject);
+        GpuMemory::Get().ReleaseBuffer(m_positionBufferObject);
+        m_positionArrayObject = 0;
+        m_positionBufferObject = 0;
+    }
 }
 
 void Mesh3D::UpdateBuffers() {
@@ -306,9 +437,11 @@ void Mesh3D::UpdateBuffers() {
 
     if (!m_processedVertices.empty()) {
         glBufferSubData(GL_ARRAY_BUFFER, 0, m_processedVertices.size() * sizeof(float), m_processedVertices.data());
+        RenderStats::Current().CountBufferUpload(m_processedVertices.size() * sizeof(float));
     }
     else {
         glBufferSubData(GL_ARRAY_BUFFER, 0, m_vertices.size() * sizeof(float), m_vertices.data());
+        RenderStats::Current().CountBufferUpload(m_vertices.size() * sizeof(float));
     }
 
     glBindBuffer(GL_ARRAY_BUFFER, 0);
@@ -318,22 +451,45 @@ void Mesh3D::UpdateBuffers() {
 // Setters
 void Mesh3D::SetTexture(Texture* texture) {
     m_texture = texture;
+    for (Submesh& submesh : m_submeshes) {
+        submesh.texture = texture;
+        submesh.material = nullptr;
+    }
+}
+
+void Mesh3D::SetMaterial(Material* material) {
+    m_material = material;
+    m_hasOwnMaterial = material != nullptr;
+}
+
+void Mesh3D::SetSharedMaterial(size_t submesh, Material* material) {
+    m_submeshes[submesh].material = material;
 }
 
 void Mesh3D::SetPosition(const glm::vec3& pos) { 
-    m_position = pos;
+    TransformComponent& transform = GetTransform();
+    transform.position = pos;
+    transform.version++;
 }
 void Mesh3D::SetRotation(float angle, const glm::vec3& axis) {
-    m_rotationAngle = angle;
-    m_rotationAxis = axis;
+    TransformComponent& transform = GetTransform();
+    transform.rotationAngle = angle;
+    transform.rotationAxis = axis;
+    transform.version++;
 }
 
 void Mesh3D::SetScale(const glm::vec3& scale) {
-    m_scale = scale;
+    TransformComponent& transform = GetTransform();
+    transform.scale = scale;
+    transform.version++;
 }
 
 void Mesh3D::SetColor(const glm::vec3& rgb) {
     m_color = rgb;
+    for (Submesh& submesh : m_submeshes) {
+        submesh.color = rgb;
+        submesh.material = nullptr;
+    }
     
     for (int i = 3; i < m_vertices.size(); i+=11) {
         m_vertices[i] = m_color.r;
@@ -343,11 +499,38 @@ void Mesh3D::SetColor(const glm::vec3& rgb) {
 }
 
 void Mesh3D::SetName(const std::string name) {
-    m_name = name;
+    m_registry->GetNames().Get(m_entity).name = name;
 }
 
 void Mesh3D::SetLightEmitter(bool isLightEmitter) {
-    m_isLightEmitter = isLightEmitter;
+    ComponentPool<LightComponent>& lights = m_registry->GetLights();
+    if (!isLightEmitter) {
+        lights.Remove(m_entity);
+    }
+    else if (!lights.Has(m_entity)) {
+        lights.Add(m_entity);
+    }
+}
+
+// Radius and intensity only apply to light emitters
+void Mesh3D::SetLightRadius(float radius) {
+    if (LightComponent* light = m_registry->GetLights().TryGet(m_entity)) {
+        light->radius = radius;
+    }
+}
+
+void Mesh3D::SetLightIntensity(float intensity) {
+    if (LightComponent* light = m_registry->GetLights().TryGet(m_entity)) {
+        light->intensity = intensity;
+    }
+}
+
+void Mesh3D::SetStatic(bool isStatic) {
+    m_registry->SetTag(m_entity, TagComponent::Static, isStatic);
+}
+
+void Mesh3D::SetOccluder(bool isOccluder) {
+    m_registry->SetTag(m_entity, TagComponent::Occluder, isOccluder);
 }
 
 //void Mesh3D::Stretch(char axis, int scale) {
@@ -371,10 +554,61 @@ void Mesh3D::SetLightEmitter(bool isLightEmitter) {
 //}
 
 // Getters
+const std::string& Mesh3D::GetName() const {
+    return m_registry->GetNames().Get(m_entity).name;
+}
+
+bool Mesh3D::IsLightEmitter() const {
+    return m_registry->GetLights().Has(m_entity);
+}
+
+float Mesh3D::GetLightRadius() const {
+    const LightComponent* light = m_registry->GetLights().TryGet(m_entity);
+    return light ? light->radius : LightComponent().radius;
+}
+
+float Mesh3D::GetLightIntensity() const {
+    const LightComponent* light = m_registry->GetLights().TryGet(m_entity);
+    return light ? light->intensity : LightComponent().intensity;
+}
+
+bool Mesh3D::IsStatic() const {
+    return m_registry->HasTag(m_entity, TagComponent::Static);
+}
+
+bool Mesh3D::IsOccluder() const {
+    return m_registry->HasTag(m_entity, TagComponent::Occluder);
+}
+
+Material* Mesh3D::GetMaterial(size_t submesh) const {
+    if (m_hasOwnMaterial || submesh >= m_submeshes.size()) {
+        return m_material;
+    }
+    return m_submeshes[submesh].material;
+}
+
 glm::mat4 Mesh3D::GetModelMatrix() const {
-    glm::mat4 model = glm::mat4(1.0f);
-    model = glm::translate(model, m_position);
-    model = glm::rotate(model, m_rotationAngle, m_rotationAxis);
-    model = glm::scale(model, m_scale);
-    return model;
+    return GetTransform().GetModelMatrix();
+}
+
+void Mesh3D::GetBoundingSphere(const glm::mat4& model, glm::vec3& center, float& radius) const {
+    glm::vec3 localCenter = (m_boundsMin + m_boundsMax) * 0.5f;
+    center = glm::vec3(model * glm::vec4(localCenter, 1.0f));
+
+    // Longest basis vector covers any rotation and non-uniform scale
+    float scale = std::sqrt(std::max(glm::dot(glm::vec3(model[0]), glm::vec3(model[0])),
+        std::max(glm::dot(glm::vec3(model[1]), glm::vec3(model[1])), glm::dot(glm::vec3(model[2]), glm::vec3(model[2])))));
+    radius = glm::length(m_boundsMax - localCenter) * scale;
+}
+
+void Mesh3D::StorePreviousTransform() {
+    GetTransform().StorePrevious();
+}
+
+glm::vec3 Mesh3D::GetInterpolatedPosition(float alpha) const {
+    return GetTransform().GetInterpolatedPosition(alpha);
+}
+
+glm::mat4 Mesh3D::GetInterpolatedModelMatrix(float alpha) const {
+    return GetTransform().GetInterpolatedModelMatrix(alpha);
 }
\ No newline at end of file
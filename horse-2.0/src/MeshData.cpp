@@ -92,32 +92,60 @@ MeshData MeshData::CreateCube(float size) {
     return data;
 }
 
-/*
-MeshData MeshData::CreateWall(float length, float width, float height) {
+MeshData MeshData::CreatePyramid(float size) {
+    float halfSize = size / 2.0f;
+    // Side normals lean out by atan(1/2) since the apex is twice as high as the base half width
+    const float ny = 0.4472136f;
+    const float nh = 0.8944272f;
     MeshData data;
 
     data.vertices = {
-        // Front face
-        -length/2, 0.0f,  0.0f,  0.85f, 0.85f, 0.91f,
-         length/2, 0.0f,  0.0f,  0.85f, 0.85f, 0.85f,
-         length/2, height,  0.0f,  0.85f, 0.85f, 0.91f,
-        -length/2, height,  0.0f,  0.85f, 0.85f, 0.85f,
+        // Front face (position, color, texcoords, normal)
+        -halfSize, -halfSize,  halfSize,  1.0f, 0.0f, 0.0f, 0.0f, 1.0f,  0.0f, ny, nh,     // Bottom-left
+         halfSize, -halfSize,  halfSize,  0.0f, 1.0f, 0.0f, 1.0f, 1.0f,  0.0f, ny, nh,     // Bottom-right
+         0.0f,      halfSize,  0.0f,      0.0f, 0.0f, 1.0f, 0.5f, 0.0f,  0.0f, ny, nh,     // Apex
+        // Right face
+         halfSize, -halfSize,  halfSize,  1.0f, 0.0f, 0.0f, 0.0f, 1.0f,  nh, ny, 0.0f,
+         halfSize, -halfSize, -halfSize,  0.0f, 1.0f, 0.0f, 1.0f, 1.0f,  nh, ny, 0.0f,
+         0.0f,      halfSize,  0.0f,      0.0f, 0.0f, 1.0f, 0.5f, 0.0f,  nh, ny, 0.0f,
         // Back face
-        -length/2,  0.0f, -width,  0.85f, 0.85f, 0.91f,
-         length/2,  0.0f, -width,  0.85f, 0.85f, 0.85f,
-         length/2, height, -width,  0.85f, 0.85f, 0.91f,
-        -length/2, height, -width,  0.85f, 0.85f, 0.85f
-    }; 
+         halfSize, -halfSize, -halfSize,  1.0f, 0.0f, 0.0f, 0.0f, 1.0f,  0.0f, ny, -nh,
+        -halfSize, -halfSize, -halfSize,  0.0f, 1.0f, 0.0f, 1.0f, 1.0f,  0.0f, ny, -nh,
+         0.0f,      halfSize,  0.0f,      0.0f, 0.0f, 1.0f, 0.5f, 0.0f,  0.0f, ny, -nh,
+        // Left face
+        -halfSize, -halfSize, -halfSize,  1.0f, 0.0f, 0.0f, 0.0f, 1.0f, -nh, ny, 0.0f,
+        -halfSize, -halfSize,  halfSize,  0.0f, 1.0f, 0.0f, 1.0f, 1.0f, -nh, ny, 0.0f,
+         0.0f,      halfSize,  0.0f,      0.0f, 0.0f, 1.0f, 0.5f, 0.0f, -nh, ny, 0.0f,
+        // Bottom face
+        -halfSize, -halfSize,  halfSize,  1.0f, 0.0f, 0.0f, 0.0f, 1.0f,  0.0f, -1.0f, 0.0f,
+         halfSize, -halfSize,  halfSize,  0.0f, 1.0f, 0.0f, 1.0f, 1.0f,  0.0f, -1.0f, 0.0f,
+         halfSize, -halfSize, -halfSize,  0.0f, 0.0f, 1.0f, 1.0f, 0.0f,  0.0f, -1.0f, 0.0f,
+        -halfSize, -halfSize, -halfSize,  1.0f, 1.0f, 0.0f, 0.0f, 0.0f,  0.0f, -1.0f, 0.0f
+    };
 
     data.indices = {
-        0, 1, 2,  0, 3, 2,  // Front
-        4, 5, 6,  4, 7, 6,  // Back
-        0, 4, 7,  0, 3, 7,  // Left
-        1, 5, 6,  1, 2, 6,  // Right
-        0, 4, 5,  0, 1, 5,  // Top
-        3, 7, 6,  3, 2, 6   // Bottom
+        // Sides
+        0, 1, 2,
+        3, 4, 5,
+        6, 7, 8,
+        9, 10, 11,
+        // Bottom face
+        12, 14, 13,
+        12, 15, 14
     };
 
     return data;
 }
-*/
\ No newline at end of file
+
+MeshData MeshData::CreateWall(float length, float width, float height) {
+    // Unit cube stretched to size and standing on y = 0, the axis aligned
+    // normals stay valid under the stretch
+    MeshData data = CreateCube(1.0f);
+    for (size_t i = 0; i < data.vertices.size(); i += 11) {
+        data.vertices[i] *= length;
+        data.vertices[i + 1] = (data.vertices[i + 1] + 0.5f) * height;
+        data.vertices[i + 2] *= width;
+    }
+
+    return data;
+}
@@ -0,0 +1,227 @@
+#include "OcclusionCuller.hpp"
+#include "GpuMemory.hpp"
+#include "Mesh3D.hpp"
+#include "Profiler.hpp"
+#include "RenderStats.hpp"
+#include <glm/gtc/matrix_transform.hpp>
+
+// Objects whose bounds come this close to the eye are always drawn, their
+// boxes would be clipped by the near plane and fail the query
+static const float kNearMargin = 0.5f;
+
+OcclusionCuller::OcclusionCuller() {
+}
+
+void OcclusionCuller::Initialize(Shader* boxShader) {
+    if (m_initialized) {
+        return;
+    }
+
+    m_boxShader = boxShader;
+
+    // Conservative queries (GL 4.3) let the GPU answer early, plain
+    // any-samples queries are the fallback
+    m_queryTarget = (GLAD_GL_VERSION_4_3 || GLAD_GL_ARB_ES3_compatibility) ? GL_ANY_SAMPLES_PASSED_CONSERVATIVE : GL_ANY_SAMPLES_PASSED;
+
+    // Unit cube centered on the origin
+    const GLfloat vertices[] = {
+        -0.5f, -0.5f, -0.5f,   0.5f, -0.5f, -0.5f,   0.5f, 0.5f, -0.5f,   -0.5f, 0.5f, -0.5f,
+        -0.5f, -0.5f,  0.5f,   0.5f, -0.5f,  0.5f,   0.5f, 0.5f,  0.5f,   -0.5f, 0.5f,  0.5f,
+    };
+    const GLuint indices[] = {
+        0, 2, 1, 0, 3, 2,   4, 5, 6, 4, 6, 7,   0, 1, 5, 0, 5, 4,
+        3, 6, 2, 3, 7, 6,   0, 4, 7, 0, 7, 3,   1, 2, 6, 1, 6, 5,
+    };
+
+    glGenVertexArrays(1, &m_boxArray);
+    glBindVertexArray(m_boxArray);
+
+    glGenBuffers(1, &m_boxVertexBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, m_boxVertexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    GpuMemory::Get().TrackBuffer(m_boxVertexBuffer, GpuMemory::VertexBuffers, sizeof(vertices), "occlusion boxes");
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(GLfloat) * 3, (void*)0);
+
+    glGenBuffers(1, &m_boxIndexBuffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_boxIndexBuffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+    GpuMemory::Get().TrackBuffer(m_boxIndexBuffer, GpuMemory::IndexBuffers, sizeof(indices), "occlusion boxes");
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    m_initialized = true;
+}
+
+void OcclusionCuller::CleanUp() {
+    if (!m_initialized) {
+        return;
+    }
+
+    Reset();
+    glDeleteVertexArrays(1, &m_boxArray);
+    glDeleteBuffers(1, &m_boxVertexBuffer);
+    glDeleteBuffers(1, &m_boxIndexBuffer);
+    GpuMemory::Get().ReleaseBuffer(m_boxVertexBuffer);
+    GpuMemory::Get().ReleaseBuffer(m_boxIndexBuffer);
+    m_boxArray = m_boxVertexBuffer = m_boxIndexBuffer = 0;
+    m_initialized = false;
+}
+
+void OcclusionCuller::Reset() {
+    for (auto& entry : m_states) {
+        glDeleteQueries(1, &entry.second.query);
+    }
+    m_states.clear();
+}
+
+OcclusionCuller::ObjectState& OcclusionCuller::GetState(Mesh3D* mesh) {
+    auto it = m_states.find(mesh);
+    if (it != m_states.end()) {
+        return it->second;
+    }
+
+    // New objects start visible, with their first geometry query staggered
+    // so a freshly loaded scene does not query everything on one frame
+    ObjectState& state = m_states[mesh];
+    glGenQueries(1, &state.query);
+    state.lastQueryFrame = m_frame - kVisibleQueryInterval + static_cast<uint32_t>(m_states.size() % kVisibleQueryInterval);
+    return state;
+}
+
+void OcclusionCuller::ReadResults() {
+    for (auto& entry : m_states) {
+        ObjectState& state = entry.second;
+        if (!state.pending) {
+            continue;
+        }
+
+        GLuint available = 0;
+        glGetQueryObjectuiv(state.query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            continue;
+        }
+
+        GLuint anySamples = 0;
+        glGetQueryObjectuiv(state.query, GL_QUERY_RESULT, &anySamples);
+        state.visible = anySamples != 0;
+        state.pending = false;
+        if (!state.visible) {
+            m_stats.occluded++;
+        }
+    }
+}
+
+void OcclusionCuller::Draw(const std::vector<DrawItem>& items, const glm::mat4& view, const glm::mat4& projection, const glm::vec3& eye,
+    Shader* shader, const std::function<void(const DrawItem&)>& draw) {
+    HORSE_PROFILE_FUNCTION();
+
+    m_stats = Stats();
+    m_frame++;
+    ReadResults();
+
+    m_frustum.Set(projection * view);
+    m_hidden.clear();
+    m_hiddenStates.clear();
+
+    // Objects visible last frame go first, they fill the depth buffer the
+    // box queries below are tested against
+    for (const DrawItem& item : items) {
+        ObjectState& state = GetState(item.mesh);
+        if (!m_frustum.IntersectsSphere(item.center, item.radius)) {
+            state.visible = false;
+            m_stats.frustumCulled++;
+            RenderStats::Current().CountCulled(1);
+            continue;
+        }
+
+        if (glm::length(eye - item.center) <= item.radius + kNearMargin) {
+            state.visible = true;
+            draw(item);
+            m_stats.visibleDrawn++;
+            continue;
+        }
+
+        if (!state.visible) {
+            m_hidden.push_back(&item);
+            m_hiddenStates.push_back(&state);
+            continue;
+        }
+
+        if (!state.pending && m_frame - state.lastQueryFrame >= kVisibleQueryInterval) {
+            // The draw itself is the query, it costs nothing extra
+            glBeginQuery(m_queryTarget, state.query);
+            draw(item);
+            glEndQuery(m_queryTarget);
+            state.pending = true;
+            state.lastQueryFrame = m_frame;
+            m_stats.geometryQueries++;
+        }
+        else {
+            draw(item);
+        }
+        m_stats.visibleDrawn++;
+    }
+
+    if (m_hidden.empty()) {
+        return;
+    }
+
+    // Bounding boxes of the hidden objects, tested but never written
+    GLint depthFunc = GL_LESS;
+    GLboolean depthMask = GL_TRUE;
+    glGetIntegerv(GL_DEPTH_FUNC, &depthFunc);
+    glGetBooleanv(GL_DEPTH_WRITEMASK, &depthMask);
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glDepthMask(GL_FALSE);
+    glDepthFunc(GL_LEQUAL);
+
+    m_boxShader->useProgram();
+    m_boxShader->setUniformMat4("u_ViewMatrix", view);
+    m_boxShader->setUniformMat4("u_Projection", projection);
+    glBindVertexArray(m_boxArray);
+    for (size_t i = 0; i < m_hidden.size(); i++) {
+        ObjectState& state = *m_hiddenStates[i];
+        if (state.pending) {
+            // Last box query not back yet, the draw below reuses it
+            continue;
+        }
+
+        glBeginQuery(m_queryTarget, state.query);
+        DrawBox(*m_hidden[i]);
+        glEndQuery(m_queryTarget);
+        state.pending = true;
+        state.lastQueryFrame = m_frame;
+        m_stats.boxQueries++;
+    }
+    glBindVertexArray(0);
+
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glDepthMask(depthMask);
+    glDepthFunc(depthFunc);
+
+    // The GPU skips each draw if its box had no samples pass, NO_WAIT draws
+    // anyway if the result is not ready rather than stalling
+    shader->useProgram();
+    for (size_t i = 0; i < m_hidden.size(); i++) {
+        glBeginConditionalRender(m_hiddenStates[i]->query, GL_QUERY_NO_WAIT);
+        draw(*m_hidden[i]);
+        glEndConditionalRender();
+        m_stats.conditionalDrawn++;
+    }
+}
+
+void OcclusionCuller::DrawBox(const DrawItem& item) {
+    glm::vec3 boundsMin = item.mesh->GetBoundsMin();
+    glm::vec3 boundsMax = item.mesh->GetBoundsMax();
+
+    // Slightly inflated so the box never sits exactly on the surface
+    glm::vec3 size = glm::max(boundsMax - boundsMin, glm::vec3(0.01f)) * 1.02f;
+    glm::mat4 model = glm::translate(item.model, (boundsMin + boundsMax) * 0.5f);
+    model = glm::scale(model, size);
+
+    m_boxShader->setUniformMat4("u_ModelMatrix", model);
+    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+    RenderStats::Current().CountDraw(36);
+}
@@ -0,0 +1,315 @@
+#include "PortalSystem.hpp"
+#include "Frustum.hpp"
+#include "Mesh3D.hpp"
+#include "Profiler.hpp"
+#include <cmath>
+#include <iostream>
+
+// Closer than this to a portal's plane the frustum through it degenerates,
+// the current view is passed through unchanged instead
+static const float kPortalEpsilon = 1e-3f;
+
+// Sutherland-Hodgman against one plane, keeping the side where the plane
+// equation is positive
+static void ClipPolygon(std::vector<glm::vec3>& polygon, const glm::vec4& plane, std::vector<glm::vec3>& scratch) {
+    scratch.clear();
+    size_t count = polygon.size();
+    for (size_t i = 0; i < count; i++) {
+        const glm::vec3& a = polygon[i];
+        const glm::vec3& b = polygon[(i + 1) % count];
+        float da = glm::dot(glm::vec3(plane), a) + plane.w;
+        float db = glm::dot(glm::vec3(plane), b) + plane.w;
+        if (da >= 0.0f) {
+            scratch.push_back(a);
+        }
+        if ((da >= 0.0f) != (db >= 0.0f)) {
+            scratch.push_back(a + (b - a) * (da / (da - db)));
+        }
+    }
+    polygon.swap(scratch);
+}
+
+PortalSystem::PortalSystem() {
+}
+
+int PortalSystem::AddCell(const std::string& name, const glm::vec3& min, const glm::vec3& max) {
+    Cell cell;
+    cell.name = name;
+    cell.min = glm::min(min, max);
+    cell.max = glm::max(min, max);
+    m_cells.push_back(cell);
+    return static_cast<int>(m_cells.size()) - 1;
+}
+
+int PortalSystem::AddPortal(int cellA, int cellB, const std::vector<glm::vec3>& polygon) {
+    int cellCount = static_cast<int>(m_cells.size());
+    if (cellA < 0 || cellB < 0 || cellA >= cellCount || cellB >= cellCount || cellA == cellB || polygon.size() < 3) {
+        std::cout << "Invalid portal between cells " << cellA << " and " << cellB << std::endl;
+        return -1;
+    }
+
+    // Newell's method, robust for any planar polygon
+    glm::vec3 normal(0.0f);
+    for (size_t i = 0; i < polygon.size(); i++) {
+        const glm::vec3& current = polygon[i];
+        const glm::vec3& next = polygon[(i + 1) % polygon.size()];
+        normal.x += (current.y - next.y) * (current.z + next.z);
+        normal.y += (current.z - next.z) * (current.x + next.x);
+        normal.z += (current.x - next.x) * (current.y + next.y);
+    }
+    normal = glm::normalize(normal);
+
+    Portal portal;
+    portal.cells[0] = cellA;
+    portal.cells[1] = cellB;
+    portal.polygon = polygon;
+    portal.plane = glm::vec4(normal, -glm::dot(normal, polygon[0]));
+    m_portals.push_back(portal);
+
+    int index = static_cast<int>(m_portals.size()) - 1;
+    m_cells[cellA].portals.push_back(index);
+    m_cells[cellB].portals.push_back(index);
+    return index;
+}
+
+void PortalSystem::Clear() {
+    m_cells.clear();
+    m_portals.clear();
+    m_visibleCells.clear();
+    ClearObjects();
+}
+
+void PortalSystem::AssignObjects(const std::vector<DrawItem>& items) {
+    ClearObjects();
+
+    for (const DrawItem& item : items) {
+        int index = static_cast<int>(m_objects.size());
+        m_objects.push_back({ item.mesh, 0 });
+
+        if (!item.mesh->IsStatic()) {
+            m_movingObjects.push_back(index);
+            continue;
+        }
+
+        // Walls and other objects spanning cells are listed in all of them
+        bool inCell = false;
+        for (Cell& cell : m_cells) {
+            glm::vec3 closest = glm::clamp(item.center, cell.min, cell.max);
+            glm::vec3 offset = item.center - closest;
+            if (glm::dot(offset, offset) <= item.radius * item.radius) {
+                cell.objects.push_back(index);
+                inCell = true;
+            }
+        }
+        if (!inCell) {
+            m_exteriorObjects.push_back(index);
+        }
+    }
+}
+
+void PortalSystem::ClearObjects() {
+    m_objects.clear();
+    m_movingObjects.clear();
+    m_exteriorObjects.clear();
+    for (Cell& cell : m_cells) {
+        cell.objects.clear();
+    }
+}
+
+int PortalSystem::FindCell(const glm::vec3& point) const {
+    for (size_t i = 0; i < m_cells.size(); i++) {
+        const Cell& cell = m_cells[i];
+        if (glm::all(glm::greaterThanEqual(point, cell.min)) && glm::all(glm::lessThanEqual(point, cell.max))) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+void PortalSystem::ComputeVisibility(const glm::mat4& viewProjection, const glm::vec3& eye) {
+    HORSE_PROFILE_FUNCTION();
+
+    m_frame++;
+    m_stats = Stats();
+    m_eye = eye;
+
+    for (int cell : m_visibleCells) {
+        m_cells[cell].views.clear();
+    }
+    m_visibleCells.clear();
+    m_planes.clear();
+    m_views.clear();
+
+    Frustum frustum(viewProjection);
+    glm::vec4 planes[Frustum::PlaneCount];
+    for (int i = 0; i < Frustum::PlaneCount; i++) {
+        planes[i] = frustum.GetPlane(i);
+    }
+    m_farPlane = planes[Frustum::Far];
+    m_cameraViews.assign(1, AddView(planes, Frustum::PlaneCount));
+
+    int cameraCell = FindCell(eye);
+    if (cameraCell >= 0) {
+        Visit(cameraCell, m_cameraViews[0], -1, 0);
+    }
+    else {
+        for (int cell = 0; cell < static_cast<int>(m_cells.size()); cell++) {
+            MarkVisible(cell);
+            m_cells[cell].views.push_back(m_cameraViews[0]);
+        }
+    }
+
+    m_stats.visibleCells = static_cast<uint32_t>(m_visibleCells.size());
+    m_stats.views = static_cast<uint32_t>(m_views.size());
+}
+
+void PortalSystem::Visit(int cell, int viewIndex, int fromPortal, int depth) {
+    MarkVisible(cell);
+    m_cells[cell].views.push_back(viewIndex);
+    if (depth >= kMaxDepth) {
+        return;
+    }
+
+    for (int portalIndex : m_cells[cell].portals) {
+        if (portalIndex == fromPortal) {
+            continue;
+        }
+        if (static_cast<int>(m_views.size()) >= kMaxViews) {
+            return;
+        }
+
+        const Portal& portal = m_portals[portalIndex];
+        int next = portal.cells[0] == cell ? portal.cells[1] : portal.cells[0];
+
+        // The part of the portal this view can see
+        m_clipped = portal.polygon;
+        View view = m_views[viewIndex];
+        for (int i = 0; i < view.count && m_clipped.size() >= 3; i++) {
+            ClipPolygon(m_clipped, m_planes[view.first + i], m_clipScratch);
+        }
+        if (m_clipped.size() < 3) {
+            continue;
+        }
+
+        float eyeDistance = glm::dot(glm::vec3(portal.plane), m_eye) + portal.plane.w;
+        if (std::fabs(eyeDistance) < kPortalEpsilon) {
+            Visit(next, viewIndex, portalIndex, depth + 1);
+            continue;
+        }
+
+        // One plane through the eye and each edge of the clipped portal, the
+        // far plane, and the portal itself so nothing in front of it counts
+        glm::vec3 centroid(0.0f);
+        for (const glm::vec3& point : m_clipped) {
+            centroid += point;
+        }
+        centroid /= static_cast<float>(m_clipped.size());
+
+        m_portalPlanes.clear();
+        for (size_t i = 0; i < m_clipped.size(); i++) {
+            glm::vec3 normal = glm::cross(m_clipped[i] - m_eye, m_clipped[(i + 1) % m_clipped.size()] - m_eye);
+            float length = glm::length(normal);
+            if (length < 1e-6f) {
+                continue;
+            }
+            normal /= length;
+            if (glm::dot(normal, centroid - m_eye) < 0.0f) {
+                normal = -normal;
+            }
+            m_portalPlanes.push_back(glm::vec4(normal, -glm::dot(normal, m_eye)));
+        }
+        m_portalPlanes.push_back(m_farPlane);
+        m_portalPlanes.push_back(eyeDistance > 0.0f ? -portal.plane : portal.plane);
+
+        int narrowed = AddView(m_portalPlanes.data(), static_cast<int>(m_portalPlanes.size()));
+        Visit(next, narrowed, portalIndex, depth + 1);
+    }
+}
+
+int PortalSystem::AddView(const glm::vec4* planes, int count) {
+    View view;
+    view.first = static_cast<int>(m_planes.size());
+    view.count = count;
+    m_planes.insert(m_planes.end(), planes, planes + count);
+    m_views.push_back(view);
+    return static_cast<int>(m_views.size()) - 1;
+}
+
+void PortalSystem::MarkVisible(int cell) {
+    if (m_cells[cell].visibleFrame != m_frame) {
+        m_cells[cell].visibleFrame = m_frame;
+        m_visibleCells.push_back(cell);
+    }
+}
+
+bool PortalSystem::IsCellVisible(int cell) const {
+    return cell >= 0 && cell < static_cast<int>(m_cells.size()) && m_cells[cell].visibleFrame == m_frame;
+}
+
+DrawItem PortalSystem::MakeItem(Mesh3D* mesh, float interpolation) const {
+    DrawItem item;
+    item.mesh = mesh;
+    item.model = mesh->GetInterpolatedModelMatrix(interpolation);
+    mesh->GetBoundingSphere(item.model, item.center, item.radius);
+    return item;
+}
+
+bool PortalSystem::InViews(const std::vector<int>& views, const DrawItem& item) const {
+    for (int viewIndex : views) {
+        const View& view = m_views[viewIndex];
+        bool inside = true;
+        for (int i = 0; i < view.count && inside; i++) {
+            const glm::vec4& plane = m_planes[view.first + i];
+            inside = glm::dot(glm::vec3(plane), item.center) + plane.w >= -item.radius;
+        }
+        if (inside) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void PortalSystem::GatherVisibleItems(float interpolation, std::vector<DrawItem>& items) {
+    HORSE_PROFILE_FUNCTION();
+
+    items.clear();
+
+    // Static objects of the reached cells only, an object listed in several
+    // cells is added once
+    for (int cellIndex : m_visibleCells) {
+        const Cell& cell = m_cells[cellIndex];
+        for (int objectIndex : cell.objects) {
+            Object& object = m_objects[objectIndex];
+            if (object.gatheredFrame == m_frame) {
+                continue;
+            }
+
+            DrawItem item = MakeItem(object.mesh, interpolation);
+            if (InViews(cell.views, item)) {
+                object.gatheredFrame = m_frame;
+                items.push_back(item);
+            }
+        }
+    }
+
+    // Moving objects are located by their center every frame
+    for (int objectIndex : m_movingObjects) {
+        DrawItem item = MakeItem(m_objects[objectIndex].mesh, interpolation);
+        int cell = FindCell(item.center);
+        if (cell >= 0 && !IsCellVisible(cell)) {
+            continue;
+        }
+        if (InViews(cell >= 0 ? m_cells[cell].views : m_cameraViews, item)) {
+            items.push_back(item);
+        }
+    }
+
+    for (int objectIndex : m_exteriorObjects) {
+        DrawItem item = MakeItem(m_objects[objectIndex].mesh, interpolation);
+        if (InViews(m_cameraViews, item)) {
+            items.push_back(item);
+        }
+    }
+
+    m_stats.gathered = static_cast<uint32_t>(items.size());
+}
@@ -0,0 +1,123 @@
+#include "Profiler.hpp"
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+std::atomic<bool> Profiler::s_capturing{ false };
+
+struct ThreadBuffer {
+    uint32_t threadId = 0;
+    std::string threadName;
+    std::unique_ptr<ProfileEvent[]> events;
+    std::atomic<uint64_t> writeIndex{ 0 };
+};
+
+static std::mutex s_registryMutex;
+static std::vector<std::shared_ptr<ThreadBuffer>> s_threadBuffers;
+static const std::chrono::steady_clock::time_point s_epoch = std::chrono::steady_clock::now();
+
+static thread_local std::shared_ptr<ThreadBuffer> t_buffer;
+static thread_local uint32_t t_depth = 0;
+
+static ThreadBuffer& GetThreadBuffer() {
+    if (!t_buffer) {
+        t_buffer = std::make_shared<ThreadBuffer>();
+        t_buffer->events.reset(new ProfileEvent[Profiler::kEventsPerThread]);
+
+        std::lock_guard<std::mutex> lock(s_registryMutex);
+        t_buffer->threadId = static_cast<uint32_t>(s_threadBuffers.size());
+        t_buffer->threadName = "Thread " + std::to_string(t_buffer->threadId);
+        s_threadBuffers.push_back(t_buffer);
+    }
+    return *t_buffer;
+}
+
+static void WriteEscaped(std::ofstream& out, const std::string& text) {
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out << '\\';
+        }
+        out << c;
+    }
+}
+
+void Profiler::BeginCapture() {
+    // Drop whatever was recorded by a previous capture
+    {
+        std::lock_guard<std::mutex> lock(s_registryMutex);
+        for (auto& buffer : s_threadBuffers) {
+            buffer->writeIndex.store(0, std::memory_order_relaxed);
+        }
+    }
+    s_capturing = true;
+}
+
+void Profiler::EndCapture() {
+    s_capturing = false;
+}
+
+void Profiler::SetThreadName(const std::string& name) {
+    ThreadBuffer& buffer = GetThreadBuffer();
+    std::lock_guard<std::mutex> lock(s_registryMutex);
+    buffer.threadName = name;
+}
+
+uint64_t Profiler::Now() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - s_epoch).count());
+}
+
+void Profiler::Record(const char* name, uint64_t start, uint64_t end, uint32_t depth) {
+    ThreadBuffer& buffer = GetThreadBuffer();
+    uint64_t index = buffer.writeIndex.load(std::memory_order_relaxed);
+
+    ProfileEvent& event = buffer.events[index & (kEventsPerThread - 1)];
+    event.name = name;
+    event.start = start;
+    event.end = end;
+    event.depth = depth;
+
+    buffer.writeIndex.store(index + 1, std::memory_order_release);
+}
+
+uint32_t& Profiler::ThreadDepth() {
+    return t_depth;
+}
+
+bool Profiler::WriteChromeTrace(const std::string& filepath) {
+    std::ofstream out(filepath, std::ios::out | std::ios::trunc);
+    if (!out.is_open()) {
+        std::cerr << "Could not open trace output: " << filepath << std::endl;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(s_registryMutex);
+
+    out << std::fixed << std::setprecision(3);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    for (const auto& buffer : s_threadBuffers) {
+        // Thread name metadata
+        out << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->threadId << ",\"args\":{\"name\":\"";
+        WriteEscaped(out, buffer->threadName);
+        out << "\"}}";
+        first = false;
+
+        // Only the newest kEventsPerThread events survive in the ring
+        uint64_t end = buffer->writeIndex.load(std::memory_order_acquire);
+        uint64_t begin = end > kEventsPerThread ? end - kEventsPerThread : 0;
+        for (uint64_t i = begin; i < end; i++) {
+            const ProfileEvent& event = buffer->events[i & (kEventsPerThread - 1)];
+            out << ",\n{\"name\":\"";
+            WriteEscaped(out, event.name);
+            out << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->threadId
+                << ",\"ts\":" << event.start / 1000.0
+                << ",\"dur\":" << (event.end - event.start) / 1000.0 << "}";
+        }
+    }
+    out << "\n]}\n";
+    return true;
+}
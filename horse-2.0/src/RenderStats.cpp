@@ -0,0 +1,46 @@
+#include "RenderStats.hpp"
+
+static RenderStats s_currentStats;
+
+RenderStats& RenderStats::Current() {
+    return s_currentStats;
+}
+
+void RenderStats::Reset() {
+    s_currentStats = RenderStats();
+}
+
+void RenderStats::CountDraw(uint64_t indexCount) {
+    drawCalls++;
+    triangles += indexCount / 3;
+}
+
+void RenderStats::CountBufferUpload(uint64_t bytes) {
+    bufferUploads++;
+    bufferUploadBytes += bytes;
+}
+
+void RenderStats::CountTextureUpload(uint64_t bytes) {
+    textureUploads++;
+    textureUploadBytes += bytes;
+}
+
+void RenderStats::CountMaterialBind() {
+    materialBinds++;
+}
+
+void RenderStats::CountTextureBind() {
+    textureBinds++;
+}
+
+void RenderStats::CountShaderBind() {
+    shaderBinds++;
+}
+
+void RenderStats::CountUniformUpload(uint64_t count) {
+    uniformUploads += count;
+}
+
+void RenderStats::CountCulled(uint64_t objects) {
+    culledObjects += objects;
+}
@@ -1,4 +1,23 @@
 #include "Scene.hpp"
+#include "Frustum.hpp"
+#include "OcclusionCuller.hpp"
+#include "PortalSystem.hpp"
+#include "Profiler.hpp"
+#include "RenderStats.hpp"
+#include "SoftwareOcclusion.hpp"
+#include "TextureStreamer.hpp"
+#include <algorithm>
+
+// GL name of the texture or array the material binds, 0 for none. Textures
+// sharing an array get the same key, so a run of them needs no rebind, and
+// sorting by name and material slot keeps the order stable between runs.
+static GLuint TextureBindKey(const Material* material) {
+    Texture* texture = material->GetTexture();
+    if (!texture) {
+        return 0;
+    }
+    return texture->GetArray() ? texture->GetArray()->GetID() : texture->GetID();
+}
 
 Scene::Scene(GLuint shader) {
 	m_shaderProgram = shader;
@@ -8,39 +27,132 @@ void Scene::SetShaderProgram(GLuint shader) {
     m_shaderProgram = shader;
 }
 
+void Scene::SetJobSystem(JobSystem* jobSystem) {
+    m_jobSystem = jobSystem;
+}
+
+void Scene::SetOcclusionCuller(OcclusionCuller* culler) {
+    m_occlusionCuller = culler;
+}
+
+void Scene::SetSoftwareOcclusion(SoftwareOcclusion* occlusion) {
+    m_softwareOcclusion = occlusion;
+}
+
+void Scene::SetPortalSystem(PortalSystem* portals) {
+    m_portalSystem = portals;
+    m_portalObjectCount = SIZE_MAX;
+}
+
+void Scene::SetImportSettings(const ImportSettings& settings) {
+    m_importSettings = settings;
+}
+
+void Scene::SetTextureStreamer(TextureStreamer* streamer) {
+    m_textureStreamer = streamer;
+}
+
+Entity Scene::CreateEntity(const std::string& name) {
+    Entity entity = m_entities.Create();
+    m_entities.GetTransforms().Add(entity);
+    m_entities.GetNames().Add(entity).name = name;
+    return entity;
+}
+
+Mesh3D* Scene::AddRenderable(Entity entity, std::unique_ptr<Mesh3D> mesh) {
+    Mesh3D* ptr = mesh.get();
+    m_entities.GetRenderables().Add(entity).mesh = std::move(mesh);
+    return ptr;
+}
+
 Mesh3D* Scene::CreateObject(const std::string name, const MeshData& data) {
-    auto obj = std::make_unique<Mesh3D>();
+    Entity entity = CreateEntity(name);
+    auto obj = std::make_unique<Mesh3D>(m_entities, entity);
     obj->SpecifyVertices(data.vertices, data.indices);
     obj->Initialize();
-    obj->SetName(name);
 
-    Mesh3D* ptr = obj.get();
-    m_objects.push_back(std::move(obj));
-    return ptr;
+    return AddRenderable(entity, std::move(obj));
 }
 
 Mesh3D* Scene::CreateModel(const std::string name, const std::string& filepath) {
-    auto obj = std::make_unique<Mesh3D>();
-    obj->LoadModel(filepath);
+    return CreateModel(name, filepath, m_importSettings);
+}
+
+Mesh3D* Scene::CreateModel(const std::string name, const std::string& filepath, const ImportSettings& settings) {
+    Entity entity = CreateEntity(name);
+    auto obj = std::make_unique<Mesh3D>(m_entities, entity);
+    obj->LoadModel(filepath, settings);
     obj->InitializeModel();
-    obj->SetName(name);
 
-    Mesh3D* ptr = obj.get();
-    m_objects.push_back(std::move(obj));
-    return ptr;
+    return AddRenderable(entity, std::move(obj));
+}
+
+std::vector<Mesh3D*> Scene::CreateModels(const std::vector<ModelRequest>& requests) {
+    HORSE_PROFILE_FUNCTION();
+
+    // Entities are created up front, the workers never touch the registry
+    std::vector<std::unique_ptr<Mesh3D>> models(requests.size());
+    for (size_t i = 0; i < models.size(); i++) {
+        models[i] = std::make_unique<Mesh3D>(m_entities, CreateEntity(requests[i].name));
+    }
+
+    // Assimp import and image decoding, no GL calls
+    auto load = [&](uint32_t begin, uint32_t end) {
+        HORSE_PROFILE_SCOPE("LoadModels");
+        for (uint32_t i = begin; i < end; i++) {
+            models[i]->LoadModel(requests[i].filepath, requests[i].settings ? *requests[i].settings : m_importSettings);
+        }
+    };
+    if (m_jobSystem && m_jobSystem->IsInitialized()) {
+        m_jobSystem->ParallelFor(static_cast<uint32_t>(requests.size()), 1, load);
+    }
+    else {
+        load(0, static_cast<uint32_t>(requests.size()));
+    }
+
+    // GL uploads
+    HORSE_PROFILE_SCOPE("InitializeModels");
+    std::vector<Mesh3D*> result;
+    for (auto& model : models) {
+        model->InitializeModel();
+        Entity entity = model->GetEntity();
+        result.push_back(AddRenderable(entity, std::move(model)));
+    }
+    return result;
 }
 
 Mesh3D* Scene::GetObject(const std::string name) {
-    for (const auto& obj : m_objects) {
-        if (obj->GetName() == name) {
-            return obj.get();
+    Mesh3D* object = FindObject(name);
+    if (!object) {
+        std::cerr << "Object not found in scene" << std::endl;
+    }
+    return object;
+}
+
+Mesh3D* Scene::FindObject(const std::string& name) {
+    const ComponentPool<NameComponent>& names = m_entities.GetNames();
+    for (size_t i = 0; i < names.Size(); i++) {
+        if (names.GetComponents()[i].name == name) {
+            RenderableComponent* renderable = m_entities.GetRenderables().TryGet(names.GetEntities()[i]);
+            if (renderable) {
+                return renderable->mesh.get();
+            }
         }
     }
-    
-    std::cerr << "Object not found in scene" << std::endl;
     return nullptr;
 }
 
+std::vector<Mesh3D*> Scene::GetLightEmitters() const {
+    std::vector<Mesh3D*> lights;
+    for (Entity entity : m_entities.GetLights().GetEntities()) {
+        const RenderableComponent* renderable = m_entities.GetRenderables().TryGet(entity);
+        if (renderable) {
+            lights.push_back(renderable->mesh.get());
+        }
+    }
+    return lights;
+}
+
 void Scene::PrepareDraw(int width, int height) {
     glEnable(GL_DEPTH_TEST);
     glDisable(GL_CULL_FACE);
@@ -52,62 +164,241 @@ void Scene::PrepareDraw(int width, int height) {
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
     glUseProgram(m_shaderProgram);        // modifying shaders in program object will not affect curr executables
+    RenderStats::Current().CountShaderBind();
 
 }
 
 void Scene::DrawObjects(const glm::mat4& view, const glm::mat4& projection, Shader* shader) {
-    // Set view and projection matrices
-    GLint viewLocation = glGetUniformLocation(m_shaderProgram, "u_ViewMatrix");
-    GLint projLocation = glGetUniformLocation(m_shaderProgram, "u_Projection");
+    HORSE_PROFILE_FUNCTION();
+
+    // Set view and projection matrices on whichever pass is drawing
+    shader->useProgram();
+    GLint viewLocation = glGetUniformLocation(shader->shaderProgram, "u_ViewMatrix");
+    GLint projLocation = glGetUniformLocation(shader->shaderProgram, "u_Projection");
     if (viewLocation >= 0) glUniformMatrix4fv(viewLocation, 1, GL_FALSE, &view[0][0]);
     if (projLocation >= 0) glUniformMatrix4fv(projLocation, 1, GL_FALSE, &projection[0][0]);
+    RenderStats::Current().CountUniformUpload((viewLocation >= 0) + (projLocation >= 0));
+
+    GLint modelLocation = glGetUniformLocation(shader->shaderProgram, "u_ModelMatrix");
+
+    bool portalCulling = m_portalSystem && m_portalSystem->IsEnabled();
+    bool softwareCulling = m_softwareOcclusion && m_softwareOcclusion->IsEnabled();
+    bool hardwareCulling = m_occlusionCuller && m_occlusionCuller->IsEnabled();
+    glm::vec3 eye = glm::vec3(glm::inverse(view)[3]);
+
+    if (portalCulling) {
+        SyncPortalObjects();
+        m_portalSystem->ComputeVisibility(projection * view, eye);
+        m_portalSystem->GatherVisibleItems(m_interpolation, m_drawItems);
+    }
+    else {
+        GatherDrawItems(m_drawItems);
+    }
+
+    // The CPU test runs first, whatever it rejects never reaches the GPU
+    if (softwareCulling) {
+        m_softwareOcclusion->Update(m_drawItems, projection * view);
+        m_softwareOcclusion->Cull(m_drawItems);
+    }
+    // Portal and software rejections, the hardware culler counts its own
+    size_t candidates = m_entities.GetRenderables().Size() - m_entities.GetLights().Size();
+    if (candidates > m_drawItems.size()) {
+        RenderStats::Current().CountCulled(candidates - m_drawItems.size());
+    }
 
-    for (const auto& obj : m_objects) {
-        GLint modelLocation = glGetUniformLocation(m_shaderProgram, "u_ModelMatrix");
+    // Objects sharing a material are drawn back to back, so the material
+    // is bound once per run and the draws in between set only their matrix.
+    // Runs are grouped by texture first to keep texture binds down too.
+    // Objects with several submeshes sort by their first.
+    for (const DrawItem& item : m_drawItems) {
+        ResolveMaterial(item.mesh);
+    }
+    std::stable_sort(m_drawItems.begin(), m_drawItems.end(), [](const DrawItem& a, const DrawItem& b) {
+        const Material* materialA = a.mesh->GetMaterial();
+        const Material* materialB = b.mesh->GetMaterial();
+        return std::make_pair(TextureBindKey(materialA), materialA->GetSlot()) < std::make_pair(TextureBindKey(materialB), materialB->GetSlot());
+    });
+    if (m_textureStreamer) {
+        RequestTextures(view, projection, eye);
+    }
+    m_materials.PrepareShader(shader);
+    m_materials.Upload();
+    m_materials.ResetBindings();
+
+    auto drawItem = [&](const DrawItem& item) {
         if (modelLocation >= 0) {
-            glm::mat4 model = obj->GetModelMatrix();
-            glUniformMatrix4fv(modelLocation, 1, GL_FALSE, &model[0][0]);
+            glUniformMatrix4fv(modelLocation, 1, GL_FALSE, &item.model[0][0]);
+            RenderStats::Current().CountUniformUpload();
+        }
+        DrawObject(item.mesh);
+    };
+    if (hardwareCulling) {
+        m_occlusionCuller->Draw(m_drawItems, view, projection, eye, shader, drawItem);
+    }
+    else {
+        for (const DrawItem& item : m_drawItems) {
+            drawItem(item);
         }
+    }
+}
 
+void Scene::RequestTextures(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& eye) {
+    // Fraction of the viewport height covered by each object's bounding
+    // sphere, the streamer picks mip levels from it
+    Frustum frustum(projection * view);
+    for (const DrawItem& item : m_drawItems) {
+        if (!frustum.IntersectsSphere(item.center, item.radius)) {
+            continue;
+        }
 
-        // Draw object
-        if (obj->IsLightEmitter() == false) {
-            if (!obj->GetProcessedVerticies().empty()) {
-                obj->DrawModel(shader);
-            } else {
-                obj->Draw(shader);
+        float distance = glm::length(item.center - eye);
+        float fraction = distance > item.radius ? item.radius * projection[1][1] / distance : 1.0f;
+        for (size_t i = 0; i < item.mesh->GetSubmeshes().size(); i++) {
+            Texture* texture = item.mesh->GetMaterial(i)->GetTexture();
+            if (texture) {
+                m_textureStreamer->Request(texture, fraction);
             }
         }
     }
 }
 
+void Scene::ResolveMaterial(Mesh3D* obj) {
+    const std::vector<Submesh>& submeshes = obj->GetSubmeshes();
+    for (size_t i = 0; i < submeshes.size(); i++) {
+        if (!obj->GetMaterial(i)) {
+            obj->SetSharedMaterial(i, m_materials.GetDefault(submeshes[i].color, submeshes[i].texture));
+        }
+    }
+}
+
+void Scene::SyncPortalObjects() {
+    // Re-sort objects into cells whenever objects are added or static ones move
+    uint64_t staticVersion = GetStaticGeometryVersion();
+    size_t objectCount = m_entities.GetRenderables().Size();
+    if (staticVersion == m_portalStaticVersion && objectCount == m_portalObjectCount) {
+        return;
+    }
+
+    GatherDrawItems(m_drawItems);
+    m_portalSystem->AssignObjects(m_drawItems);
+    m_portalStaticVersion = staticVersion;
+    m_portalObjectCount = objectCount;
+}
+
+void Scene::DrawObject(Mesh3D* obj) {
+    // One draw per material, imports already merged submeshes sharing one
+    for (size_t i = 0; i < obj->GetSubmeshes().size(); i++) {
+        m_materials.Bind(obj->GetMaterial(i));
+        obj->DrawSubmesh(i);
+    }
+}
+
+void Scene::DrawDepth(const glm::mat4& view, const glm::mat4& projection, Shader* depthShader) {
+    HORSE_PROFILE_FUNCTION();
+
+    depthShader->useProgram();
+    depthShader->setUniformMat4("u_ViewMatrix", view);
+    depthShader->setUniformMat4("u_Projection", projection);
+
+    const ComponentPool<RenderableComponent>& renderables = m_entities.GetRenderables();
+    for (size_t i = 0; i < renderables.Size(); i++) {
+        Entity entity = renderables.GetEntities()[i];
+        if (m_entities.GetLights().Has(entity)) {
+            continue;
+        }
+
+        // Identical matrix to DrawObjects, the color pass tests GL_EQUAL
+        const TransformComponent& transform = m_entities.GetTransforms().Get(entity);
+        depthShader->setUniformMat4("u_ModelMatrix", transform.GetInterpolatedModelMatrix(m_interpolation));
+        renderables.GetComponents()[i].mesh->DrawDepth();
+    }
+}
+
 void Scene::DrawLightSources(const glm::mat4& view, const glm::mat4& projection, Shader* lightShader) {
+    HORSE_PROFILE_FUNCTION();
+
     lightShader->useProgram();
     lightShader->setUniformMat4("u_ViewMatrix", view);
     lightShader->setUniformMat4("u_Projection", projection);
 
-    for (auto& obj : m_objects) {
-        if (obj->IsLightEmitter()) {
-            glm::mat4 model = obj->GetModelMatrix();
-            lightShader->setUniformMat4("u_ModelMatrix", model);
+    for (Entity entity : m_entities.GetLights().GetEntities()) {
+        RenderableComponent* renderable = m_entities.GetRenderables().TryGet(entity);
+        if (!renderable) {
+            continue;
+        }
 
-            glm::vec3 lightColor = obj->GetColor();
-            lightShader->setUniformVec3("u_LightColor", lightColor);
+        glm::mat4 model = m_entities.GetTransforms().Get(entity).GetInterpolatedModelMatrix(m_interpolation);
+        lightShader->setUniformMat4("u_ModelMatrix", model);
 
-            obj->Draw(lightShader);
-        }
+        glm::vec3 lightColor = renderable->mesh->GetColor();
+        lightShader->setUniformVec3("u_LightColor", lightColor);
+
+        renderable->mesh->Draw();
     }
 }
 
 void Scene::UpdateAll() {
-    for (auto& obj : m_objects) {
-        obj->UpdateBuffers();
+    HORSE_PROFILE_FUNCTION();
+
+    for (RenderableComponent& renderable : m_entities.GetRenderables().GetComponents()) {
+        renderable.mesh->UpdateBuffers();
+    }
+}
+
+void Scene::GatherDrawItems(std::vector<DrawItem>& items) const {
+    items.clear();
+    const ComponentPool<RenderableComponent>& renderables = m_entities.GetRenderables();
+    for (size_t i = 0; i < renderables.Size(); i++) {
+        Entity entity = renderables.GetEntities()[i];
+        if (m_entities.GetLights().Has(entity)) {
+            continue;
+        }
+
+        DrawItem item;
+        item.mesh = renderables.GetComponents()[i].mesh.get();
+        item.model = m_entities.GetTransforms().Get(entity).GetInterpolatedModelMatrix(m_interpolation);
+        item.mesh->GetBoundingSphere(item.model, item.center, item.radius);
+        items.push_back(item);
+    }
+}
+
+uint64_t Scene::GetStaticGeometryVersion() const {
+    uint64_t count = 0;
+    uint64_t versions = 0;
+    const ComponentPool<TagComponent>& tags = m_entities.GetTags();
+    for (size_t i = 0; i < tags.Size(); i++) {
+        Entity entity = tags.GetEntities()[i];
+        if ((tags.GetComponents()[i].flags & TagComponent::Static) && !m_entities.GetLights().Has(entity) &&
+            m_entities.GetRenderables().Has(entity)) {
+            count++;
+            versions += m_entities.GetTransforms().Get(entity).version;
+        }
+    }
+    return (count << 40) ^ versions;
+}
+
+void Scene::StorePreviousTransforms() {
+    // One pass over the packed transforms
+    for (TransformComponent& transform : m_entities.GetTransforms().GetComponents()) {
+        transform.StorePrevious();
     }
 }
 
+void Scene::SetInterpolation(float alpha) {
+    m_interpolation = alpha;
+}
+
 void Scene::CleanUpAll() {
-    for (auto& obj : m_objects) {
-        obj->CleanUp();
+    if (m_occlusionCuller) {
+        m_occlusionCuller->Reset();
+    }
+    if (m_portalSystem) {
+        m_portalSystem->ClearObjects();
+        m_portalObjectCount = SIZE_MAX;
+    }
+    for (RenderableComponent& renderable : m_entities.GetRenderables().GetComponents()) {
+        renderable.mesh->CleanUp();
     }
-    m_objects.clear();
+    m_entities.Clear();
+    m_materials.CleanUp();
 }
\ No newline at end of file
@@ -0,0 +1,449 @@
+#include "SceneFile.hpp"
+#include "MeshData.hpp"
+#include "Profiler.hpp"
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+static_assert(sizeof(SceneFileHeader) % 8 == 0, "SceneFileHeader must keep the tables 8 byte aligned");
+static_assert(sizeof(SceneObjectRecord) % 8 == 0, "SceneObjectRecord must keep the tables 8 byte aligned");
+static_assert(sizeof(SceneAssetRecord) % 8 == 0, "SceneAssetRecord must keep the tables 8 byte aligned");
+
+// Object as parsed from text, before its strings move into the string table
+struct ParsedObject {
+    SceneObjectRecord record;
+    std::string name;
+    std::string modelPath;
+    std::string texturePath;
+};
+
+static uint64_t AlignUp(uint64_t value, uint64_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+static void SetVec3(float* target, float x, float y, float z) {
+    target[0] = x;
+    target[1] = y;
+    target[2] = z;
+}
+
+// Same defaults as a freshly created Mesh3D
+static void InitializeRecord(SceneObjectRecord& record) {
+    record = SceneObjectRecord();
+    record.shape = SceneObjectRecord::Cube;
+    record.model = -1;
+    record.texture = -1;
+    SetVec3(record.shapeSize, 1.0f, 1.0f, 1.0f);
+    SetVec3(record.rotationAxis, 0.0f, 1.0f, 0.0f);
+    SetVec3(record.scale, 1.0f, 1.0f, 1.0f);
+    SetVec3(record.color, 1.0f, 1.0f, 1.0f);
+    record.lightRadius = 10.0f;
+    record.lightIntensity = 1.0f;
+}
+
+// Offset of a null terminated string lying entirely inside the blob
+static bool IsValidString(const char* base, uint64_t size, uint64_t offset) {
+    return offset < size && std::memchr(base + offset, '\0', size - offset) != nullptr;
+}
+
+SceneFile::SceneFile() {
+}
+
+bool SceneFile::ParseText(const std::string& path, std::vector<uint64_t>& blob) {
+    HORSE_PROFILE_FUNCTION();
+
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "Failed to open scene file: " << path << std::endl;
+        return false;
+    }
+
+    int lineNumber = 0;
+    auto fail = [&](const std::string& message) {
+        std::cerr << path << ":" << lineNumber << ": " << message << std::endl;
+        return false;
+    };
+
+    std::vector<ParsedObject> objects;
+    std::string line;
+    while (std::getline(file, line)) {
+        lineNumber++;
+        std::istringstream in(line);
+        std::string keyword;
+        if (!(in >> keyword) || keyword[0] == '#') {
+            continue;
+        }
+
+        if (keyword == "object") {
+            ParsedObject object;
+            InitializeRecord(object.record);
+            SceneObjectRecord& record = object.record;
+
+            std::string shape;
+            if (!(in >> object.name >> shape)) {
+                return fail("expected object <name> <shape>");
+            }
+            float size;
+            if (shape == "cube" || shape == "pyramid") {
+                record.shape = shape == "cube" ? SceneObjectRecord::Cube : SceneObjectRecord::Pyramid;
+                if (in >> size) {
+                    SetVec3(record.shapeSize, size, size, size);
+                }
+            }
+            else if (shape == "wall") {
+                record.shape = SceneObjectRecord::Wall;
+                SetVec3(record.shapeSize, 2.0f, 0.1f, 6.0f);
+                float width, height;
+                if (in >> size >> width >> height) {
+                    SetVec3(record.shapeSize, size, width, height);
+                }
+            }
+            else if (shape == "model") {
+                record.shape = SceneObjectRecord::ModelShape;
+                if (!(in >> object.modelPath)) {
+                    return fail("expected object <name> model <path>");
+                }
+            }
+            else {
+                return fail("unknown shape " + shape);
+            }
+            objects.push_back(object);
+            continue;
+        }
+
+        if (objects.empty()) {
+            return fail(keyword + " before the first object");
+        }
+        SceneObjectRecord& record = objects.back().record;
+        bool valid = true;
+        if (keyword == "position") {
+            valid = static_cast<bool>(in >> record.position[0] >> record.position[1] >> record.position[2]);
+        }
+        else if (keyword == "rotation") {
+            valid = static_cast<bool>(in >> record.rotationAngle >> record.rotationAxis[0] >> record.rotationAxis[1] >> record.rotationAxis[2]);
+        }
+        else if (keyword == "scale") {
+            valid = static_cast<bool>(in >> record.scale[0] >> record.scale[1] >> record.scale[2]);
+        }
+        else if (keyword == "color") {
+            valid = static_cast<bool>(in >> record.color[0] >> record.color[1] >> record.color[2]);
+            record.flags |= SceneObjectRecord::HasColor;
+        }
+        else if (keyword == "texture") {
+            valid = static_cast<bool>(in >> objects.back().texturePath);
+        }
+        else if (keyword == "light") {
+            record.flags |= SceneObjectRecord::LightEmitter;
+            float radius, intensity;
+            if (in >> radius) {
+                record.lightRadius = radius;
+                if (in >> intensity) {
+                    record.lightIntensity = intensity;
+                }
+            }
+        }
+        else if (keyword == "static") {
+            record.flags |= SceneObjectRecord::Static;
+        }
+        else if (keyword == "occluder") {
+            record.flags |= SceneObjectRecord::Occluder;
+        }
+        else {
+            return fail("unknown property " + keyword);
+        }
+        if (!valid) {
+            return fail("malformed " + keyword);
+        }
+    }
+
+    // Each file is loaded once however many objects use it
+    std::vector<std::pair<std::string, uint32_t>> assets;
+    std::map<std::pair<std::string, uint32_t>, int32_t> assetIndices;
+    auto addAsset = [&](const std::string& assetPath, uint32_t kind) {
+        auto key = std::make_pair(assetPath, kind);
+        auto it = assetIndices.find(key);
+        if (it != assetIndices.end()) {
+            return it->second;
+        }
+        int32_t index = static_cast<int32_t>(assets.size());
+        assets.push_back(key);
+        assetIndices[key] = index;
+        return index;
+    };
+    for (ParsedObject& object : objects) {
+        if (!object.modelPath.empty()) {
+            object.record.model = addAsset(object.modelPath, SceneAssetRecord::Model);
+        }
+        if (!object.texturePath.empty()) {
+            object.record.texture = addAsset(object.texturePath, SceneAssetRecord::Texture);
+        }
+    }
+
+    // Header, object table, asset table, string table
+    uint64_t objectsOffset = sizeof(SceneFileHeader);
+    uint64_t assetsOffset = objectsOffset + objects.size() * sizeof(SceneObjectRecord);
+    uint64_t stringsOffset = assetsOffset + assets.size() * sizeof(SceneAssetRecord);
+
+    std::string strings;
+    auto addString = [&](const std::string& value) {
+        uint64_t offset = stringsOffset + strings.size();
+        strings += value;
+        strings += '\0';
+        return offset;
+    };
+
+    std::vector<SceneObjectRecord> objectRecords;
+    for (ParsedObject& object : objects) {
+        object.record.name.value = addString(object.name);
+        objectRecords.push_back(object.record);
+    }
+    std::vector<SceneAssetRecord> assetRecords;
+    for (const auto& asset : assets) {
+        SceneAssetRecord record;
+        record.path.value = addString(asset.first);
+        record.kind = asset.second;
+        assetRecords.push_back(record);
+    }
+
+    uint64_t size = AlignUp(stringsOffset + strings.size(), 8);
+    blob.assign(size / 8, 0);
+    char* base = reinterpret_cast<char*>(blob.data());
+
+    SceneFileHeader header;
+    header.magic = SceneFileHeader::kMagic;
+    header.version = SceneFileHeader::kVersion;
+    header.size = size;
+    header.objectCount = static_cast<uint32_t>(objectRecords.size());
+    header.assetCount = static_cast<uint32_t>(assetRecords.size());
+    header.objects.value = objectsOffset;
+    header.assets.value = assetsOffset;
+
+    std::memcpy(base, &header, sizeof(header));
+    if (!objectRecords.empty()) {
+        std::memcpy(base + objectsOffset, objectRecords.data(), objectRecords.size() * sizeof(SceneObjectRecord));
+    }
+    if (!assetRecords.empty()) {
+        std::memcpy(base + assetsOffset, assetRecords.data(), assetRecords.size() * sizeof(SceneAssetRecord));
+    }
+    std::memcpy(base + stringsOffset, strings.data(), strings.size());
+    return true;
+}
+
+bool SceneFile::Compile(const std::string& textPath, const std::string& binaryPath) {
+    std::vector<uint64_t> blob;
+    if (!ParseText(textPath, blob)) {
+        return false;
+    }
+
+    std::ofstream file(binaryPath, std::ios::binary);
+    file.write(reinterpret_cast<const char*>(blob.data()), blob.size() * sizeof(uint64_t));
+    if (!file) {
+        std::cerr << "Failed to write scene file: " << binaryPath << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool SceneFile::Load(const std::string& path) {
+    HORSE_PROFILE_FUNCTION();
+
+    m_blob.clear();
+    m_header = nullptr;
+
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) {
+        std::cerr << "Failed to open scene file: " << path << std::endl;
+        return false;
+    }
+    uint64_t size = static_cast<uint64_t>(file.tellg());
+    file.seekg(0);
+
+    // The whole file in one read, straight into the memory it is used from
+    m_blob.assign(AlignUp(size, 8) / 8, 0);
+    file.read(reinterpret_cast<char*>(m_blob.data()), static_cast<std::streamsize>(size));
+    if (!file) {
+        std::cerr << "Failed to read scene file: " << path << std::endl;
+        m_blob.clear();
+        return false;
+    }
+
+    // Text descriptions lack the magic and are compiled in memory instead
+    if (size < sizeof(uint32_t) || reinterpret_cast<const SceneFileHeader*>(m_blob.data())->magic != SceneFileHeader::kMagic) {
+        if (!ParseText(path, m_blob)) {
+            m_blob.clear();
+            return false;
+        }
+        size = m_blob.size() * sizeof(uint64_t);
+    }
+
+    if (!Relocate(size)) {
+        std::cerr << "Invalid scene file: " << path << std::endl;
+        m_blob.clear();
+        return false;
+    }
+    return true;
+}
+
+bool SceneFile::Relocate(uint64_t size) {
+    const char* base = reinterpret_cast<const char*>(m_blob.data());
+    SceneFileHeader* header = reinterpret_cast<SceneFileHeader*>(m_blob.data());
+    if (size < sizeof(SceneFileHeader) || header->magic != SceneFileHeader::kMagic ||
+        header->version != SceneFileHeader::kVersion || header->size != size) {
+        return false;
+    }
+
+    // Tables must be aligned and inside the blob. Compared by division so a
+    // crafted offset cannot wrap the end around.
+    uint64_t objectsOffset = header->objects.value;
+    uint64_t assetsOffset = header->assets.value;
+    if (objectsOffset % 8 != 0 || assetsOffset % 8 != 0 || objectsOffset > size || assetsOffset > size ||
+        header->objectCount > (size - objectsOffset) / sizeof(SceneObjectRecord) ||
+        header->assetCount > (size - assetsOffset) / sizeof(SceneAssetRecord)) {
+        return false;
+    }
+
+    SceneObjectRecord* objects = reinterpret_cast<SceneObjectRecord*>(m_blob.data() + header->objects.value / 8);
+    SceneAssetRecord* assets = reinterpret_cast<SceneAssetRecord*>(m_blob.data() + header->assets.value / 8);
+    for (uint32_t i = 0; i < header->assetCount; i++) {
+        if (assets[i].kind > SceneAssetRecord::Texture || !IsValidString(base, size, assets[i].path.value)) {
+            return false;
+        }
+    }
+    for (uint32_t i = 0; i < header->objectCount; i++) {
+        const SceneObjectRecord& object = objects[i];
+        bool isModel = object.shape == SceneObjectRecord::ModelShape;
+        if (object.shape > SceneObjectRecord::ModelShape || !IsValidString(base, size, object.name.value)) {
+            return false;
+        }
+        if (isModel != (object.model >= 0) || object.model >= static_cast<int32_t>(header->assetCount) ||
+            object.texture >= static_cast<int32_t>(header->assetCount)) {
+            return false;
+        }
+        if ((isModel && assets[object.model].kind != SceneAssetRecord::Model) ||
+            (object.texture >= 0 && assets[object.texture].kind != SceneAssetRecord::Texture)) {
+            return false;
+        }
+    }
+
+    // Offsets become pointers into the blob
+    header->objects.Relocate(base);
+    header->assets.Relocate(base);
+    for (uint32_t i = 0; i < header->objectCount; i++) {
+        objects[i].name.Relocate(base);
+    }
+    for (uint32_t i = 0; i < header->assetCount; i++) {
+        assets[i].path.Relocate(base);
+    }
+    m_header = header;
+    return true;
+}
+
+uint32_t SceneFile::GetObjectCount() const {
+    return m_header ? m_header->objectCount : 0;
+}
+
+uint32_t SceneFile::GetAssetCount() const {
+    return m_header ? m_header->assetCount : 0;
+}
+
+const SceneObjectRecord& SceneFile::GetObject(uint32_t index) const {
+    return m_header->objects.Get()[index];
+}
+
+const SceneAssetRecord& SceneFile::GetAsset(uint32_t index) const {
+    return m_header->assets.Get()[index];
+}
+
+MeshData SceneFile::CreateShape(const SceneObjectRecord& object) {
+    switch (object.shape) {
+    case SceneObjectRecord::Pyramid: return MeshData::CreatePyramid(object.shapeSize[0]);
+    case SceneObjectRecord::Wall: return MeshData::CreateWall(object.shapeSize[0], object.shapeSize[1], object.shapeSize[2]);
+    default: return MeshData::CreateCube(object.shapeSize[0]);
+    }
+}
+
+std::vector<Mesh3D*> SceneFile::Instantiate(Scene& scene, JobSystem* jobSystem) {
+    HORSE_PROFILE_FUNCTION();
+
+    std::vector<Mesh3D*> result;
+    if (!m_header) {
+        return result;
+    }
+
+    // Texture decodes go to the workers first and overlap the model imports
+    bool parallel = jobSystem && jobSystem->IsInitialized();
+    JobCounter textureCounter;
+    m_textures.clear();
+    m_textures.resize(m_header->assetCount);
+    for (uint32_t i = 0; i < m_header->assetCount; i++) {
+        const SceneAssetRecord& asset = GetAsset(i);
+        if (asset.kind != SceneAssetRecord::Texture) {
+            continue;
+        }
+        m_textures[i] = std::make_unique<Texture>();
+        Texture* texture = m_textures[i].get();
+        std::string path = asset.path.Get();
+        auto decode = [texture, path]() {
+            texture->LoadImageData(path);
+        };
+        if (parallel) {
+            jobSystem->Run(decode, &textureCounter);
+        }
+        else {
+            decode();
+        }
+    }
+
+    std::vector<ModelRequest> requests;
+    for (uint32_t i = 0; i < m_header->objectCount; i++) {
+        const SceneObjectRecord& object = GetObject(i);
+        if (object.shape == SceneObjectRecord::ModelShape) {
+            requests.push_back({ object.name.Get(), GetAsset(object.model).path.Get() });
+        }
+    }
+    std::vector<Mesh3D*> models = scene.CreateModels(requests);
+
+    if (parallel) {
+        jobSystem->Wait(&textureCounter);
+    }
+    for (auto& texture : m_textures) {
+        if (texture && texture->HasPendingUpload()) {
+            texture->Upload();
+        }
+    }
+
+    size_t modelIndex = 0;
+    for (uint32_t i = 0; i < m_header->objectCount; i++) {
+        const SceneObjectRecord& object = GetObject(i);
+        Mesh3D* mesh = object.shape == SceneObjectRecord::ModelShape ?
+            models[modelIndex++] : scene.CreateObject(object.name.Get(), CreateShape(object));
+
+        mesh->SetPosition(glm::vec3(object.position[0], object.position[1], object.position[2]));
+        mesh->SetRotation(object.rotationAngle, glm::vec3(object.rotationAxis[0], object.rotationAxis[1], object.rotationAxis[2]));
+        mesh->SetScale(glm::vec3(object.scale[0], object.scale[1], object.scale[2]));
+        if (object.shape != SceneObjectRecord::ModelShape || (object.flags & SceneObjectRecord::HasColor)) {
+            mesh->SetColor(glm::vec3(object.color[0], object.color[1], object.color[2]));
+        }
+        if (object.texture >= 0) {
+            mesh->SetTexture(m_textures[object.texture].get());
+        }
+        mesh->SetStatic((object.flags & SceneObjectRecord::Static) != 0);
+        mesh->SetOccluder((object.flags & SceneObjectRecord::Occluder) != 0);
+        mesh->SetLightEmitter((object.flags & SceneObjectRecord::LightEmitter) != 0);
+        mesh->SetLightRadius(object.lightRadius);
+        mesh->SetLightIntensity(object.lightIntensity);
+        result.push_back(mesh);
+    }
+    return result;
+}
+
+void SceneFile::CleanUp() {
+    for (auto& texture : m_textures) {
+        if (texture) {
+            texture->CleanUp();
+        }
+    }
+    m_textures.clear();
+}
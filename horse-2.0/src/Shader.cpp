@@ -1,4 +1,5 @@
 #include "Shader.hpp"
+#include "RenderStats.hpp"
 #include <fstream>
 #include <sstream>
 #include <iostream>
@@ -54,6 +55,7 @@ Shader::Shader(const std::string& vertexPath, const std::string& fragmentPath) {
 
 void Shader::useProgram() {
     glUseProgram(shaderProgram);
+    RenderStats::Current().CountShaderBind();
 }
 
 void Shader::deleteProgram() {
@@ -73,22 +75,37 @@ GLint Shader::getUniformLocation(const std::string& name) {
 
 void Shader::setBool(const std::string& name, bool value) const {
     glUniform1i(glGetUniformLocation(shaderProgram, name.c_str()), (int)value);
+    RenderStats::Current().CountUniformUpload();
 }
 
 void Shader::setInt(const std::string& name, int value) const {
     glUniform1i(glGetUniformLocation(shaderProgram, name.c_str()), value);
+    RenderStats::Current().CountUniformUpload();
 }
 
 void Shader::setFloat(const std::string& name, float value) const {
     glUniform1f(glGetUniformLocation(shaderProgram, name.c_str()), value);
+    RenderStats::Current().CountUniformUpload();
+}
+
+void Shader::setUniformVec2(const std::string& name, const glm::vec2& value) const {
+    glUniform2fv(glGetUniformLocation(shaderProgram, name.c_str()), 1, glm::value_ptr(value));
+    RenderStats::Current().CountUniformUpload();
+}
+
+void Shader::setUniformIVec3(const std::string& name, const glm::ivec3& value) const {
+    glUniform3i(glGetUniformLocation(shaderProgram, name.c_str()), value.x, value.y, value.z);
+    RenderStats::Current().CountUniformUpload();
 }
 
 void Shader::setUniformVec3(const std::string& name, const glm::vec3& value) const {
     glUniform3fv(glGetUniformLocation(shaderProgram, name.c_str()), 1, glm::value_ptr(value));
+    RenderStats::Current().CountUniformUpload();
 }
 
 void Shader::setUniformMat4(const std::string& name, const glm::mat4x4& value) const {
     glUniformMatrix4fv(glGetUniformLocation(shaderProgram, name.c_str()), 1, GL_FALSE, glm::value_ptr(value));
+    RenderStats::Current().CountUniformUpload();
 }
 
 void Shader::checkCompileErrors(GLuint shader, std::string type) {
@@ -0,0 +1,327 @@
+#include "ShadowMaps.hpp"
+#include "GpuMemory.hpp"
+#include "Profiler.hpp"
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+// Casters up to this far behind a cascade (towards the sun) still shadow it
+static const float kCasterPullback = 50.0f;
+// Cascade split blend between uniform (0) and logarithmic (1) spacing
+static const float kCascadeSplitLambda = 0.75f;
+
+ShadowMaps::ShadowMaps() {
+}
+
+void ShadowMaps::Initialize() {
+    if (m_initialized) {
+        return;
+    }
+
+    m_pointCache = CreateDepthArray(GL_TEXTURE_CUBE_MAP_ARRAY, GL_DEPTH_COMPONENT16, kCubeSize, kMaxPointShadows * 6);
+    m_pointShadowMaps = CreateDepthArray(GL_TEXTURE_CUBE_MAP_ARRAY, GL_DEPTH_COMPONENT16, kCubeSize, kMaxPointShadows * 6);
+    m_cascadeCache = CreateDepthArray(GL_TEXTURE_2D_ARRAY, GL_DEPTH_COMPONENT24, kCascadeSize, kCascadeCount);
+    m_cascadeShadowMaps = CreateDepthArray(GL_TEXTURE_2D_ARRAY, GL_DEPTH_COMPONENT24, kCascadeSize, kCascadeCount);
+
+    // Only the sampled maps compare, the caches are just copied from
+    GLuint sampled[] = { m_pointShadowMaps, m_cascadeShadowMaps };
+    GLenum targets[] = { GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_2D_ARRAY };
+    for (int i = 0; i < 2; i++) {
+        glBindTexture(targets[i], sampled[i]);
+        glTexParameteri(targets[i], GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(targets[i], GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(targets[i], GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+        glTexParameteri(targets[i], GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+        glBindTexture(targets[i], 0);
+    }
+
+    // Depth only targets
+    GLuint framebuffers[2];
+    glGenFramebuffers(2, framebuffers);
+    m_drawFramebuffer = framebuffers[0];
+    m_readFramebuffer = framebuffers[1];
+    for (GLuint framebuffer : framebuffers) {
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    m_initialized = true;
+}
+
+void ShadowMaps::CleanUp() {
+    if (!m_initialized) {
+        return;
+    }
+
+    GLuint textures[] = { m_pointCache, m_pointShadowMaps, m_cascadeCache, m_cascadeShadowMaps };
+    glDeleteTextures(4, textures);
+    for (GLuint texture : textures) {
+        GpuMemory::Get().ReleaseTexture(texture);
+    }
+    GLuint framebuffers[] = { m_drawFramebuffer, m_readFramebuffer };
+    glDeleteFramebuffers(2, framebuffers);
+
+    m_pointCache = m_pointShadowMaps = m_cascadeCache = m_cascadeShadowMaps = 0;
+    m_drawFramebuffer = m_readFramebuffer = 0;
+    for (PointShadow& shadow : m_pointShadows) {
+        shadow = PointShadow();
+    }
+    for (Cascade& cascade : m_cascades) {
+        cascade = Cascade();
+    }
+    m_initialized = false;
+}
+
+GLuint ShadowMaps::CreateDepthArray(GLenum target, GLenum internalFormat, int size, int layers) {
+    GLuint texture = 0;
+    glGenTextures(1, &texture);
+    glBindTexture(target, texture);
+    glTexImage3D(target, 0, internalFormat, size, size, layers, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, nullptr);
+    int bytesPerTexel = internalFormat == GL_DEPTH_COMPONENT16 ? 2 : 4;
+    GpuMemory::Get().TrackTexture(texture, GpuMemory::RenderTargets, GpuMemory::TextureBytes(size, size, layers, bytesPerTexel), "shadow maps");
+    glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(target, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    glBindTexture(target, 0);
+    return texture;
+}
+
+void ShadowMaps::Update(const Scene& scene, const std::vector<PointLight>& lights, Shader* depthShader,
+    const glm::mat4& view, const glm::mat4& projection, float nearPlane, float farPlane) {
+    HORSE_PROFILE_FUNCTION();
+
+    m_staticViewsRendered = 0;
+    m_dynamicViewsRendered = 0;
+    m_pointShadowCount = 0;
+    if (!m_enabled) {
+        return;
+    }
+
+    m_depthShader = depthShader;
+    m_depthShader->useProgram();
+    scene.GatherDrawItems(m_items);
+    uint64_t staticVersion = scene.GetStaticGeometryVersion();
+
+    glBindFramebuffer(GL_FRAMEBUFFER, m_drawFramebuffer);
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_LESS);
+
+    m_pointShadowCount = static_cast<int>(std::min(lights.size(), static_cast<size_t>(kMaxPointShadows)));
+    for (int i = 0; i < m_pointShadowCount; i++) {
+        UpdatePointShadow(i, lights[i], staticVersion);
+    }
+
+    UpdateCascades(view, projection, nearPlane, farPlane, staticVersion);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void ShadowMaps::UpdatePointShadow(int slot, const PointLight& light, uint64_t staticVersion) {
+    PointShadow& shadow = m_pointShadows[slot];
+    bool refreshStatic = !shadow.valid || shadow.position != light.position || shadow.radius != light.radius || shadow.staticVersion != staticVersion;
+
+    // +X, -X, +Y, -Y, +Z, -Z with the cube map face orientations
+    static const glm::vec3 directions[6] = {
+        { 1.0f, 0.0f, 0.0f }, { -1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f },
+        { 0.0f, -1.0f, 0.0f }, { 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f, -1.0f },
+    };
+    static const glm::vec3 ups[6] = {
+        { 0.0f, -1.0f, 0.0f }, { 0.0f, -1.0f, 0.0f }, { 0.0f, 0.0f, 1.0f },
+        { 0.0f, 0.0f, -1.0f }, { 0.0f, -1.0f, 0.0f }, { 0.0f, -1.0f, 0.0f },
+    };
+
+    // Depth is stored as distance / radius so the shader can compare along
+    // any direction without knowing the face
+    m_depthShader->setBool("u_linearDepth", true);
+    m_depthShader->setUniformVec3("u_lightPos", light.position);
+    m_depthShader->setFloat("u_lightRadius", light.radius);
+
+    glm::mat4 projection = glm::perspective(glm::radians(90.0f), 1.0f, 0.05f, light.radius);
+    for (int face = 0; face < 6; face++) {
+        ShadowView& view = shadow.faces[face];
+        view.viewProjection = projection * glm::lookAt(light.position, light.position + directions[face], ups[face]);
+        RenderView(view, refreshStatic, m_pointCache, m_pointShadowMaps, slot * 6 + face, kCubeSize);
+    }
+
+    shadow.valid = true;
+    shadow.position = light.position;
+    shadow.radius = light.radius;
+    shadow.staticVersion = staticVersion;
+}
+
+void ShadowMaps::UpdateCascades(const glm::mat4& view, const glm::mat4& projection, float nearPlane, float farPlane, uint64_t staticVersion) {
+    m_depthShader->setBool("u_linearDepth", false);
+
+    // View frustum corners, near plane first
+    glm::mat4 inverseViewProjection = glm::inverse(projection * view);
+    glm::vec3 frustumCorners[8];
+    for (int i = 0; i < 8; i++) {
+        glm::vec4 ndc((i & 1) ? 1.0f : -1.0f, (i & 2) ? 1.0f : -1.0f, (i & 4) ? 1.0f : -1.0f, 1.0f);
+        glm::vec4 world = inverseViewProjection * ndc;
+        frustumCorners[i] = glm::vec3(world) / world.w;
+    }
+
+    float shadowFar = std::min(farPlane, m_shadowDistance);
+    float splitNear = nearPlane;
+    for (int i = 0; i < kCascadeCount; i++) {
+        // Practical split scheme
+        float p = static_cast<float>(i + 1) / kCascadeCount;
+        float logSplit = nearPlane * std::pow(shadowFar / nearPlane, p);
+        float uniformSplit = nearPlane + (shadowFar - nearPlane) * p;
+        float splitFar = kCascadeSplitLambda * logSplit + (1.0f - kCascadeSplitLambda) * uniformSplit;
+
+        // Points along each corner ray are linear in view depth
+        glm::vec3 corners[8];
+        float t0 = (splitNear - nearPlane) / (farPlane - nearPlane);
+        float t1 = (splitFar - nearPlane) / (farPlane - nearPlane);
+        for (int c = 0; c < 4; c++) {
+            glm::vec3 ray = frustumCorners[c + 4] - frustumCorners[c];
+            corners[c] = frustumCorners[c] + ray * t0;
+            corners[c + 4] = frustumCorners[c] + ray * t1;
+        }
+
+        Cascade& cascade = m_cascades[i];
+        glm::mat4 viewProjection = FitCascade(corners);
+        bool refreshStatic = !cascade.valid || cascade.view.viewProjection != viewProjection || cascade.staticVersion != staticVersion;
+        cascade.view.viewProjection = viewProjection;
+        cascade.splitDepth = splitFar;
+        RenderView(cascade.view, refreshStatic, m_cascadeCache, m_cascadeShadowMaps, i, kCascadeSize);
+
+        cascade.valid = true;
+        cascade.staticVersion = staticVersion;
+        splitNear = splitFar;
+    }
+}
+
+glm::mat4 ShadowMaps::FitCascade(const glm::vec3 corners[8]) const {
+    glm::vec3 direction = glm::normalize(m_sun.direction);
+    glm::vec3 up = std::fabs(direction.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+
+    // Bounding sphere of the slice, its size does not change as the camera
+    // turns so the cascade never swims
+    glm::vec3 center(0.0f);
+    for (int i = 0; i < 8; i++) {
+        center += corners[i];
+    }
+    center /= 8.0f;
+    float radius = 0.0f;
+    for (int i = 0; i < 8; i++) {
+        radius = std::max(radius, glm::length(corners[i] - center));
+    }
+    radius = std::ceil(radius * 16.0f) / 16.0f;
+
+    // Snap the center to whole texels in light space (and coarse steps
+    // along the light) so the matrix only changes when the camera has moved
+    // far enough to matter. Unchanged matrices keep the static cache valid.
+    glm::mat4 lightRotation = glm::lookAt(glm::vec3(0.0f), direction, up);
+    glm::vec3 lightCenter = glm::vec3(lightRotation * glm::vec4(center, 1.0f));
+    float texel = 2.0f * radius / kCascadeSize;
+    float depthStep = radius * 0.25f;
+    lightCenter.x = std::floor(lightCenter.x / texel) * texel;
+    lightCenter.y = std::floor(lightCenter.y / texel) * texel;
+    lightCenter.z = std::floor(lightCenter.z / depthStep) * depthStep;
+    center = glm::vec3(glm::inverse(lightRotation) * glm::vec4(lightCenter, 1.0f));
+
+    float pullback = radius + kCasterPullback;
+    glm::mat4 lightView = glm::lookAt(center - direction * pullback, center, up);
+    glm::mat4 lightProjection = glm::ortho(-radius, radius, -radius, radius, 0.0f, pullback + radius + depthStep);
+    return lightProjection * lightView;
+}
+
+void ShadowMaps::RenderView(ShadowView& view, bool refreshStatic, GLuint cacheTexture, GLuint texture, int layer, int size) {
+    Frustum frustum(view.viewProjection);
+
+    // FNV-1a over which dynamic casters are in view and where they are
+    uint64_t dynamicHash = 14695981039346656037ull;
+    auto hashBytes = [&dynamicHash](const void* data, size_t size) {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < size; i++) {
+            dynamicHash = (dynamicHash ^ bytes[i]) * 1099511628211ull;
+        }
+    };
+
+    m_dynamicCasters.clear();
+    for (const DrawItem& item : m_items) {
+        if (!item.mesh->IsStatic() && frustum.IntersectsSphere(item.center, item.radius)) {
+            m_dynamicCasters.push_back(&item);
+            hashBytes(&item.mesh, sizeof(item.mesh));
+            hashBytes(&item.model, sizeof(item.model));
+        }
+    }
+
+    // Nothing moved through this view, last frame's result still holds
+    if (!refreshStatic && dynamicHash == view.dynamicHash) {
+        return;
+    }
+    view.dynamicHash = dynamicHash;
+    bool hasDynamicCasters = !m_dynamicCasters.empty();
+
+    glViewport(0, 0, size, size);
+    m_depthShader->setUniformMat4("u_LightViewProjection", view.viewProjection);
+
+    if (refreshStatic) {
+        m_staticCasters.clear();
+        for (const DrawItem& item : m_items) {
+            if (item.mesh->IsStatic() && frustum.IntersectsSphere(item.center, item.radius)) {
+                m_staticCasters.push_back(&item);
+            }
+        }
+
+        glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, cacheTexture, 0, layer);
+        glClear(GL_DEPTH_BUFFER_BIT);
+        DrawCasters(m_staticCasters);
+        m_staticViewsRendered++;
+    }
+
+    // Start the sampled layer from the static cache
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_readFramebuffer);
+    glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, cacheTexture, 0, layer);
+    glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, texture, 0, layer);
+    glBlitFramebuffer(0, 0, size, size, 0, 0, size, size, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+
+    if (hasDynamicCasters) {
+        DrawCasters(m_dynamicCasters);
+        m_dynamicViewsRendered++;
+    }
+}
+
+void ShadowMaps::DrawCasters(const std::vector<const DrawItem*>& casters) {
+    for (const DrawItem* item : casters) {
+        m_depthShader->setUniformMat4("u_ModelMatrix", item->model);
+        item->mesh->DrawDepth();
+    }
+}
+
+void ShadowMaps::Bind(Shader* shader) {
+    glActiveTexture(GL_TEXTURE0 + kPointShadowUnit);
+    glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, m_pointShadowMaps);
+    glActiveTexture(GL_TEXTURE0 + kCascadeShadowUnit);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_cascadeShadowMaps);
+    glActiveTexture(GL_TEXTURE0);
+
+    shader->setInt("u_pointShadows", kPointShadowUnit);
+    shader->setInt("u_cascadeShadows", kCascadeShadowUnit);
+    shader->setBool("u_shadowsEnabled", m_enabled);
+    shader->setInt("u_shadowedLightCount", m_enabled ? m_pointShadowCount : 0);
+
+    glm::vec3 splits(0.0f);
+    for (int i = 0; i < kCascadeCount; i++) {
+        shader->setUniformMat4("u_cascadeMatrices[" + std::to_string(i) + "]", m_cascades[i].view.viewProjection);
+        splits[i] = m_cascades[i].splitDepth;
+    }
+    shader->setUniformVec3("u_cascadeSplits", splits);
+
+    shader->setUniformVec3("u_sunDirection", glm::normalize(m_sun.direction));
+    shader->setUniformVec3("u_sunColor", m_sun.color * m_sun.intensity);
+}
+
+size_t ShadowMaps::GetMemoryBytes() const {
+    size_t cube = static_cast<size_t>(kCubeSize) * kCubeSize * 2 * 6 * kMaxPointShadows;
+    size_t cascades = static_cast<size_t>(kCascadeSize) * kCascadeSize * 4 * kCascadeCount;
+    return 2 * (cube + cascades);
+}
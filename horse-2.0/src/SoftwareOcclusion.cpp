@@ -0,0 +1,443 @@
+#include "SoftwareOcclusion.hpp"
+#include "Mesh3D.hpp"
+#include "Profiler.hpp"
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define HORSE_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+// MSVC emits AVX2 intrinsics without /arch:AVX2
+#define HORSE_TARGET_AVX2
+#else
+#define HORSE_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+SoftwareOcclusion::SoftwareOcclusion() {
+    m_useSimd = HasAvx2();
+}
+
+bool SoftwareOcclusion::HasAvx2() {
+    static const bool hasAvx2 = [] {
+#if !defined(HORSE_X86)
+        return false;
+#elif defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7) {
+            return false;
+        }
+
+        // The OS must save the YMM registers too
+        __cpuid(info, 1);
+        bool osxsave = (info[2] & (1 << 27)) != 0;
+        bool avx = (info[2] & (1 << 28)) != 0;
+        if (!osxsave || !avx || (_xgetbv(0) & 6) != 6) {
+            return false;
+        }
+
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+#else
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") != 0;
+#endif
+    }();
+    return hasAvx2;
+}
+
+void SoftwareOcclusion::Update(const std::vector<DrawItem>& items, const glm::mat4& viewProjection) {
+    HORSE_PROFILE_FUNCTION();
+
+    m_stats = Stats();
+
+    // FNV-1a over the view and every occluder transform
+    uint64_t hash = 14695981039346656037ull;
+    auto hashBytes = [&hash](const void* data, size_t size) {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < size; i++) {
+            hash = (hash ^ bytes[i]) * 1099511628211ull;
+        }
+    };
+    hashBytes(&viewProjection, sizeof(viewProjection));
+    for (const DrawItem& item : items) {
+        if (item.mesh->IsOccluder()) {
+            hashBytes(&item.mesh, sizeof(item.mesh));
+            hashBytes(&item.model, sizeof(item.model));
+            m_stats.occluders++;
+        }
+    }
+
+    if (hash == m_hash && !m_depth.empty()) {
+        return;
+    }
+    m_hash = hash;
+    m_viewProjection = viewProjection;
+
+    m_triangles.clear();
+    for (const DrawItem& item : items) {
+        if (item.mesh->IsOccluder()) {
+            SetupTriangles(item);
+        }
+    }
+    m_stats.triangles = static_cast<uint32_t>(m_triangles.size());
+
+    Rasterize();
+    m_stats.rasterized = true;
+}
+
+void SoftwareOcclusion::Rasterize() {
+    // Bands write disjoint rows, so they need no synchronization
+    m_depth.assign(kWidth * kHeight, 1.0f);
+    const int bandCount = kHeight / kBandHeight;
+    if (m_jobSystem && m_jobSystem->IsInitialized()) {
+        m_jobSystem->ParallelFor(bandCount, 1, [this](uint32_t begin, uint32_t end) {
+            for (uint32_t band = begin; band < end; band++) {
+                RasterizeBand(static_cast<int>(band));
+            }
+        });
+    }
+    else {
+        for (int band = 0; band < bandCount; band++) {
+            RasterizeBand(band);
+        }
+    }
+}
+
+void SoftwareOcclusion::SetupTriangles(const DrawItem& item) {
+    const std::vector<glm::vec3>& positions = item.mesh->GetPositions();
+    const std::vector<GLuint>& indices = item.mesh->GetIndices();
+    if (positions.empty()) {
+        return;
+    }
+
+    glm::mat4 modelViewProjection = m_viewProjection * item.model;
+    m_clip.resize(positions.size());
+    for (size_t i = 0; i < positions.size(); i++) {
+        m_clip[i] = modelViewProjection * glm::vec4(positions[i], 1.0f);
+    }
+
+    // Submesh indices are relative to their base vertex
+    for (const Submesh& submesh : item.mesh->GetSubmeshes()) {
+        AddTriangles(indices.data() + submesh.indexOffset, submesh.indexCount, submesh.baseVertex);
+    }
+}
+
+void SoftwareOcclusion::AddTriangles(const GLuint* indices, size_t indexCount, GLint baseVertex) {
+    for (size_t i = 0; i + 2 < indexCount; i += 3) {
+        glm::vec3 v[3];
+        bool clipped = false;
+        for (int k = 0; k < 3; k++) {
+            const glm::vec4& clip = m_clip[baseVertex + indices[i + k]];
+            // Triangles through the near plane are dropped rather than
+            // clipped, an occluder covering less is still correct
+            if (clip.w <= 0.0f || clip.z < -clip.w) {
+                clipped = true;
+                break;
+            }
+            float invW = 1.0f / clip.w;
+            v[k] = glm::vec3((clip.x * invW * 0.5f + 0.5f) * kWidth, (clip.y * invW * 0.5f + 0.5f) * kHeight, clip.z * invW);
+        }
+        if (clipped) {
+            continue;
+        }
+
+        // Either winding is rasterized, flipped to counter-clockwise
+        float area = (v[1].x - v[0].x) * (v[2].y - v[0].y) - (v[2].x - v[0].x) * (v[1].y - v[0].y);
+        if (std::fabs(area) < 1e-6f) {
+            continue;
+        }
+        if (area < 0.0f) {
+            std::swap(v[1], v[2]);
+            area = -area;
+        }
+
+        ScreenTriangle triangle;
+        triangle.minX = std::max(0, static_cast<int>(std::floor(std::min({ v[0].x, v[1].x, v[2].x }))));
+        triangle.maxX = std::min(kWidth - 1, static_cast<int>(std::floor(std::max({ v[0].x, v[1].x, v[2].x }))));
+        triangle.minY = std::max(0, static_cast<int>(std::floor(std::min({ v[0].y, v[1].y, v[2].y }))));
+        triangle.maxY = std::min(kHeight - 1, static_cast<int>(std::floor(std::max({ v[0].y, v[1].y, v[2].y }))));
+        if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY) {
+            continue;
+        }
+
+        for (int k = 0; k < 3; k++) {
+            const glm::vec3& a = v[k];
+            const glm::vec3& b = v[(k + 1) % 3];
+            triangle.edgeA[k] = a.y - b.y;
+            triangle.edgeB[k] = b.x - a.x;
+            triangle.edgeC[k] = a.x * b.y - a.y * b.x;
+        }
+
+        float dzdx = ((v[1].z - v[0].z) * (v[2].y - v[0].y) - (v[2].z - v[0].z) * (v[1].y - v[0].y)) / area;
+        float dzdy = ((v[2].z - v[0].z) * (v[1].x - v[0].x) - (v[1].z - v[0].z) * (v[2].x - v[0].x)) / area;
+        triangle.depthA = dzdx;
+        triangle.depthB = dzdy;
+        triangle.depthC = v[0].z - dzdx * v[0].x - dzdy * v[0].y;
+
+        m_triangles.push_back(triangle);
+    }
+}
+
+void SoftwareOcclusion::RasterizeBand(int band) {
+    const int y0 = band * kBandHeight;
+    const int y1 = y0 + kBandHeight;
+    float* depth = m_depth.data();
+
+    for (const ScreenTriangle& triangle : m_triangles) {
+        if (triangle.maxY < y0 || triangle.minY >= y1) {
+            continue;
+        }
+
+        int rowBegin = std::max(y0, triangle.minY);
+        int rowEnd = std::min(y1, triangle.maxY + 1);
+        if (m_useSimd) {
+            RasterizeTriangleAvx2(triangle, rowBegin, rowEnd, depth);
+        }
+        else {
+            RasterizeTriangleScalar(triangle, rowBegin, rowEnd, depth);
+        }
+    }
+}
+
+// Both paths evaluate A * x + (B * y + C) in the same order so they cover
+// exactly the same pixels
+
+void SoftwareOcclusion::RasterizeTriangleScalar(const ScreenTriangle& triangle, int y0, int y1, float* depth) const {
+    for (int y = y0; y < y1; y++) {
+        float py = y + 0.5f;
+        float row0 = triangle.edgeB[0] * py + triangle.edgeC[0];
+        float row1 = triangle.edgeB[1] * py + triangle.edgeC[1];
+        float row2 = triangle.edgeB[2] * py + triangle.edgeC[2];
+        float rowDepth = triangle.depthB * py + triangle.depthC;
+        float* row = depth + y * kWidth;
+
+        for (int x = triangle.minX; x <= triangle.maxX; x++) {
+            float px = x + 0.5f;
+            if (triangle.edgeA[0] * px + row0 >= 0.0f && triangle.edgeA[1] * px + row1 >= 0.0f && triangle.edgeA[2] * px + row2 >= 0.0f) {
+                float z = triangle.depthA * px + rowDepth;
+                if (z < row[x]) {
+                    row[x] = z;
+                }
+            }
+        }
+    }
+}
+
+#if defined(HORSE_X86)
+HORSE_TARGET_AVX2
+void SoftwareOcclusion::RasterizeTriangleAvx2(const ScreenTriangle& triangle, int y0, int y1, float* depth) const {
+    // kWidth is a multiple of 8, so aligned groups never leave the row
+    const int xBegin = triangle.minX & ~7;
+    const __m256 laneOffsets = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 a0 = _mm256_set1_ps(triangle.edgeA[0]);
+    const __m256 a1 = _mm256_set1_ps(triangle.edgeA[1]);
+    const __m256 a2 = _mm256_set1_ps(triangle.edgeA[2]);
+    const __m256 depthA = _mm256_set1_ps(triangle.depthA);
+
+    for (int y = y0; y < y1; y++) {
+        float py = y + 0.5f;
+        __m256 row0 = _mm256_set1_ps(triangle.edgeB[0] * py + triangle.edgeC[0]);
+        __m256 row1 = _mm256_set1_ps(triangle.edgeB[1] * py + triangle.edgeC[1]);
+        __m256 row2 = _mm256_set1_ps(triangle.edgeB[2] * py + triangle.edgeC[2]);
+        __m256 rowDepth = _mm256_set1_ps(triangle.depthB * py + triangle.depthC);
+        float* row = depth + y * kWidth;
+
+        for (int x = xBegin; x <= triangle.maxX; x += 8) {
+            __m256 px = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(x)), laneOffsets);
+            __m256 inside = _mm256_and_ps(
+                _mm256_and_ps(
+                    _mm256_cmp_ps(_mm256_add_ps(_mm256_mul_ps(a0, px), row0), zero, _CMP_GE_OQ),
+                    _mm256_cmp_ps(_mm256_add_ps(_mm256_mul_ps(a1, px), row1), zero, _CMP_GE_OQ)),
+                _mm256_cmp_ps(_mm256_add_ps(_mm256_mul_ps(a2, px), row2), zero, _CMP_GE_OQ));
+            if (_mm256_testz_ps(inside, inside)) {
+                continue;
+            }
+
+            __m256 z = _mm256_add_ps(_mm256_mul_ps(depthA, px), rowDepth);
+            __m256 current = _mm256_loadu_ps(row + x);
+            __m256 write = _mm256_and_ps(inside, _mm256_cmp_ps(z, current, _CMP_LT_OQ));
+            _mm256_storeu_ps(row + x, _mm256_blendv_ps(current, z, write));
+        }
+    }
+}
+#else
+void SoftwareOcclusion::RasterizeTriangleAvx2(const ScreenTriangle& triangle, int y0, int y1, float* depth) const {
+    RasterizeTriangleScalar(triangle, y0, y1, depth);
+}
+#endif
+
+void SoftwareOcclusion::Cull(std::vector<DrawItem>& items) {
+    HORSE_PROFILE_FUNCTION();
+
+    if (m_depth.empty()) {
+        return;
+    }
+
+    size_t kept = 0;
+    for (const DrawItem& item : items) {
+        if (!item.mesh->IsOccluder()) {
+            m_stats.tested++;
+            if (IsOccluded(item.model, item.mesh->GetBoundsMin(), item.mesh->GetBoundsMax())) {
+                m_stats.culled++;
+                continue;
+            }
+        }
+        items[kept++] = item;
+    }
+    items.resize(kept);
+}
+
+bool SoftwareOcclusion::IsOccluded(const glm::mat4& model, const glm::vec3& boundsMin, const glm::vec3& boundsMax) const {
+    if (m_depth.empty()) {
+        return false;
+    }
+
+    // Screen rectangle and nearest depth of the box
+    glm::mat4 modelViewProjection = m_viewProjection * model;
+    glm::vec3 ndcMin(1e30f);
+    glm::vec3 ndcMax(-1e30f);
+    for (int i = 0; i < 8; i++) {
+        glm::vec3 corner((i & 1) ? boundsMax.x : boundsMin.x, (i & 2) ? boundsMax.y : boundsMin.y, (i & 4) ? boundsMax.z : boundsMin.z);
+        glm::vec4 clip = modelViewProjection * glm::vec4(corner, 1.0f);
+        if (clip.w <= 0.0f || clip.z < -clip.w) {
+            // Crosses the near plane
+            return false;
+        }
+        glm::vec3 ndc = glm::vec3(clip) / clip.w;
+        ndcMin = glm::min(ndcMin, ndc);
+        ndcMax = glm::max(ndcMax, ndc);
+    }
+
+    if (ndcMax.x < -1.0f || ndcMin.x > 1.0f || ndcMax.y < -1.0f || ndcMin.y > 1.0f || ndcMin.z > 1.0f) {
+        // Outside the view entirely
+        return true;
+    }
+
+    int x0 = std::max(0, static_cast<int>(std::floor((ndcMin.x * 0.5f + 0.5f) * kWidth)));
+    int x1 = std::min(kWidth - 1, static_cast<int>(std::floor((ndcMax.x * 0.5f + 0.5f) * kWidth)));
+    int y0 = std::max(0, static_cast<int>(std::floor((ndcMin.y * 0.5f + 0.5f) * kHeight)));
+    int y1 = std::min(kHeight - 1, static_cast<int>(std::floor((ndcMax.y * 0.5f + 0.5f) * kHeight)));
+
+    return m_useSimd ? IsRectOccludedAvx2(x0, y0, x1, y1, ndcMin.z) : IsRectOccludedScalar(x0, y0, x1, y1, ndcMin.z);
+}
+
+bool SoftwareOcclusion::IsRectOccludedScalar(int x0, int y0, int x1, int y1, float depth) const {
+    for (int y = y0; y <= y1; y++) {
+        const float* row = m_depth.data() + y * kWidth;
+        for (int x = x0; x <= x1; x++) {
+            if (row[x] >= depth) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+#if defined(HORSE_X86)
+HORSE_TARGET_AVX2
+bool SoftwareOcclusion::IsRectOccludedAvx2(int x0, int y0, int x1, int y1, float depth) const {
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i first = _mm256_set1_epi32(x0 - 1);
+    const __m256i last = _mm256_set1_epi32(x1 + 1);
+    const __m256 objectDepth = _mm256_set1_ps(depth);
+
+    for (int y = y0; y <= y1; y++) {
+        const float* row = m_depth.data() + y * kWidth;
+        for (int x = x0 & ~7; x <= x1; x += 8) {
+            __m256i xs = _mm256_add_epi32(_mm256_set1_epi32(x), lanes);
+            __m256i inRect = _mm256_and_si256(_mm256_cmpgt_epi32(xs, first), _mm256_cmpgt_epi32(last, xs));
+            __m256 notHidden = _mm256_cmp_ps(_mm256_loadu_ps(row + x), objectDepth, _CMP_GE_OQ);
+            if (!_mm256_testz_ps(notHidden, _mm256_castsi256_ps(inRect))) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+#else
+bool SoftwareOcclusion::IsRectOccludedAvx2(int x0, int y0, int x1, int y1, float depth) const {
+    return IsRectOccludedScalar(x0, y0, x1, y1, depth);
+}
+#endif
+
+bool SoftwareOcclusion::SelfCheck() {
+    // Camera at z = 5 looking down -z at a 4x4 wall on z = 0, plus a tilted
+    // triangle whose edges and depths fall between pixel centers
+    const std::vector<glm::vec3> positions = {
+        { -2.0f, -2.0f, 0.0f }, { 2.0f, -2.0f, 0.0f }, { 2.0f, 2.0f, 0.0f }, { -2.0f, 2.0f, 0.0f },
+        { -3.1f, -1.7f, -1.3f }, { -0.37f, 2.6f, 0.45f }, { 1.9f, -2.3f, -0.8f },
+    };
+    const std::vector<GLuint> indices = { 0, 1, 2, 0, 2, 3, 4, 5, 6 };
+    const glm::mat4 viewProjection = glm::perspective(glm::radians(60.0f), static_cast<float>(kWidth) / kHeight, 0.1f, 100.0f) *
+        glm::lookAt(glm::vec3(0.0f, 0.0f, 5.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+    SoftwareOcclusion scalar;
+    scalar.m_useSimd = false;
+    SoftwareOcclusion simd;
+    simd.SetUseSimd(true);
+    if (!simd.IsUsingSimd()) {
+        std::cout << "AVX2 not available, checking the scalar path only" << std::endl;
+    }
+
+    for (SoftwareOcclusion* culler : { &scalar, &simd }) {
+        culler->m_viewProjection = viewProjection;
+        culler->m_clip.resize(positions.size());
+        for (size_t i = 0; i < positions.size(); i++) {
+            culler->m_clip[i] = viewProjection * glm::vec4(positions[i], 1.0f);
+        }
+        culler->m_triangles.clear();
+        culler->AddTriangles(indices.data(), indices.size(), 0);
+        culler->Rasterize();
+    }
+
+    bool passed = true;
+    int differing = 0;
+    for (size_t i = 0; i < scalar.m_depth.size(); i++) {
+        if (std::memcmp(&scalar.m_depth[i], &simd.m_depth[i], sizeof(float)) != 0) {
+            differing++;
+        }
+    }
+    if (differing > 0) {
+        std::cerr << "Software occlusion: scalar and AVX2 depth differ in " << differing << " pixels" << std::endl;
+        passed = false;
+    }
+
+    const glm::vec3 boxMin(-0.25f);
+    const glm::vec3 boxMax(0.25f);
+    for (SoftwareOcclusion* culler : { &scalar, &simd }) {
+        const char* path = culler->IsUsingSimd() ? "AVX2" : "scalar";
+
+        // Offsets of about a pixel each, so box edges land inside groups of
+        // 8 pixels as well as on their boundaries
+        for (int i = 0; i < 8; i++) {
+            glm::mat4 behind = glm::translate(glm::mat4(1.0f), glm::vec3(-0.5f + i * 0.05f, 0.0f, -2.0f));
+            if (!culler->IsOccluded(behind, boxMin, boxMax)) {
+                std::cerr << "Software occlusion (" << path << "): box " << i << " behind the wall was not culled" << std::endl;
+                passed = false;
+            }
+
+            // Behind the wall with a sliver showing past its left or right edge
+            glm::mat4 left = glm::translate(glm::mat4(1.0f), glm::vec3(-2.5f - i * 0.02f, 0.0f, -2.0f));
+            glm::mat4 right = glm::translate(glm::mat4(1.0f), glm::vec3(2.5f + i * 0.02f, 0.0f, -2.0f));
+            if (culler->IsOccluded(left, boxMin, boxMax) || culler->IsOccluded(right, boxMin, boxMax)) {
+                std::cerr << "Software occlusion (" << path << "): box " << i << " past the wall's edge was culled" << std::endl;
+                passed = false;
+            }
+        }
+
+        glm::mat4 inFront = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, 1.5f));
+        if (culler->IsOccluded(inFront, boxMin, boxMax)) {
+            std::cerr << "Software occlusion (" << path << "): box in front of the wall was culled" << std::endl;
+            passed = false;
+        }
+    }
+    return passed;
+}
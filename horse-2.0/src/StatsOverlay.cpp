@@ -0,0 +1,416 @@
+#include "StatsOverlay.hpp"
+#include "GpuMemory.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <iomanip>
+#include <sstream>
+
+// 5x7 glyphs for ASCII 32 to 95, one byte per row from the top, bit 4 is
+// the leftmost column. Lowercase letters are drawn as uppercase.
+static const int kFirstGlyph = 32;
+static const int kGlyphCount = 64;
+static const int kSolidGlyph = kGlyphCount;	// filled cell for backgrounds and bars
+static const unsigned char kGlyphs[kGlyphCount][7] = {
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },  // space
+    { 0x04, 0x04, 0x04, 0x04, 0x04, 0x00, 0x04 },  // !
+    { 0x0a, 0x0a, 0x0a, 0x00, 0x00, 0x00, 0x00 },  // "
+    { 0x0a, 0x0a, 0x1f, 0x0a, 0x1f, 0x0a, 0x0a },  // #
+    { 0x04, 0x0f, 0x14, 0x0e, 0x05, 0x1e, 0x04 },  // $
+    { 0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03 },  // %
+    { 0x0c, 0x12, 0x14, 0x08, 0x15, 0x12, 0x0d },  // &
+    { 0x04, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00 },  // '
+    { 0x02, 0x04, 0x08, 0x08, 0x08, 0x04, 0x02 },  // (
+    { 0x08, 0x04, 0x02, 0x02, 0x02, 0x04, 0x08 },  // )
+    { 0x00, 0x04, 0x15, 0x0e, 0x15, 0x04, 0x00 },  // *
+    { 0x00, 0x04, 0x04, 0x1f, 0x04, 0x04, 0x00 },  // +
+    { 0x00, 0x00, 0x00, 0x00, 0x0c, 0x04, 0x08 },  // ,
+    { 0x00, 0x00, 0x00, 0x1f, 0x00, 0x00, 0x00 },  // -
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x0c, 0x0c },  // .
+    { 0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00 },  // /
+    { 0x0e, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0e },  // 0
+    { 0x04, 0x0c, 0x04, 0x04, 0x04, 0x04, 0x0e },  // 1
+    { 0x0e, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1f },  // 2
+    { 0x1f, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0e },  // 3
+    { 0x02, 0x06, 0x0a, 0x12, 0x1f, 0x02, 0x02 },  // 4
+    { 0x1f, 0x10, 0x1e, 0x01, 0x01, 0x11, 0x0e },  // 5
+    { 0x06, 0x08, 0x10, 0x1e, 0x11, 0x11, 0x0e },  // 6
+    { 0x1f, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08 },  // 7
+    { 0x0e, 0x11, 0x11, 0x0e, 0x11, 0x11, 0x0e },  // 8
+    { 0x0e, 0x11, 0x11, 0x0f, 0x01, 0x02, 0x0c },  // 9
+    { 0x00, 0x0c, 0x0c, 0x00, 0x0c, 0x0c, 0x00 },  // :
+    { 0x00, 0x0c, 0x0c, 0x00, 0x0c, 0x04, 0x08 },  // ;
+    { 0x02, 0x04, 0x08, 0x10, 0x08, 0x04, 0x02 },  // <
+    { 0x00, 0x00, 0x1f, 0x00, 0x1f, 0x00, 0x00 },  // =
+    { 0x08, 0x04, 0x02, 0x01, 0x02, 0x04, 0x08 },  // >
+    { 0x0e, 0x11, 0x01, 0x02, 0x04, 0x00, 0x04 },  // ?
+    { 0x0e, 0x11, 0x01, 0x0d, 0x15, 0x15, 0x0e },  // @
+    { 0x0e, 0x11, 0x11, 0x1f, 0x11, 0x11, 0x11 },  // A
+    { 0x1e, 0x11, 0x11, 0x1e, 0x11, 0x11, 0x1e },  // B
+    { 0x0e, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0e },  // C
+    { 0x1c, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1c },  // D
+    { 0x1f, 0x10, 0x10, 0x1e, 0x10, 0x10, 0x1f },  // E
+    { 0x1f, 0x10, 0x10, 0x1e, 0x10, 0x10, 0x10 },  // F
+    { 0x0e, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0f },  // G
+    { 0x11, 0x11, 0x11, 0x1f, 0x11, 0x11, 0x11 },  // H
+    { 0x0e, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0e },  // I
+    { 0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0c },  // J
+    { 0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11 },  // K
+    { 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1f },  // L
+    { 0x11, 0x1b, 0x15, 0x15, 0x11, 0x11, 0x11 },  // M
+    { 0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11 },  // N
+    { 0x0e, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0e },  // O
+    { 0x1e, 0x11, 0x11, 0x1e, 0x10, 0x10, 0x10 },  // P
+    { 0x0e, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0d },  // Q
+    { 0x1e, 0x11, 0x11, 0x1e, 0x14, 0x12, 0x11 },  // R
+    { 0x0f, 0x10, 0x10, 0x0e, 0x01, 0x01, 0x1e },  // S
+    { 0x1f, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04 },  // T
+    { 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0e },  // U
+    { 0x11, 0x11, 0x11, 0x11, 0x11, 0x0a, 0x04 },  // V
+    { 0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0a },  // W
+    { 0x11, 0x11, 0x0a, 0x04, 0x0a, 0x11, 0x11 },  // X
+    { 0x11, 0x11, 0x0a, 0x04, 0x04, 0x04, 0x04 },  // Y
+    { 0x1f, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1f },  // Z
+    { 0x0e, 0x08, 0x08, 0x08, 0x08, 0x08, 0x0e },  // [
+    { 0x00, 0x10, 0x08, 0x04, 0x02, 0x01, 0x00 },  // backslash
+    { 0x0e, 0x02, 0x02, 0x02, 0x02, 0x02, 0x0e },  // ]
+    { 0x04, 0x0a, 0x11, 0x00, 0x00, 0x00, 0x00 },  // ^
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1f },  // _
+};
+
+static int GlyphIndex(char c) {
+    if (c >= 'a' && c <= 'z') {
+        c = static_cast<char>(c - 'a' + 'A');
+    }
+    if (c < kFirstGlyph || c >= kFirstGlyph + kGlyphCount) {
+        return '?' - kFirstGlyph;
+    }
+    return c - kFirstGlyph;
+}
+
+static std::string FormatCount(uint64_t value) {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(1);
+    if (value >= 1000000) {
+        out << value / 1e6 << "M";
+    }
+    else if (value >= 10000) {
+        out << value / 1e3 << "K";
+    }
+    else {
+        out << value;
+    }
+    return out.str();
+}
+
+static std::string FormatBytes(uint64_t bytes) {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(1);
+    if (bytes >= (1 << 20)) {
+        out << bytes / double(1 << 20) << " MiB";
+    }
+    else if (bytes >= (1 << 10)) {
+        out << bytes / double(1 << 10) << " KiB";
+    }
+    else {
+        out << bytes << " B";
+    }
+    return out.str();
+}
+
+StatsOverlay::StatsOverlay() {
+}
+
+void StatsOverlay::Initialize(Shader* shader) {
+    m_shader = shader;
+    CreateFontTexture();
+
+    glGenVertexArrays(1, &m_vertexArray);
+    glBindVertexArray(m_vertexArray);
+    glGenBuffers(1, &m_vertexBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(OverlayVertex), (void*)offsetof(OverlayVertex, x));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(OverlayVertex), (void*)offsetof(OverlayVertex, u));
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(OverlayVertex), (void*)offsetof(OverlayVertex, r));
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void StatsOverlay::CreateFontTexture() {
+    // One row of cells, the solid cell last
+    int width = (kGlyphCount + 1) * kCellWidth;
+    std::vector<unsigned char> pixels(width * kCellHeight, 0);
+    for (int glyph = 0; glyph < kGlyphCount; glyph++) {
+        for (int row = 0; row < 7; row++) {
+            for (int column = 0; column < 5; column++) {
+                if (kGlyphs[glyph][row] & (0x10 >> column)) {
+                    pixels[row * width + glyph * kCellWidth + column] = 255;
+                }
+            }
+        }
+    }
+    for (int row = 0; row < kCellHeight; row++) {
+        for (int column = 0; column < kCellWidth; column++) {
+            pixels[row * width + kSolidGlyph * kCellWidth + column] = 255;
+        }
+    }
+
+    glGenTextures(1, &m_fontTexture);
+    glBindTexture(GL_TEXTURE_2D, m_fontTexture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, width, kCellHeight, 0, GL_RED, GL_UNSIGNED_BYTE, pixels.data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    GpuMemory::Get().TrackTexture(m_fontTexture, GpuMemory::Textures, pixels.size(), "stats overlay");
+}
+
+void StatsOverlay::CleanUp() {
+    if (m_fontTexture != 0) {
+        glDeleteTextures(1, &m_fontTexture);
+        GpuMemory::Get().ReleaseTexture(m_fontTexture);
+        m_fontTexture = 0;
+    }
+    if (m_vertexArray != 0) {
+        glDeleteVertexArrays(1, &m_vertexArray);
+        glDeleteBuffers(1, &m_vertexBuffer);
+        GpuMemory::Get().ReleaseBuffer(m_vertexBuffer);
+        m_vertexArray = 0;
+        m_vertexBuffer = 0;
+        m_bufferCapacity = 0;
+    }
+    m_history.clear();
+    m_next = 0;
+    m_hasLastEndFrame = false;
+}
+
+void StatsOverlay::EndFrame(double cpuMs, double gpuMs) {
+    FrameSample sample;
+    sample.counters = RenderStats::Current();
+    sample.cpuMs = cpuMs;
+    sample.gpuMs = gpuMs;
+
+    auto now = std::chrono::steady_clock::now();
+    if (m_hasLastEndFrame) {
+        sample.frameMs = std::chrono::duration<double, std::milli>(now - m_lastEndFrame).count();
+    }
+    m_lastEndFrame = now;
+    m_hasLastEndFrame = true;
+
+    if (m_history.size() < kHistory) {
+        m_history.push_back(sample);
+    }
+    else {
+        m_history[m_next] = sample;
+    }
+    m_next = (m_next + 1) % kHistory;
+}
+
+const StatsOverlay::FrameSample& StatsOverlay::GetLast() const {
+    static const FrameSample empty;
+    if (m_history.empty()) {
+        return empty;
+    }
+    return m_history[(m_next + kHistory - 1) % kHistory];
+}
+
+StatsOverlay::FrameSample StatsOverlay::GetAverage() const {
+    FrameSample average;
+    if (m_history.empty()) {
+        return average;
+    }
+
+    RenderStats& sum = average.counters;
+    for (const FrameSample& sample : m_history) {
+        const RenderStats& counters = sample.counters;
+        sum.drawCalls += counters.drawCalls;
+        sum.triangles += counters.triangles;
+        sum.bufferUploads += counters.bufferUploads;
+        sum.bufferUploadBytes += counters.bufferUploadBytes;
+        sum.textureUploads += counters.textureUploads;
+        sum.textureUploadBytes += counters.textureUploadBytes;
+        sum.materialBinds += counters.materialBinds;
+        sum.textureBinds += counters.textureBinds;
+        sum.shaderBinds += counters.shaderBinds;
+        sum.uniformUploads += counters.uniformUploads;
+        sum.culledObjects += counters.culledObjects;
+        average.cpuMs += sample.cpuMs;
+        average.gpuMs += sample.gpuMs;
+        average.frameMs += sample.frameMs;
+    }
+
+    uint64_t count = m_history.size();
+    sum.drawCalls /= count;
+    sum.triangles /= count;
+    sum.bufferUploads /= count;
+    sum.bufferUploadBytes /= count;
+    sum.textureUploads /= count;
+    sum.textureUploadBytes /= count;
+    sum.materialBinds /= count;
+    sum.textureBinds /= count;
+    sum.shaderBinds /= count;
+    sum.uniformUploads /= count;
+    sum.culledObjects /= count;
+    average.cpuMs /= count;
+    average.gpuMs /= count;
+    average.frameMs /= count;
+    return average;
+}
+
+double StatsOverlay::GetMaxCpuMs() const {
+    double maxMs = 0.0;
+    for (const FrameSample& sample : m_history) {
+        maxMs = std::max(maxMs, sample.cpuMs);
+    }
+    return maxMs;
+}
+
+std::vector<std::string> StatsOverlay::GetLines() const {
+    // Times are averaged so they can be read, counters are the last frame's
+    FrameSample average = GetAverage();
+    const RenderStats& counters = GetLast().counters;
+    std::vector<std::string> lines;
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(2);
+
+    // From the wall clock, so waiting on vsync and the frame limiter counts
+    if (average.frameMs > 0.0) {
+        out << "Frame " << average.frameMs << " ms  " << std::setprecision(0) << 1000.0 / average.frameMs << " FPS";
+        lines.push_back(out.str());
+        out.str("");
+        out << std::setprecision(2);
+    }
+    out << "CPU " << average.cpuMs << " ms (max " << GetMaxCpuMs() << ")  GPU " << average.gpuMs << " ms";
+    lines.push_back(out.str());
+    out.str("");
+
+    lines.push_back("Draws " + FormatCount(counters.drawCalls) + "  Triangles " + FormatCount(counters.triangles) +
+        "  Culled " + FormatCount(counters.culledObjects));
+    lines.push_back("State changes " + FormatCount(counters.GetStateChanges()) + " (shader " + FormatCount(counters.shaderBinds) +
+        ", material " + FormatCount(counters.materialBinds) + ", texture " + FormatCount(counters.textureBinds) + ")");
+    lines.push_back("Uniforms " + FormatCount(counters.uniformUploads));
+    lines.push_back("Uploads " + FormatCount(counters.bufferUploads) + " buffers " + FormatBytes(counters.bufferUploadBytes) +
+        ", " + FormatCount(counters.textureUploads) + " textures " + FormatBytes(counters.textureUploadBytes));
+
+    // Tracked GPU memory, whole and per category
+    const GpuMemory& memory = GpuMemory::Get();
+    lines.push_back("GPU memory " + FormatBytes(memory.GetTotal()) +
+        (memory.GetBudget() > 0 ? " of " + FormatBytes(memory.GetBudget()) + " budget" : std::string()) +
+        ", peak " + FormatBytes(memory.GetPeak()));
+    for (int i = 0; i < GpuMemory::CategoryCount; i++) {
+        GpuMemory::Category category = static_cast<GpuMemory::Category>(i);
+        lines.push_back("  " + std::string(GpuMemory::GetCategoryName(category)) + " " + FormatBytes(memory.GetBytes(category)) +
+            " (peak " + FormatBytes(memory.GetPeak(category)) + ")");
+    }
+    return lines;
+}
+
+void StatsOverlay::AddQuad(float x, float y, float width, float height, int glyph, const float color[4]) {
+    float textureWidth = static_cast<float>((kGlyphCount + 1) * kCellWidth);
+    float u0 = glyph * kCellWidth / textureWidth;
+    float u1 = (glyph + 1) * kCellWidth / textureWidth;
+
+    OverlayVertex corners[4] = {
+        { x, y, u0, 0.0f, color[0], color[1], color[2], color[3] },
+        { x + width, y, u1, 0.0f, color[0], color[1], color[2], color[3] },
+        { x + width, y + height, u1, 1.0f, color[0], color[1], color[2], color[3] },
+        { x, y + height, u0, 1.0f, color[0], color[1], color[2], color[3] },
+    };
+    const int order[6] = { 0, 1, 2, 0, 2, 3 };
+    for (int index : order) {
+        m_vertices.push_back(corners[index]);
+    }
+}
+
+void StatsOverlay::AddText(float x, float y, const std::string& text, const float color[4]) {
+    for (char c : text) {
+        if (c != ' ') {
+            AddQuad(x, y, kCellWidth * kScale, kCellHeight * kScale, GlyphIndex(c), color);
+        }
+        x += kCellWidth * kScale;
+    }
+}
+
+void StatsOverlay::Draw(int width, int height) {
+    if (!m_visible || !m_shader || m_vertexArray == 0) {
+        return;
+    }
+
+    const float background[4] = { 0.0f, 0.0f, 0.0f, 0.6f };
+    const float textColor[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+    const float targetColor[4] = { 1.0f, 1.0f, 1.0f, 0.4f };
+    const float good[4] = { 0.3f, 0.9f, 0.3f, 0.9f };
+    const float slow[4] = { 0.9f, 0.8f, 0.2f, 0.9f };
+    const float bad[4] = { 0.9f, 0.3f, 0.2f, 0.9f };
+
+    // CPU frame times, full height at 33.3 ms with a line at 16.7 ms
+    const float margin = 8.0f;
+    const float lineHeight = (kCellHeight + 2) * kScale;
+    const float barWidth = 2.0f;
+    const float graphHeight = 60.0f;
+    const double graphMs = 1000.0 / 30.0;
+
+    std::vector<std::string> lines = GetLines();
+    size_t columns = 0;
+    for (const std::string& line : lines) {
+        columns = std::max(columns, line.size());
+    }
+    float panelWidth = std::max(static_cast<float>(columns * kCellWidth * kScale), kHistory * barWidth) + 2.0f * margin;
+    float graphTop = margin + lines.size() * lineHeight + margin;
+    float panelHeight = graphTop + graphHeight + margin;
+
+    m_vertices.clear();
+    AddQuad(0.0f, 0.0f, panelWidth, panelHeight, kSolidGlyph, background);
+    for (size_t i = 0; i < lines.size(); i++) {
+        AddText(margin, margin + i * lineHeight, lines[i], textColor);
+    }
+
+    // Oldest sample on the left
+    size_t count = m_history.size();
+    size_t oldest = count < kHistory ? 0 : m_next;
+    for (size_t i = 0; i < count; i++) {
+        double ms = m_history[(oldest + i) % count].cpuMs;
+        float barHeight = static_cast<float>(std::min(ms / graphMs, 1.0)) * graphHeight;
+        const float* color = ms <= graphMs * 0.5 ? good : ms <= graphMs ? slow : bad;
+        AddQuad(margin + i * barWidth, graphTop + graphHeight - barHeight, barWidth, barHeight, kSolidGlyph, color);
+    }
+    AddQuad(margin, graphTop + graphHeight * 0.5f, kHistory * barWidth, 1.0f, kSolidGlyph, targetColor);
+
+    // The buffer only grows, later frames overwrite it in place
+    size_t bytes = m_vertices.size() * sizeof(OverlayVertex);
+    glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+    if (bytes > m_bufferCapacity) {
+        m_bufferCapacity = bytes * 2;
+        glBufferData(GL_ARRAY_BUFFER, m_bufferCapacity, nullptr, GL_DYNAMIC_DRAW);
+        GpuMemory::Get().TrackBuffer(m_vertexBuffer, GpuMemory::VertexBuffers, m_bufferCapacity, "stats overlay");
+    }
+    glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, m_vertices.data());
+    RenderStats::Current().CountBufferUpload(bytes);
+
+    glViewport(0, 0, width, height);
+    glDisable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    m_shader->useProgram();
+    m_shader->setUniformVec2("u_ScreenSize", glm::vec2(static_cast<float>(width), static_cast<float>(height)));
+    m_shader->setInt("u_Font", 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, m_fontTexture);
+
+    glBindVertexArray(m_vertexArray);
+    glDrawArrays(GL_TRIANGLES, 0, static_cast<GLsizei>(m_vertices.size()));
+    RenderStats::Current().CountDraw(m_vertices.size());
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glDisable(GL_BLEND);
+    glEnable(GL_DEPTH_TEST);
+}
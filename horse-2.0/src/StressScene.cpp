@@ -0,0 +1,196 @@
+#include "StressScene.hpp"
+#include "MeshData.hpp"
+#include <cmath>
+
+StressScene::StressScene() {
+}
+
+void StressScene::Generate(Scene& scene, const StressSceneConfig& config, PortalSystem* portals) {
+    m_state = config.seed != 0 ? config.seed : 1;
+    m_objectCount = 0;
+    m_movers.clear();
+
+    // Distinct texture objects, even when they share a source image
+    for (int i = 0; i < config.textures && !config.texturePaths.empty(); i++) {
+        auto texture = std::make_unique<Texture>();
+        if (texture->LoadTexture(config.texturePaths[i % config.texturePaths.size()])) {
+            m_textures.push_back(std::move(texture));
+        }
+    }
+
+    auto place = [&](Mesh3D* mesh) {
+        glm::vec3 position(Random(-config.extent, config.extent), Random(-1.0f, 3.0f), Random(-config.extent, config.extent));
+        mesh->SetPosition(position);
+        mesh->SetRotation(Random(0.0f, 6.2831853f), glm::vec3(0.0f, 1.0f, 0.0f));
+        mesh->SetColor(RandomColor());
+        m_objectCount++;
+
+        if (Random() < config.movingFraction) {
+            Mover mover = { mesh, position, Random(0.5f, 3.0f), Random(0.2f, 2.0f), Random(0.0f, 6.2831853f) };
+            m_movers.push_back(mover);
+        }
+        else {
+            mesh->SetStatic(true);
+        }
+    };
+
+    const MeshData cube = MeshData::CreateCube(0.5f);
+    for (int i = 0; i < config.cubes; i++) {
+        Mesh3D* mesh = scene.CreateObject("stressCube", cube);
+        if (!m_textures.empty()) {
+            mesh->SetTexture(m_textures[i % m_textures.size()].get());
+        }
+        place(mesh);
+    }
+
+    const MeshData pyramid = MeshData::CreatePyramid(0.5f);
+    for (int i = 0; i < config.pyramids; i++) {
+        Mesh3D* mesh = scene.CreateObject("stressPyramid", pyramid);
+        if (!m_textures.empty()) {
+            mesh->SetTexture(m_textures[i % m_textures.size()].get());
+        }
+        place(mesh);
+    }
+
+    if (config.models > 0 && !config.modelPaths.empty()) {
+        std::vector<ModelRequest> requests;
+        for (int i = 0; i < config.models; i++) {
+            requests.push_back({ "stressModel", config.modelPaths[i % config.modelPaths.size()] });
+        }
+
+        for (Mesh3D* mesh : scene.CreateModels(requests)) {
+            glm::vec3 color = mesh->GetColor();
+            place(mesh);
+            // Keep the material color from the model file
+            mesh->SetColor(color);
+            mesh->SetScale(glm::vec3(0.2f));
+        }
+    }
+
+    const MeshData lightCube = MeshData::CreateCube(0.2f);
+    for (int i = 0; i < config.lights; i++) {
+        Mesh3D* light = scene.CreateObject("stressLight", lightCube);
+        light->SetLightEmitter(true);
+        place(light);
+    }
+
+    // Walls last so layouts without them keep the same random sequence
+    const MeshData wall = MeshData::CreateCube();
+    for (int i = 0; i < config.walls; i++) {
+        Mesh3D* mesh = scene.CreateObject("stressWall", wall);
+        mesh->SetPosition(glm::vec3(Random(-config.extent, config.extent), 1.0f, Random(-config.extent, config.extent)));
+        mesh->SetRotation(Random(0.0f, 6.2831853f), glm::vec3(0.0f, 1.0f, 0.0f));
+        mesh->SetScale(glm::vec3(Random(4.0f, 10.0f), 5.0f, 0.3f));
+        mesh->SetColor(glm::vec3(0.6f));
+        mesh->SetStatic(true);
+        mesh->SetOccluder(true);
+        m_objectCount++;
+    }
+
+    if (config.rooms > 0) {
+        GenerateRooms(scene, config, portals);
+    }
+}
+
+void StressScene::GenerateRooms(Scene& scene, const StressSceneConfig& config, PortalSystem* portals) {
+    const int side = config.rooms;
+    const float roomSize = 2.0f * config.extent / side;
+    const float floorY = -2.0f;
+    const float height = 6.0f;
+    const float thickness = 0.3f;
+    const float doorWidth = 2.0f;
+    const float doorHeight = 4.0f;
+    const float segmentLength = (roomSize - doorWidth) * 0.5f;
+
+    if (portals) {
+        portals->Clear();
+        for (int z = 0; z < side; z++) {
+            for (int x = 0; x < side; x++) {
+                glm::vec3 min(-config.extent + x * roomSize, floorY, -config.extent + z * roomSize);
+                portals->AddCell("room", min, min + glm::vec3(roomSize, height, roomSize));
+            }
+        }
+    }
+
+    const MeshData solid = MeshData::CreateWall(roomSize, thickness, height);
+    const MeshData segment = MeshData::CreateWall(segmentLength, thickness, height);
+    const MeshData lintel = MeshData::CreateWall(doorWidth, thickness, height - doorHeight);
+
+    // Wall pieces are built along x and turned a quarter for walls along z
+    auto addPiece = [&](const MeshData& data, glm::vec3 position, bool alongZ) {
+        Mesh3D* mesh = scene.CreateObject("stressRoomWall", data);
+        mesh->SetPosition(position);
+        if (alongZ) {
+            mesh->SetRotation(1.5707963f, glm::vec3(0.0f, 1.0f, 0.0f));
+        }
+        mesh->SetColor(glm::vec3(0.7f, 0.68f, 0.62f));
+        mesh->SetStatic(true);
+        mesh->SetOccluder(true);
+        m_objectCount++;
+    };
+
+    // Grid line `line` splits rooms line - 1 and line, outer lines are solid
+    for (int axis = 0; axis < 2; axis++) {
+        bool alongZ = axis == 0;
+        for (int line = 0; line <= side; line++) {
+            float across = -config.extent + line * roomSize;
+            for (int cell = 0; cell < side; cell++) {
+                float along = -config.extent + (cell + 0.5f) * roomSize;
+                auto at = [&](float offset, float y) {
+                    return alongZ ? glm::vec3(across, y, along + offset) : glm::vec3(along + offset, y, across);
+                };
+
+                if (line == 0 || line == side) {
+                    addPiece(solid, at(0.0f, floorY), alongZ);
+                    continue;
+                }
+
+                float offset = (doorWidth + segmentLength) * 0.5f;
+                addPiece(segment, at(-offset, floorY), alongZ);
+                addPiece(segment, at(offset, floorY), alongZ);
+                addPiece(lintel, at(0.0f, floorY + doorHeight), alongZ);
+
+                if (portals) {
+                    int before = alongZ ? cell * side + line - 1 : (line - 1) * side + cell;
+                    int after = alongZ ? cell * side + line : line * side + cell;
+                    float half = doorWidth * 0.5f;
+                    portals->AddPortal(before, after, {
+                        at(-half, floorY), at(half, floorY), at(half, floorY + doorHeight), at(-half, floorY + doorHeight),
+                    });
+                }
+            }
+        }
+    }
+}
+
+void StressScene::Update(float time) {
+    for (const auto& mover : m_movers) {
+        float angle = mover.phase + time * mover.speed;
+        mover.mesh->SetPosition(mover.origin + glm::vec3(mover.radius * sin(angle), 0.0f, mover.radius * cos(angle)));
+    }
+}
+
+void StressScene::CleanUp() {
+    for (auto& texture : m_textures) {
+        texture->CleanUp();
+    }
+    m_textures.clear();
+    m_movers.clear();
+    m_objectCount = 0;
+}
+
+float StressScene::Random() {
+    // xorshift32
+    m_state ^= m_state << 13;
+    m_state ^= m_state >> 17;
+    m_state ^= m_state << 5;
+    return (m_state >> 8) * (1.0f / 16777216.0f);
+}
+
+float StressScene::Random(float min, float max) {
+    return min + (max - min) * Random();
+}
+
+glm::vec3 StressScene::RandomColor() {
+    return glm::vec3(Random(0.2f, 1.0f), Random(0.2f, 1.0f), Random(0.2f, 1.0f));
+}
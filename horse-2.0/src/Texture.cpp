@@ -1,4 +1,12 @@
 #include "Texture.hpp"
+#include "GpuMemory.hpp"
+#include "Profiler.hpp"
+#include "RenderStats.hpp"
+#include "TextureArray.hpp"
+#include "TextureStreamer.hpp"
+
+static TextureArrayPool* s_arrayPool = nullptr;
+static TextureStreamer* s_streamer = nullptr;
 
 Texture::Texture() {
 	m_width = 0;
@@ -7,16 +15,85 @@ Texture::Texture() {
 }
 
 bool Texture::LoadTexture(const std::string& filepath) {
+    if (!LoadImageData(filepath)) {
+        return false;
+    }
+    return Upload();
+}
+
+bool Texture::LoadImageData(const std::string& filepath) {
+    HORSE_PROFILE_FUNCTION();
+
     // Load image data
-    unsigned char* data = stbi_load(filepath.c_str(), &m_width, &m_height, &m_channels, 0);
+    m_filepath = filepath;
+    m_pixels = stbi_load(filepath.c_str(), &m_width, &m_height, &m_channels, 0);
+
+    if (!m_pixels) {
+        std::cout << "Failed to load texture" << std::endl;
+        return false;
+    }
+
+    if (m_channels != 1 && m_channels != 3 && m_channels != 4) {
+        std::cerr << "Unsupported image format" << std::endl;
+        stbi_image_free(m_pixels);
+        m_pixels = nullptr;
+        return false;
+    }
+    return true;
+}
+
+void Texture::SetArrayPool(TextureArrayPool* pool) {
+    s_arrayPool = pool;
+}
+
+void Texture::SetStreamer(TextureStreamer* streamer) {
+    s_streamer = streamer;
+}
+
+bool Texture::Upload() {
+    HORSE_PROFILE_FUNCTION();
+
+    if (!m_pixels) {
+        return false;
+    }
+
+    if (s_streamer && s_streamer->Register(this)) {
+        return true;
+    }
+
+    if (s_arrayPool) {
+        m_array = s_arrayPool->Add(m_width, m_height, m_channels, m_pixels, m_layer);
+        if (m_array) {
+            stbi_image_free(m_pixels);
+            m_pixels = nullptr;
+            return true;
+        }
+    }
+
+    UploadPixels(m_width, m_height, m_channels, m_pixels);
+
+    stbi_image_free(m_pixels);
+    m_pixels = nullptr;
+    return 1;
+}
+
+void Texture::UploadPixels(int width, int height, int channels, const unsigned char* pixels, int maxLevel) {
+    m_width = width;
+    m_height = height;
+    m_channels = channels;
 
-    glGenTextures(1, &m_textureID);
+    if (m_textureID == 0) {
+        glGenTextures(1, &m_textureID);
+    }
     glBindTexture(GL_TEXTURE_2D, m_textureID);
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    if (maxLevel >= 0) {
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, maxLevel);
+    }
 
     // Determine color format
     GLenum colorFormat;
@@ -24,30 +101,22 @@ bool Texture::LoadTexture(const std::string& filepath) {
         colorFormat = GL_RED;
     else if (m_channels == 3)
         colorFormat = GL_RGB;
-    else if (m_channels == 4)
+    else
         colorFormat = GL_RGBA;
-    else {
-        std::cerr << "Unsupported image format" << std::endl;
-        stbi_image_free(data);
-        return 0;
-    }
 
-    if (data)
-    {
-        glTexImage2D(GL_TEXTURE_2D, 0, colorFormat, m_width, m_height, 0, colorFormat, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-    }
-    else 
-    {
-        std::cout << "Failed to load texture" << std::endl;
-    }
+    glTexImage2D(GL_TEXTURE_2D, 0, colorFormat, m_width, m_height, 0, colorFormat, GL_UNSIGNED_BYTE, pixels);
+    glGenerateMipmap(GL_TEXTURE_2D);
+    RenderStats::Current().CountTextureUpload(static_cast<uint64_t>(m_width) * m_height * m_channels);
+    GpuMemory::Get().TrackTexture(m_textureID, GpuMemory::Textures,
+        GpuMemory::TextureBytes(m_width, m_height, 1, m_channels, maxLevel >= 0 ? maxLevel + 1 : -1), m_filepath);
 
-    stbi_image_free(data);
     Unbind();
-    return 1;
 }
 
 void Texture::Bind(GLuint textureUnit) {
+    if (m_array) {
+        return;
+    }
     glActiveTexture(GL_TEXTURE0 + textureUnit);
     glBindTexture(GL_TEXTURE_2D, m_textureID);
 }
@@ -57,8 +126,21 @@ void Texture::Unbind() {
 }
 
 void Texture::CleanUp() {
+	if (m_streamer) {
+		m_streamer->Remove(this);
+	}
+	if (m_pixels) {
+		stbi_image_free(m_pixels);
+		m_pixels = nullptr;
+	}
 	if (m_textureID != 0) {
 		glDeleteTextures(1, &m_textureID);
+		GpuMemory::Get().ReleaseTexture(m_textureID);
 		m_textureID = 0;
 	}
+	if (m_array) {
+		m_array->ReleaseLayer(m_layer);
+		m_array = nullptr;
+		m_layer = -1;
+	}
 }
\ No newline at end of file
@@ -0,0 +1,192 @@
+#include "TextureArray.hpp"
+#include "GpuMemory.hpp"
+#include "Profiler.hpp"
+#include "RenderStats.hpp"
+#include <algorithm>
+#include <string>
+
+static void GetFormats(int channels, GLenum& internalFormat, GLenum& format) {
+    if (channels == 1) {
+        internalFormat = GL_R8;
+        format = GL_RED;
+    }
+    else if (channels == 3) {
+        internalFormat = GL_RGB8;
+        format = GL_RGB;
+    }
+    else {
+        internalFormat = GL_RGBA8;
+        format = GL_RGBA;
+    }
+}
+
+TextureArray::TextureArray(int width, int height, int channels, int maxCapacity)
+    : m_width(width), m_height(height), m_channels(channels), m_maxCapacity(maxCapacity) {
+    Allocate(1);
+    m_poolName = "texture array " + std::to_string(m_textureID) + " (" + std::to_string(width) + "x" + std::to_string(height) + ")";
+    ReportUsage();
+}
+
+void TextureArray::Allocate(int capacity) {
+    GLenum internalFormat, format;
+    GetFormats(m_channels, internalFormat, format);
+
+    glGenTextures(1, &m_textureID);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_textureID);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, internalFormat, m_width, m_height, capacity, 0, format, GL_UNSIGNED_BYTE, nullptr);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    m_capacity = capacity;
+    GpuMemory::Get().TrackTexture(m_textureID, GpuMemory::Textures, GpuMemory::TextureBytes(m_width, m_height, capacity, m_channels, -1), "texture arrays");
+}
+
+bool TextureArray::Grow(int capacity) {
+    HORSE_PROFILE_FUNCTION();
+
+    GLuint oldTexture = m_textureID;
+    int oldCapacity = m_capacity;
+    Allocate(capacity);
+
+    // GL 4.1 has no glCopyImageSubData, level 0 of each layer is copied
+    // through a read framebuffer and the mips are generated again
+    GLint previousReadFramebuffer = 0;
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &previousReadFramebuffer);
+    GLuint framebuffer = 0;
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_textureID);
+
+    bool copied = true;
+    for (int layer = 0; layer < m_layerCount && copied; layer++) {
+        glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, oldTexture, 0, layer);
+        copied = glCheckFramebufferStatus(GL_READ_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+        if (copied) {
+            glCopyTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, 0, 0, m_width, m_height);
+        }
+    }
+
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, static_cast<GLuint>(previousReadFramebuffer));
+    glDeleteFramebuffers(1, &framebuffer);
+
+    // Formats that cannot be read back keep their size, later textures go
+    // into another array
+    GLuint dropped = copied ? oldTexture : m_textureID;
+    glDeleteTextures(1, &dropped);
+    GpuMemory::Get().ReleaseTexture(dropped);
+    if (!copied) {
+        m_textureID = oldTexture;
+        m_capacity = oldCapacity;
+        m_maxCapacity = oldCapacity;
+        return false;
+    }
+
+    m_mipsDirty = true;
+    return true;
+}
+
+TextureArray::~TextureArray() {
+    if (m_textureID != 0) {
+        glDeleteTextures(1, &m_textureID);
+        GpuMemory::Get().ReleaseTexture(m_textureID);
+        GpuMemory::Get().RemovePool(m_poolName);
+    }
+}
+
+int TextureArray::AddLayer(const unsigned char* pixels) {
+    HORSE_PROFILE_FUNCTION();
+
+    int layer;
+    if (!m_freeLayers.empty()) {
+        layer = m_freeLayers.back();
+        m_freeLayers.pop_back();
+    }
+    else if (m_layerCount < m_capacity || (m_capacity < m_maxCapacity && Grow(std::min(m_capacity * 2, m_maxCapacity)))) {
+        layer = m_layerCount++;
+    }
+    else {
+        return -1;
+    }
+
+    GLenum internalFormat, format;
+    GetFormats(m_channels, internalFormat, format);
+
+    // Rows of 1 and 3 channel images are not 4 byte aligned in general
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_textureID);
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, m_width, m_height, 1, format, GL_UNSIGNED_BYTE, pixels);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    RenderStats::Current().CountTextureUpload(static_cast<uint64_t>(m_width) * m_height * m_channels);
+
+    // Generated once at the next bind rather than once per added layer
+    m_mipsDirty = true;
+    ReportUsage();
+    return layer;
+}
+
+void TextureArray::ReleaseLayer(int layer) {
+    if (layer >= 0 && layer < m_layerCount) {
+        m_freeLayers.push_back(layer);
+        ReportUsage();
+    }
+}
+
+void TextureArray::ReportUsage() const {
+    // Allocated layers not handed out yet count all the same
+    uint64_t layerBytes = GpuMemory::TextureBytes(m_width, m_height, 1, m_channels, -1);
+    GpuMemory::Get().ReportPool(m_poolName, layerBytes * m_capacity, layerBytes * GetLayerCount());
+}
+
+void TextureArray::Bind(GLuint textureUnit) {
+    glActiveTexture(GL_TEXTURE0 + textureUnit);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_textureID);
+    if (m_mipsDirty) {
+        glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+        m_mipsDirty = false;
+    }
+    glActiveTexture(GL_TEXTURE0);
+}
+
+bool TextureArray::Matches(int width, int height, int channels) const {
+    return m_width == width && m_height == height && m_channels == channels;
+}
+
+TextureArrayPool::TextureArrayPool() {
+}
+
+TextureArray* TextureArrayPool::Add(int width, int height, int channels, const unsigned char* pixels, int& layer) {
+    if (m_maxLayers == 0) {
+        glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &m_maxLayers);
+    }
+
+    for (auto& array : m_arrays) {
+        if (array->Matches(width, height, channels) && !array->IsFull()) {
+            // Fails when the array cannot grow, try the next one
+            layer = array->AddLayer(pixels);
+            if (layer >= 0) {
+                return array.get();
+            }
+        }
+    }
+
+    int capacity = std::min(m_maxLayers, static_cast<int>(kLayersPerArray));
+    if (capacity <= 0) {
+        return nullptr;
+    }
+    m_arrays.push_back(std::make_unique<TextureArray>(width, height, channels, capacity));
+    layer = m_arrays.back()->AddLayer(pixels);
+    if (layer < 0) {
+        m_arrays.pop_back();
+        return nullptr;
+    }
+    return m_arrays.back().get();
+}
+
+void TextureArrayPool::CleanUp() {
+    m_arrays.clear();
+}
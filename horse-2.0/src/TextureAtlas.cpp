@@ -0,0 +1,211 @@
+#include "TextureAtlas.hpp"
+#include "GpuMemory.hpp"
+#include "Profiler.hpp"
+#include <algorithm>
+#include <climits>
+
+static int AlignUp(int value, int alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+TextureAtlas::TextureAtlas() {
+}
+
+bool TextureAtlas::Add(const std::string& filepath, AtlasRegion& region) {
+    HORSE_PROFILE_FUNCTION();
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_regions.find(filepath);
+        if (it != m_regions.end()) {
+            region = it->second;
+            return true;
+        }
+        if (m_rejected.count(filepath)) {
+            return false;
+        }
+    }
+
+    // Decoding runs unlocked, other loader threads keep packing meanwhile
+    int width, height, channels;
+    unsigned char* pixels = stbi_load(filepath.c_str(), &width, &height, &channels, 4);
+    bool fits = pixels && width <= kMaxImageSize && height <= kMaxImageSize;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!fits) {
+        if (pixels) {
+            stbi_image_free(pixels);
+        }
+        m_rejected.insert(filepath);
+        return false;
+    }
+
+    // Another thread may have packed the same file while this one decoded
+    auto it = m_regions.find(filepath);
+    if (it != m_regions.end()) {
+        stbi_image_free(pixels);
+        region = it->second;
+        return true;
+    }
+
+    // Cells are multiples of the gutter, so every image starts on a texel
+    // boundary down to the last mip level
+    int cellWidth = AlignUp(width, kGutter) + 2 * kGutter;
+    int cellHeight = AlignUp(height, kGutter) + 2 * kGutter;
+
+    Page* page = nullptr;
+    int nodeIndex, x, y;
+    for (auto& candidate : m_pages) {
+        if (FindPosition(*candidate, cellWidth, cellHeight, nodeIndex, x, y)) {
+            page = candidate.get();
+            break;
+        }
+    }
+    if (!page) {
+        page = CreatePage();
+        FindPosition(*page, cellWidth, cellHeight, nodeIndex, x, y);
+    }
+
+    PlaceRect(*page, nodeIndex, x, y, cellWidth, cellHeight);
+    CopyWithGutter(*page, x, y, pixels, width, height);
+    stbi_image_free(pixels);
+    m_imageTexels += static_cast<uint64_t>(width) * height;
+
+    region.page = page->texture.get();
+    region.offset = glm::vec2(x + kGutter, y + kGutter) / static_cast<float>(kPageSize);
+    region.scale = glm::vec2(width, height) / static_cast<float>(kPageSize);
+    m_regions[filepath] = region;
+    return true;
+}
+
+TextureAtlas::Page* TextureAtlas::CreatePage() {
+    auto page = std::make_unique<Page>();
+    page->pixels.assign(static_cast<size_t>(kPageSize) * kPageSize * 4, 0);
+    page->skyline.push_back({ 0, 0, kPageSize });
+    page->texture = std::make_unique<Texture>();
+    m_pages.push_back(std::move(page));
+    return m_pages.back().get();
+}
+
+bool TextureAtlas::FindPosition(const Page& page, int width, int height, int& nodeIndex, int& x, int& y) const {
+    // Bottom-left rule: the lowest top edge wins, then the leftmost
+    int bestTop = INT_MAX;
+    int bestX = INT_MAX;
+    for (size_t i = 0; i < page.skyline.size(); i++) {
+        int left = page.skyline[i].x;
+        if (left + width > kPageSize) {
+            break;
+        }
+
+        // Rests on the highest node under its span
+        int top = 0;
+        int remaining = width;
+        for (size_t j = i; remaining > 0; j++) {
+            top = std::max(top, page.skyline[j].y);
+            remaining -= page.skyline[j].width;
+        }
+        if (top + height > kPageSize) {
+            continue;
+        }
+
+        if (top + height < bestTop || (top + height == bestTop && left < bestX)) {
+            bestTop = top + height;
+            bestX = left;
+            nodeIndex = static_cast<int>(i);
+            x = left;
+            y = top;
+        }
+    }
+    return bestTop != INT_MAX;
+}
+
+void TextureAtlas::PlaceRect(Page& page, int nodeIndex, int x, int y, int width, int height) {
+    std::vector<SkylineNode>& skyline = page.skyline;
+    skyline.insert(skyline.begin() + nodeIndex, { x, y + height, width });
+
+    // Trim or drop the nodes now covered by the new one
+    int right = x + width;
+    for (size_t i = nodeIndex + 1; i < skyline.size();) {
+        SkylineNode& node = skyline[i];
+        if (node.x >= right) {
+            break;
+        }
+        int nodeRight = node.x + node.width;
+        if (nodeRight <= right) {
+            skyline.erase(skyline.begin() + i);
+            continue;
+        }
+        node.width = nodeRight - right;
+        node.x = right;
+        break;
+    }
+
+    // Merge neighbours at equal height
+    for (size_t i = 0; i + 1 < skyline.size();) {
+        if (skyline[i].y == skyline[i + 1].y) {
+            skyline[i].width += skyline[i + 1].width;
+            skyline.erase(skyline.begin() + i + 1);
+        }
+        else {
+            i++;
+        }
+    }
+}
+
+void TextureAtlas::CopyWithGutter(Page& page, int x, int y, const unsigned char* pixels, int width, int height) {
+    // The whole cell, reading the image clamped to its edges
+    int cellWidth = AlignUp(width, kGutter) + 2 * kGutter;
+    int cellHeight = AlignUp(height, kGutter) + 2 * kGutter;
+    for (int row = 0; row < cellHeight; row++) {
+        int sourceRow = std::min(std::max(row - kGutter, 0), height - 1);
+        unsigned char* destination = page.pixels.data() + (static_cast<size_t>(y + row) * kPageSize + x) * 4;
+        for (int column = 0; column < cellWidth; column++) {
+            int sourceColumn = std::min(std::max(column - kGutter, 0), width - 1);
+            const unsigned char* source = pixels + (static_cast<size_t>(sourceRow) * width + sourceColumn) * 4;
+            std::copy(source, source + 4, destination + column * 4);
+        }
+    }
+    page.dirty = true;
+}
+
+void TextureAtlas::Upload() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    uint64_t pageBytes = GpuMemory::TextureBytes(kPageSize, kPageSize, 1, 4, kMipLevels);
+    for (auto& page : m_pages) {
+        if (page->dirty) {
+            HORSE_PROFILE_SCOPE("UploadAtlasPage");
+            page->texture->UploadPixels(kPageSize, kPageSize, 4, page->pixels.data(), kMipLevels - 1);
+            GpuMemory::Get().TrackTexture(page->texture->GetID(), GpuMemory::Textures, pageBytes, "texture atlas");
+            page->dirty = false;
+        }
+    }
+
+    // Gutters and space the packer could not fill count as unused
+    if (!m_pages.empty()) {
+        uint64_t capacity = pageBytes * m_pages.size();
+        uint64_t pageTexels = static_cast<uint64_t>(kPageSize) * kPageSize;
+        GpuMemory::Get().ReportPool("texture atlas", capacity, capacity * m_imageTexels / (pageTexels * m_pages.size()));
+    }
+}
+
+void TextureAtlas::CleanUp() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto& page : m_pages) {
+        page->texture->CleanUp();
+    }
+    m_pages.clear();
+    m_regions.clear();
+    m_rejected.clear();
+    m_imageTexels = 0;
+    GpuMemory::Get().RemovePool("texture atlas");
+}
+
+size_t TextureAtlas::GetPageCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_pages.size();
+}
+
+size_t TextureAtlas::GetImageCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_regions.size();
+}
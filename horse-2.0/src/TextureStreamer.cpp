@@ -0,0 +1,362 @@
+#include "TextureStreamer.hpp"
+#include "GpuMemory.hpp"
+#include "Profiler.hpp"
+#include "RenderStats.hpp"
+#include <algorithm>
+#include <cmath>
+
+static GLenum GetColorFormat(int channels) {
+    if (channels == 1)
+        return GL_RED;
+    else if (channels == 3)
+        return GL_RGB;
+    return GL_RGBA;
+}
+
+static int LevelSize(int size, int level) {
+    return std::max(1, size >> level);
+}
+
+TextureStreamer::TextureStreamer() {
+}
+
+uint64_t TextureStreamer::LevelBytes(const Entry& entry, int level) const {
+    return static_cast<uint64_t>(LevelSize(entry.width, level)) * LevelSize(entry.height, level) * entry.channels;
+}
+
+void TextureStreamer::BuildMips(const unsigned char* pixels, int width, int height, int channels, int lastLevel,
+    std::vector<std::vector<unsigned char>>& levels) {
+    // levels[0] stays empty, pixels is level 0
+    levels.assign(lastLevel + 1, std::vector<unsigned char>());
+    const unsigned char* source = pixels;
+    int sourceWidth = width;
+    int sourceHeight = height;
+    for (int level = 1; level <= lastLevel; level++) {
+        int levelWidth = LevelSize(width, level);
+        int levelHeight = LevelSize(height, level);
+        std::vector<unsigned char>& destination = levels[level];
+        destination.resize(static_cast<size_t>(levelWidth) * levelHeight * channels);
+
+        // 2x2 box filter, odd edges reuse their last row or column
+        for (int y = 0; y < levelHeight; y++) {
+            int y0 = std::min(y * 2, sourceHeight - 1);
+            int y1 = std::min(y * 2 + 1, sourceHeight - 1);
+            for (int x = 0; x < levelWidth; x++) {
+                int x0 = std::min(x * 2, sourceWidth - 1);
+                int x1 = std::min(x * 2 + 1, sourceWidth - 1);
+                for (int c = 0; c < channels; c++) {
+                    int sum = source[(y0 * sourceWidth + x0) * channels + c] + source[(y0 * sourceWidth + x1) * channels + c] +
+                        source[(y1 * sourceWidth + x0) * channels + c] + source[(y1 * sourceWidth + x1) * channels + c];
+                    destination[(static_cast<size_t>(y) * levelWidth + x) * channels + c] = static_cast<unsigned char>((sum + 2) / 4);
+                }
+            }
+        }
+
+        source = destination.data();
+        sourceWidth = levelWidth;
+        sourceHeight = levelHeight;
+    }
+}
+
+bool TextureStreamer::Register(Texture* texture) {
+    HORSE_PROFILE_FUNCTION();
+
+    if (!texture->m_pixels || std::max(texture->m_width, texture->m_height) < kMinStreamedSize) {
+        return false;
+    }
+
+    auto entry = std::make_unique<Entry>();
+    entry->texture = texture;
+    entry->filepath = texture->m_filepath;
+    entry->width = texture->m_width;
+    entry->height = texture->m_height;
+    entry->channels = texture->m_channels;
+    entry->levelCount = static_cast<int>(std::floor(std::log2(static_cast<float>(std::max(entry->width, entry->height))))) + 1;
+    entry->tailLevel = 0;
+    while (std::max(LevelSize(entry->width, entry->tailLevel), LevelSize(entry->height, entry->tailLevel)) > kTailSize) {
+        entry->tailLevel++;
+    }
+    entry->residentLevel = entry->levelCount;
+    entry->wantedLevel = entry->tailLevel;
+
+    std::vector<std::vector<unsigned char>> levels;
+    BuildMips(texture->m_pixels, entry->width, entry->height, entry->channels, entry->levelCount - 1, levels);
+
+    glGenTextures(1, &texture->m_textureID);
+    glBindTexture(GL_TEXTURE_2D, texture->m_textureID);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, entry->levelCount - 1);
+    for (int level = entry->levelCount - 1; level >= entry->tailLevel; level--) {
+        UploadLevel(*entry, level, level == 0 ? texture->m_pixels : levels[level].data());
+    }
+    SetBaseLevel(*entry, entry->tailLevel);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    stbi_image_free(texture->m_pixels);
+    texture->m_pixels = nullptr;
+    texture->m_streamer = this;
+
+    m_lookup[texture] = entry.get();
+    m_entries.push_back(std::move(entry));
+    m_stats.textures = static_cast<uint32_t>(m_entries.size());
+    return true;
+}
+
+void TextureStreamer::Remove(Texture* texture) {
+    auto it = m_lookup.find(texture);
+    if (it == m_lookup.end()) {
+        return;
+    }
+
+    Entry* entry = it->second;
+    if (entry->loading) {
+        if (m_jobSystem) {
+            m_jobSystem->Wait(&entry->counter);
+        }
+        for (int level = entry->loadLevel; level < entry->residentLevel; level++) {
+            m_pendingBytes -= LevelBytes(*entry, level);
+        }
+    }
+    for (int level = entry->residentLevel; level < entry->levelCount; level++) {
+        m_stats.residentBytes -= LevelBytes(*entry, level);
+    }
+    texture->m_streamer = nullptr;
+
+    m_lookup.erase(it);
+    m_entries.erase(std::find_if(m_entries.begin(), m_entries.end(), [&](const std::unique_ptr<Entry>& e) { return e.get() == entry; }));
+    m_stats.textures = static_cast<uint32_t>(m_entries.size());
+}
+
+void TextureStreamer::Request(const Texture* texture, float screenFraction) {
+    auto it = m_lookup.find(texture);
+    if (it != m_lookup.end()) {
+        it->second->requestedFraction = std::max(it->second->requestedFraction, screenFraction);
+    }
+}
+
+void TextureStreamer::UploadLevel(Entry& entry, int level, const unsigned char* pixels) {
+    GLenum format = GetColorFormat(entry.channels);
+
+    // Small levels of 1 and 3 channel images have unaligned rows
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, level, format, LevelSize(entry.width, level), LevelSize(entry.height, level), 0, format, GL_UNSIGNED_BYTE, pixels);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    uint64_t bytes = LevelBytes(entry, level);
+    m_stats.residentBytes += bytes;
+    m_stats.uploadedBytes += bytes;
+    RenderStats::Current().CountTextureUpload(bytes);
+}
+
+void TextureStreamer::SetBaseLevel(Entry& entry, int level) {
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+    entry.residentLevel = level;
+
+    uint64_t bytes = 0;
+    for (int i = level; i < entry.levelCount; i++) {
+        bytes += LevelBytes(entry, i);
+    }
+    GpuMemory::Get().TrackTexture(entry.texture->m_textureID, GpuMemory::Textures, bytes, entry.filepath);
+}
+
+bool TextureStreamer::EvictLevel(bool neededToo) {
+    // The least recently used texture gives up its finest level, among
+    // those not needing it unless neededToo
+    Entry* victim = nullptr;
+    for (auto& entry : m_entries) {
+        if (entry->loading || entry->residentLevel >= entry->tailLevel) {
+            continue;
+        }
+        if (!neededToo && entry->residentLevel >= entry->wantedLevel) {
+            continue;
+        }
+        if (!victim || entry->lastUsedFrame < victim->lastUsedFrame ||
+            (entry->lastUsedFrame == victim->lastUsedFrame && entry->residentLevel < victim->residentLevel)) {
+            victim = entry.get();
+        }
+    }
+    if (!victim) {
+        return false;
+    }
+
+    // A zero sized level releases its storage, levels below the base level
+    // are ignored for completeness
+    int level = victim->residentLevel;
+    GLenum format = GetColorFormat(victim->channels);
+    glBindTexture(GL_TEXTURE_2D, victim->texture->m_textureID);
+    glTexImage2D(GL_TEXTURE_2D, level, format, 0, 0, 0, format, GL_UNSIGNED_BYTE, nullptr);
+    SetBaseLevel(*victim, level + 1);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    m_stats.residentBytes -= LevelBytes(*victim, level);
+    m_stats.levelsEvicted++;
+    return true;
+}
+
+void TextureStreamer::StartLoad(Entry& entry, int level) {
+    entry.loading = true;
+    entry.loadLevel = level;
+    for (int i = level; i < entry.residentLevel; i++) {
+        m_pendingBytes += LevelBytes(entry, i);
+    }
+
+    Entry* target = &entry;
+    int residentLevel = entry.residentLevel;
+    auto load = [target, level, residentLevel]() {
+        HORSE_PROFILE_SCOPE("StreamTextureLevels");
+
+        int width, height, channels;
+        unsigned char* pixels = stbi_load(target->filepath.c_str(), &width, &height, &channels, target->channels);
+        if (!pixels || width != target->width || height != target->height) {
+            if (pixels) {
+                stbi_image_free(pixels);
+            }
+            target->loadedLevels.clear();
+            return;
+        }
+
+        BuildMips(pixels, width, height, target->channels, residentLevel - 1, target->loadedLevels);
+        if (level == 0) {
+            target->loadedLevels[0].assign(pixels, pixels + static_cast<size_t>(width) * height * target->channels);
+        }
+        stbi_image_free(pixels);
+    };
+
+    // Decoding takes far longer than a frame, so it goes to the background
+    // threads rather than a deque the render thread drains in Wait().
+    // Remove()/CleanUp() wait on the counter before the entry goes away.
+    if (m_jobSystem && m_jobSystem->IsInitialized()) {
+        m_jobSystem->RunBackground(load, &entry.counter);
+    }
+    else {
+        load();
+    }
+}
+
+void TextureStreamer::Update(int viewportHeight) {
+    HORSE_PROFILE_FUNCTION();
+
+    m_frame++;
+    m_stats.levelsStreamed = 0;
+    m_stats.levelsEvicted = 0;
+    m_stats.uploadedBytes = 0;
+
+    // Finest level each texture needs: one texel per pixel of the mesh's
+    // height on screen, one level finer since faces close to the camera are
+    // magnified beyond the bounding sphere's estimate
+    for (auto& entry : m_entries) {
+        entry->wantedLevel = entry->tailLevel;
+        if (entry->requestedFraction > 0.0f) {
+            float pixels = std::max(entry->requestedFraction * viewportHeight, 1.0f);
+            float texels = static_cast<float>(std::max(entry->width, entry->height));
+            int level = static_cast<int>(std::floor(std::log2(std::max(texels / pixels, 1.0f)))) - 1;
+            entry->wantedLevel = std::max(std::min(level, entry->tailLevel), 0);
+            entry->lastUsedFrame = m_frame;
+        }
+        entry->requestedFraction = 0.0f;
+    }
+
+    // Finished loads, finest levels last so the base level only ever drops
+    // to complete levels
+    uint32_t loadsInFlight = 0;
+    for (auto& entry : m_entries) {
+        if (!entry->loading) {
+            continue;
+        }
+        if (entry->counter.value.load(std::memory_order_acquire) > 0 || m_stats.uploadedBytes >= kMaxUploadBytesPerFrame) {
+            loadsInFlight++;
+            continue;
+        }
+
+        HORSE_PROFILE_SCOPE("UploadStreamedLevels");
+        for (int level = entry->loadLevel; level < entry->residentLevel; level++) {
+            m_pendingBytes -= LevelBytes(*entry, level);
+        }
+        if (entry->loadedLevels.empty()) {
+            std::cout << "Failed to stream texture: " << entry->filepath << std::endl;
+            entry->failed = true;
+        }
+        else {
+            glBindTexture(GL_TEXTURE_2D, entry->texture->m_textureID);
+            for (int level = entry->residentLevel - 1; level >= entry->loadLevel; level--) {
+                UploadLevel(*entry, level, entry->loadedLevels[level].data());
+                m_stats.levelsStreamed++;
+            }
+            SetBaseLevel(*entry, entry->loadLevel);
+            glBindTexture(GL_TEXTURE_2D, 0);
+        }
+        entry->loadedLevels.clear();
+        entry->loading = false;
+    }
+
+    // Over budget: unneeded levels go first, then needed ones by age
+    while (m_stats.residentBytes > m_budget && EvictLevel(false)) {
+    }
+    while (m_stats.residentBytes > m_budget && EvictLevel(true)) {
+    }
+
+    // New loads, most recently used and furthest from their wanted level first
+    std::vector<Entry*> candidates;
+    for (auto& entry : m_entries) {
+        if (!entry->loading && !entry->failed && entry->wantedLevel < entry->residentLevel) {
+            candidates.push_back(entry.get());
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(), [](const Entry* a, const Entry* b) {
+        if (a->lastUsedFrame != b->lastUsedFrame) {
+            return a->lastUsedFrame > b->lastUsedFrame;
+        }
+        return a->residentLevel - a->wantedLevel > b->residentLevel - b->wantedLevel;
+    });
+
+    for (Entry* entry : candidates) {
+        if (loadsInFlight >= kMaxLoadsInFlight) {
+            break;
+        }
+
+        // Make room from unneeded levels, then settle for coarser levels
+        // when the budget still does not fit the wanted ones
+        int level = entry->wantedLevel;
+        uint64_t needed = 0;
+        for (int i = level; i < entry->residentLevel; i++) {
+            needed += LevelBytes(*entry, i);
+        }
+        while (m_stats.residentBytes + m_pendingBytes + needed > m_budget && EvictLevel(false)) {
+        }
+        while (level < entry->residentLevel && m_stats.residentBytes + m_pendingBytes + needed > m_budget) {
+            needed -= LevelBytes(*entry, level);
+            level++;
+        }
+        if (level < entry->residentLevel) {
+            StartLoad(*entry, level);
+            loadsInFlight++;
+        }
+    }
+    m_stats.loadsInFlight = loadsInFlight;
+}
+
+uint64_t TextureStreamer::Trim(uint64_t bytes) {
+    uint64_t before = m_stats.residentBytes;
+    while (before - m_stats.residentBytes < bytes && EvictLevel(false)) {
+    }
+    while (before - m_stats.residentBytes < bytes && EvictLevel(true)) {
+    }
+    m_budget = std::min(m_budget, m_stats.residentBytes);
+    return before - m_stats.residentBytes;
+}
+
+void TextureStreamer::CleanUp() {
+    for (auto& entry : m_entries) {
+        if (entry->loading && m_jobSystem) {
+            m_jobSystem->Wait(&entry->counter);
+        }
+        entry->texture->m_streamer = nullptr;
+    }
+    m_entries.clear();
+    m_lookup.clear();
+    m_pendingBytes = 0;
+    m_stats = Stats();
+}
@@ -4,6 +4,8 @@
 #include <string>
 #include <vector>
 #include <filesystem>
+#include <chrono>
+#include <cstdlib>
 
 // Third Party Libraries
 #include <SDL.h>
@@ -31,22 +33,49 @@ using namespace irrklang;
 #include "MeshData.hpp"
 #include "Scene.hpp"
 #include "Texture.hpp"
+#include "JobSystem.hpp"
+#include "FixedTimestep.hpp"
+#include "FrameLimiter.hpp"
+#include "GpuProfiler.hpp"
+#include "Profiler.hpp"
+#include "RenderStats.hpp"
+#include "CameraPath.hpp"
+#include "Benchmark.hpp"
+#include "StressScene.hpp"
+#include "ClusteredLighting.hpp"
+#include "DeferredRenderer.hpp"
+#include "DynamicResolution.hpp"
+#include "ShadowMaps.hpp"
+#include "OcclusionCuller.hpp"
+#include "SoftwareOcclusion.hpp"
+#include "PortalSystem.hpp"
+#include "TextureArray.hpp"
+#include "TextureAtlas.hpp"
+#include "TextureStreamer.hpp"
+#include "GpuMemory.hpp"
+#include "SceneFile.hpp"
+#include "StatsOverlay.hpp"
 
 // Application Instance
 App app;
+JobSystem jobSystem;
 Shader* graphicsShader;
 Shader* lightingShader;
+Shader* gbufferShader;
+Shader* deferredShader;
+Shader* shadowShader;
+Shader* depthShader;
+Shader* overlayShader;
+Shader* upscaleShader;
 
 Texture* boxTexture = new Texture();
 Texture* kadenTexture = new Texture();
-// Meshes
-Mesh3D object;
-
-// Audio
-ISoundEngine* SoundEngine = createIrrKlangDevice();
+// Audio, not created in headless benchmark runs
+ISoundEngine* SoundEngine = nullptr;
 
 GLuint graphicsPipelineShaderProgram = 0;
 Scene scene(graphicsPipelineShaderProgram);
+SceneFile sceneFile;
 
 glm::vec3 colorTest = glm::vec3(1.0f, 1.0f, 1.0f);
 
@@ -55,22 +84,148 @@ float uOffset = -2.0f;
 float uRotate = 0.0f;
 float uScale = 1.0f;
 
-// Delta time
-float deltaTime = 0.0f;
-float lastFrame = 0.0f;
+// Simulation runs at a fixed rate, rendering interpolates between ticks
+FixedTimestep timestep(120.0);
+
+// Swap interval, frame cap and idle throttling of the main loop, V cycles
+// the VSync mode
+FrameLimiter frameLimiter;
+
+// GPU pass timings, F1 shows them in the title bar, F2 records to CSV
+GpuProfiler gpuProfiler;
+bool showGpuTimings = false;
+
+// F3 starts/stops a CPU trace capture written to trace.json
+const char* traceOutputPath = "./trace.json";
 
 Camera camera;
 
+// Procedural benchmark content, empty unless --stress is given
+StressScene stressScene;
+
+// Every light emitter in the scene is shaded through the cluster grid
+ClusteredLighting clusteredLighting;
+glm::vec3 ambientColor = glm::vec3(0.15f, 0.15f, 0.15f);
+
+// F4 switches between forward and deferred shading
+DeferredRenderer deferredRenderer;
+bool deferredShading = false;
+
+// Cached shadow maps for the first light emitters and the sun, F5 toggles
+ShadowMaps shadowMaps;
+
+// F6 lays down depth first so forward shading runs once per pixel
+bool depthPrepass = false;
+
+// Frustum and hardware occlusion culling of scene objects, F7 toggles
+OcclusionCuller occlusionCuller;
+
+// CPU depth buffer of the occluder meshes, tested before any GPU work, F8
+SoftwareOcclusion softwareOcclusion;
+
+// Cells and portals of indoor levels, F9 toggles
+PortalSystem portalSystem;
+
+// Textures of equal size and format share array textures, so draws with
+// different textures keep one texture bound
+TextureArrayPool textureArrays;
+
+// Small model textures are packed into shared atlas pages on import
+TextureAtlas textureAtlas;
+
+// Large textures start with their small mips and stream finer ones in
+// from disk as objects using them get close, within a memory budget
+TextureStreamer textureStreamer;
+
+// GPU memory per category, F10 shows it in the title bar, F11 prints the
+// full report with the largest assets, the F12 overlay lists it too
+bool showGpuMemory = false;
+
+// Renderer counters and frame times drawn over the scene, F12 toggles
+StatsOverlay statsOverlay;
+
+// The scene renders at a scale that holds the GPU frame time target and is
+// upscaled to the window, R toggles
+DynamicResolution dynamicResolution;
+
+// Where and at what size the scene is drawn this frame
+GLuint GetSceneFramebuffer() {
+    return dynamicResolution.IsEnabled() ? dynamicResolution.GetFramebuffer() : app.getFramebuffer();
+}
+
+int GetSceneWidth() {
+    return dynamicResolution.IsEnabled() ? dynamicResolution.GetRenderWidth() : app.getWidth();
+}
+
+int GetSceneHeight() {
+    return dynamicResolution.IsEnabled() ? dynamicResolution.GetRenderHeight() : app.getHeight();
+}
+
+// Budget for GpuMemory, 0 takes 90% of the dedicated video memory when the
+// driver reports it
+void SetGpuMemoryBudget(uint64_t bytes) {
+    if (bytes == 0) {
+        bytes = GpuMemory::QueryDeviceMemory() / 10 * 9;
+    }
+    GpuMemory::Get().SetBudget(bytes);
+}
+
+std::string GetTitleSummary() {
+    std::string title;
+    if (showGpuTimings) {
+        title = gpuProfiler.GetSummary();
+    }
+    if (showGpuMemory) {
+        title += (title.empty() ? "" : " | ") + GpuMemory::Get().GetSummary();
+    }
+    return title;
+}
+
 void CreateGraphicsPipeline() {
     std::string vertexShaderSource = "./shaders/vert.glsl";
     std::string fragmentShaderSource = "./shaders/frag.glsl";
     std::string lightFragShaderSource = "./shaders/lightFrag.glsl";
     std::string lightVertShaderSource = "./shaders/lightVert.glsl";
+    std::string gbufferFragShaderSource = "./shaders/gbufferFrag.glsl";
+    std::string deferredVertShaderSource = "./shaders/deferredVert.glsl";
+    std::string deferredFragShaderSource = "./shaders/deferredFrag.glsl";
+    std::string shadowVertShaderSource = "./shaders/shadowVert.glsl";
+    std::string shadowFragShaderSource = "./shaders/shadowFrag.glsl";
+    std::string depthVertShaderSource = "./shaders/depthVert.glsl";
+    std::string depthFragShaderSource = "./shaders/depthFrag.glsl";
+    std::string overlayVertShaderSource = "./shaders/overlayVert.glsl";
+    std::string overlayFragShaderSource = "./shaders/overlayFrag.glsl";
+    std::string upscaleFragShaderSource = "./shaders/upscaleFrag.glsl";
 
     graphicsShader = new Shader(vertexShaderSource, fragmentShaderSource);
     lightingShader = new Shader(lightVertShaderSource, lightFragShaderSource);
+    gbufferShader = new Shader(vertexShaderSource, gbufferFragShaderSource);
+    deferredShader = new Shader(deferredVertShaderSource, deferredFragShaderSource);
+    shadowShader = new Shader(shadowVertShaderSource, shadowFragShaderSource);
+    depthShader = new Shader(depthVertShaderSource, depthFragShaderSource);
+    overlayShader = new Shader(overlayVertShaderSource, overlayFragShaderSource);
+    upscaleShader = new Shader(deferredVertShaderSource, upscaleFragShaderSource);
     graphicsShader->useProgram();
     scene.SetShaderProgram(graphicsShader->shaderProgram);
+
+    occlusionCuller.Initialize(depthShader);
+    scene.SetOcclusionCuller(&occlusionCuller);
+
+    statsOverlay.Initialize(overlayShader);
+    dynamicResolution.Initialize(upscaleShader, app.getWidth(), app.getHeight());
+
+    Texture::SetArrayPool(&textureArrays);
+    Mesh3D::SetTextureAtlas(&textureAtlas);
+
+    textureStreamer.SetJobSystem(&jobSystem);
+    Texture::SetStreamer(&textureStreamer);
+    scene.SetTextureStreamer(&textureStreamer);
+
+    // Streamed mip levels are the only memory that can go without a reload
+    SetGpuMemoryBudget(0);
+    GpuMemory::Get().AddPressureCallback("texture streaming", [](uint64_t bytes) {
+        return textureStreamer.Trim(bytes);
+    });
 }
 
 void GetOpenGLVersionInfo() {
@@ -80,19 +235,43 @@ void GetOpenGLVersionInfo() {
     printf("Shading Language: %s\n", glGetString(GL_SHADING_LANGUAGE_VERSION));
 }
 
-void InitializeProgram() {
-    app.Create(640, 480, "myTamagotchi.exe");
-    app.Initialize();
+void InitializeProgram(int width = 640, int height = 480, bool headless = false) {
+    HORSE_PROFILE_THREAD("Main");
 
-    // Enable Resize window
-    SDL_SetWindowResizable(app.getWindow(), SDL_TRUE);
+    jobSystem.Initialize();
+    scene.SetJobSystem(&jobSystem);
 
-    // Initialize the Glad Library
-    if (!gladLoadGLLoader(SDL_GL_GetProcAddress)) {
-        std::cout << "Could not initialize glad.\n" << std::endl;
-        exit(1);
+    app.Create(width, height, "myTamagotchi.exe");
+    if (headless) {
+        app.InitializeHeadless();
     }
+    else {
+        app.Initialize();
 
+        // Enable Resize window
+        SDL_SetWindowResizable(app.getWindow(), SDL_TRUE);
+    }
+
+    // Initialize the Glad Library
+    app.LoadGL();
+
+    GetOpenGLVersionInfo();
+
+    gpuProfiler.Initialize();
+
+    clusteredLighting.Initialize();
+    clusteredLighting.SetJobSystem(&jobSystem);
+
+    deferredRenderer.Initialize(app.getWidth(), app.getHeight());
+    shadowMaps.Initialize();
+
+    softwareOcclusion.SetJobSystem(&jobSystem);
+    scene.SetSoftwareOcclusion(&softwareOcclusion);
+    scene.SetPortalSystem(&portalSystem);
+}
+
+void InitializeAudio() {
+    SoundEngine = createIrrKlangDevice();
     if (!SoundEngine) {
         std::cout << "Failed to create sound engine from irrKlang.\n" << std::endl;
         exit(1);
@@ -104,12 +283,12 @@ void InitializeProgram() {
 
         SoundEngine->setListenerPosition(vec3df(0, 0, 0), vec3df(0, 0, -1));
     }
-
-    GetOpenGLVersionInfo();
 }
 
 // SDL Input Handling
 void Input() {
+    HORSE_PROFILE_FUNCTION();
+
     static int mouseX = app.getWidth() / 2;
     static int mouseY = app.getHeight() / 2;
     
@@ -137,9 +316,84 @@ void Input() {
 
                 app.setWidth(newWidth);
                 app.setHeight(newHeight);
+                dynamicResolution.Resize(newWidth, newHeight);
             
             }
         }
+        else if (e.type == SDL_KEYDOWN && !e.key.repeat) {
+            if (e.key.keysym.scancode == SDL_SCANCODE_F1) {
+                showGpuTimings = !showGpuTimings;
+                if (!showGpuTimings && !showGpuMemory) {
+                    SDL_SetWindowTitle(app.getWindow(), "myTamagotchi.exe");
+                }
+            }
+            else if (e.key.keysym.scancode == SDL_SCANCODE_F2) {
+                if (gpuProfiler.IsWritingCsv()) {
+                    gpuProfiler.CloseCsv();
+                    std::cout << "GPU profile capture stopped" << std::endl;
+                }
+                else if (gpuProfiler.OpenCsv("./gpu_profile.csv")) {
+                    std::cout << "GPU profile capture started: gpu_profile.csv" << std::endl;
+                }
+            }
+            else if (e.key.keysym.scancode == SDL_SCANCODE_F3) {
+                if (Profiler::IsCapturing()) {
+                    Profiler::EndCapture();
+                    if (Profiler::WriteChromeTrace(traceOutputPath)) {
+                        std::cout << "CPU trace written to " << traceOutputPath << std::endl;
+                    }
+                }
+                else {
+                    Profiler::BeginCapture();
+                    std::cout << "CPU trace capture started" << std::endl;
+                }
+            }
+            else if (e.key.keysym.scancode == SDL_SCANCODE_F4) {
+                deferredShading = !deferredShading;
+                std::cout << (deferredShading ? "Deferred" : "Forward") << " shading" << std::endl;
+            }
+            else if (e.key.keysym.scancode == SDL_SCANCODE_F5) {
+                shadowMaps.SetEnabled(!shadowMaps.IsEnabled());
+                std::cout << "Shadows " << (shadowMaps.IsEnabled() ? "on" : "off") << std::endl;
+            }
+            else if (e.key.keysym.scancode == SDL_SCANCODE_F6) {
+                depthPrepass = !depthPrepass;
+                std::cout << "Depth pre-pass " << (depthPrepass ? "on" : "off") << std::endl;
+            }
+            else if (e.key.keysym.scancode == SDL_SCANCODE_F7) {
+                occlusionCuller.SetEnabled(!occlusionCuller.IsEnabled());
+                std::cout << "Occlusion culling " << (occlusionCuller.IsEnabled() ? "on" : "off") << std::endl;
+            }
+            else if (e.key.keysym.scancode == SDL_SCANCODE_F8) {
+                softwareOcclusion.SetEnabled(!softwareOcclusion.IsEnabled());
+                std::cout << "Software occlusion " << (softwareOcclusion.IsEnabled() ? "on" : "off") << std::endl;
+            }
+            else if (e.key.keysym.scancode == SDL_SCANCODE_F9) {
+                portalSystem.SetEnabled(!portalSystem.IsEnabled());
+                std::cout << "Portal culling " << (portalSystem.IsEnabled() ? "on" : "off") << std::endl;
+            }
+            else if (e.key.keysym.scancode == SDL_SCANCODE_F10) {
+                showGpuMemory = !showGpuMemory;
+                if (!showGpuTimings && !showGpuMemory) {
+                    SDL_SetWindowTitle(app.getWindow(), "myTamagotchi.exe");
+                }
+            }
+            else if (e.key.keysym.scancode == SDL_SCANCODE_F11) {
+                GpuMemory::Get().Print(std::cout);
+            }
+            else if (e.key.keysym.scancode == SDL_SCANCODE_F12) {
+                statsOverlay.SetVisible(!statsOverlay.IsVisible());
+            }
+            else if (e.key.keysym.scancode == SDL_SCANCODE_R) {
+                dynamicResolution.SetEnabled(!dynamicResolution.IsEnabled());
+                std::cout << "Dynamic resolution " << (dynamicResolution.IsEnabled() ? "on" : "off") << std::endl;
+            }
+            else if (e.key.keysym.scancode == SDL_SCANCODE_V) {
+                FrameLimiter::VSync next = frameLimiter.GetVSync() == FrameLimiter::VSyncOff ? FrameLimiter::VSyncOn :
+                    (frameLimiter.GetVSync() == FrameLimiter::VSyncOn ? FrameLimiter::VSyncAdaptive : FrameLimiter::VSyncOff);
+                std::cout << "VSync " << FrameLimiter::GetVSyncName(frameLimiter.SetVSync(next)) << std::endl;
+            }
+        }
         else if (e.type == SDL_MOUSEMOTION) {
             mouseX += e.motion.xrel;
             mouseY += e.motion.yrel;
@@ -149,36 +403,41 @@ void Input() {
      
     // Screen Logic
     Uint32 windowFlags = SDL_GetWindowFlags(app.getWindow());
+    frameLimiter.UpdateIdleState(windowFlags);
     if (state[SDL_SCANCODE_F]) {
        SDL_SetWindowFullscreen(app.getWindow(), SDL_WINDOW_FULLSCREEN_DESKTOP);
     }
 
     // Cube test
     if (state[SDL_SCANCODE_1]) {
-        scene.GetObject("testCube")->SetColor(glm::vec3(1.0f, 0.0f, 0.0f));
+        if (Mesh3D* testCube = scene.FindObject("testCube")) {
+            testCube->SetColor(glm::vec3(1.0f, 0.0f, 0.0f));
+        }
     }
 
     if (state[SDL_SCANCODE_2]) {
-        scene.GetObject("testCube")->SetColor(glm::vec3(0.0f, 1.0f, 0.0f));
+        if (Mesh3D* testCube = scene.FindObject("testCube")) {
+            testCube->SetColor(glm::vec3(0.0f, 1.0f, 0.0f));
+        }
     }
         
     if (state[SDL_SCANCODE_3]) {
-        scene.GetObject("testCube")->SetColor(glm::vec3(0.0f, 0.0f, 1.0f));
+        if (Mesh3D* testCube = scene.FindObject("testCube")) {
+            testCube->SetColor(glm::vec3(0.0f, 0.0f, 1.0f));
+        }
     }
 
     /*if (state[SDL_SCANCODE_0]) {
         scene.GetObject("testCube")->SetColor(glm::vec3(.1f * sin(deltaTime), .1f * cos(deltaTime), .1f * sin(deltaTime)));
     }*/
 
-    // Move Logic
     // Speed
-    float multiplier = 1.0; 
     const float base_fov = 60.0f;
     const float max_fov = 100.0f;
     const float fov_tween = 2.0f;
     
     if (state[SDL_SCANCODE_LSHIFT]) {
-        multiplier = 3.0;
+        float multiplier = 3.0;
 
         float fov_delta = (max_fov - base_fov) * (log(multiplier) / fov_tween);
 
@@ -188,7 +447,40 @@ void Input() {
         camera.SetFovy(base_fov);
     }
 
-    float speed = 0.01f * deltaTime * multiplier;
+    if (state[SDL_SCANCODE_ESCAPE]) {
+        if (SDL_GetRelativeMouseMode() == SDL_TRUE) {
+            SDL_SetRelativeMouseMode(SDL_FALSE);
+        }
+        else {
+            SDL_SetRelativeMouseMode(SDL_TRUE);
+        }
+    }
+}
+
+// Scene animation at the given simulation time in seconds
+void AnimateScene(float time) {
+    // Rotating light test
+    Mesh3D* testCube = scene.FindObject("testCube");
+    Mesh3D* lightCube = scene.FindObject("lightCube");
+    // Scene files need not have them
+    if (!testCube || !lightCube) {
+        return;
+    }
+
+    glm::vec3 cubePosition = testCube->GetPosition();
+
+    lightCube->SetPosition(glm::vec3(cubePosition.x + sin(time), cubePosition.y, cubePosition.z + cos(time)));
+}
+
+// Fixed rate simulation tick, dt in seconds
+void Simulate(float dt) {
+    HORSE_PROFILE_FUNCTION();
+
+    const Uint8* state = SDL_GetKeyboardState(NULL);
+
+    // Move Logic
+    float multiplier = state[SDL_SCANCODE_LSHIFT] ? 3.0f : 1.0f;
+    float speed = 10.0f * dt * multiplier;
     if (state[SDL_SCANCODE_W]) {
         camera.MoveForward(speed);
     }
@@ -208,14 +500,7 @@ void Input() {
         camera.MoveUp(speed);
     }
 
-    if (state[SDL_SCANCODE_ESCAPE]) {
-        if (SDL_GetRelativeMouseMode() == SDL_TRUE) {
-            SDL_SetRelativeMouseMode(SDL_FALSE);
-        }
-        else {
-            SDL_SetRelativeMouseMode(SDL_TRUE);
-        }
-    }
+    AnimateScene(static_cast<float>(timestep.GetSimulationTime()));
 }
 
 void InitializeObjects() {
@@ -226,6 +511,8 @@ void InitializeObjects() {
     kadenTexture->LoadTexture("./assets/textures/kaden.jpg");
     boxTexture->LoadTexture("./assets/textures/container.jpg");
     testCube->SetTexture(boxTexture);
+    testCube->SetStatic(true);
+    testCube->SetOccluder(true);
 
     // Light cube
     Mesh3D* lightCube = scene.CreateObject("lightCube", MeshData::CreateCube(0.2f));
@@ -242,46 +529,141 @@ void InitializeObjects() {
 
 void InitializeModels() {
     // Models PLEASE PLEASEPLEASE PLESE
-    Mesh3D* modelCat = scene.CreateModel("kitten", "./assets/models/tamagotchi/Kitten/Kitten_01.obj");
+    std::vector<Mesh3D*> models = scene.CreateModels({
+        { "kitten", "./assets/models/tamagotchi/Kitten/Kitten_01.obj" },
+        { "frog", "./assets/models/tamagotchi/Frog/Frog_01.obj" },
+        { "mushroom", "./assets/models/tamagotchi/Mushroom/Mushroom.fbx" },
+    });
+
+    Mesh3D* modelCat = models[0];
     modelCat->SetPosition(glm::vec3(0.0f, 0.0f, -2.0f));
     modelCat->SetRotation(-90, glm::vec3(0.0f, 1.0f, 0.0f));
     modelCat->SetScale(glm::vec3(0.3f, 0.3f, 0.3f));
 
-    Mesh3D* modelFrog = scene.CreateModel("frog", "./assets/models/tamagotchi/Frog/Frog_01.obj");
+    Mesh3D* modelFrog = models[1];
     modelFrog->SetScale(glm::vec3(0.2f, 0.2f, 0.2f));
     modelFrog->SetPosition(glm::vec3(10.0f, 0.0f, -2.0f));
     modelFrog->SetRotation(-90, glm::vec3(0.0f, 1.0f, 0.0f));
 
-    Mesh3D* mushroom = scene.CreateModel("mushroom", "./assets/models/tamagotchi/Mushroom/Mushroom.fbx");
+    Mesh3D* mushroom = models[2];
     mushroom->SetScale(glm::vec3(1.0f, 1.0f, 1.0f));
     mushroom->SetPosition(glm::vec3(-10.0f, 0.0f, -2.0f));
     mushroom->SetRotation(-90, glm::vec3(1.0f, 1.0f, 0.0f));
+
+    for (Mesh3D* model : models) {
+        model->SetStatic(true);
+    }
+}
+
+// Replaces InitializeObjects and InitializeModels with a scene file, text or
+// compiled
+bool LoadSceneFile(const std::string& path) {
+    auto start = std::chrono::steady_clock::now();
+    if (!sceneFile.Load(path)) {
+        return false;
+    }
+    auto loaded = std::chrono::steady_clock::now();
+    sceneFile.Instantiate(scene, &jobSystem);
+    auto instantiated = std::chrono::steady_clock::now();
+
+    std::cout << "Scene " << path << ": " << sceneFile.GetObjectCount() << " objects, "
+        << sceneFile.GetAssetCount() << " assets, loaded in "
+        << std::chrono::duration<double, std::milli>(loaded - start).count() << " ms, instantiated in "
+        << std::chrono::duration<double, std::milli>(instantiated - loaded).count() << " ms" << std::endl;
+    return true;
 }
 
 void PrepareDraw() {
-    scene.PrepareDraw(app.getWidth(), app.getHeight());
+    HORSE_PROFILE_FUNCTION();
+
+    float alpha = scene.GetInterpolation();
+    glm::mat4 view = camera.GetInterpolatedViewMatrix(alpha);
+
+    // Mip levels for what the last frame drew
+    textureStreamer.Update(GetSceneHeight());
+    GpuMemory::Get().CheckBudget();
+
+    // This frame's lights, in the order both the cluster grid and the
+    // shadow maps index them
+    std::vector<PointLight> lights;
+    for (Mesh3D* emitter : scene.GetLightEmitters()) {
+        PointLight light;
+        light.position = emitter->GetInterpolatedPosition(alpha);
+        light.radius = emitter->GetLightRadius();
+        light.color = emitter->GetColor();
+        light.intensity = emitter->GetLightIntensity();
+        lights.push_back(light);
+    }
 
-    glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT);
+    {
+        GpuScope scope(gpuProfiler, "ShadowMaps");
+        shadowMaps.Update(scene, lights, shadowShader, view, camera.GetProjectionMatrix(), camera.GetNear(), camera.GetFar());
+    }
 
-    Mesh3D* lightCube = scene.GetObject("lightCube");
-    Mesh3D* testCube = scene.GetObject("testCube");
+    // Passes may leave their own targets bound, always start on the scene target
+    glBindFramebuffer(GL_FRAMEBUFFER, GetSceneFramebuffer());
+    scene.PrepareDraw(GetSceneWidth(), GetSceneHeight());
 
-    glm::vec3 lightPos = lightCube->GetPosition();
-    graphicsShader->setUniformVec3("u_lightPos", lightPos);
+    glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
 
-    // Set light color
-    glm::vec3 lightColor = lightCube->GetColor();
-    graphicsShader->setUniformVec3("u_lightColor", lightColor);
+    clusteredLighting.Update(lights, view, camera.GetProjectionMatrix(), camera.GetNear(), camera.GetFar());
+    clusteredLighting.Bind(graphicsShader, GetSceneWidth(), GetSceneHeight());
+    shadowMaps.Bind(graphicsShader);
+    graphicsShader->setUniformVec3("u_ambientColor", ambientColor);
 
     // Set view position (camera position)
-    graphicsShader->setUniformVec3("u_viewPos", camera.GetEye());
+    graphicsShader->setUniformVec3("u_viewPos", camera.GetInterpolatedEye(alpha));
 }
 
 void Draw() {
-    scene.DrawObjects(camera.GetViewMatrix(), camera.GetProjectionMatrix(), graphicsShader);
-    scene.DrawLightSources(camera.GetViewMatrix(), camera.GetProjectionMatrix(), lightingShader);
-    scene.UpdateAll();
+    HORSE_PROFILE_FUNCTION();
+
+    glm::mat4 view = camera.GetInterpolatedViewMatrix(scene.GetInterpolation());
+    if (deferredShading) {
+        {
+            GpuScope scope(gpuProfiler, "GeometryPass");
+            deferredRenderer.BeginGeometryPass(GetSceneWidth(), GetSceneHeight());
+            scene.DrawObjects(view, camera.GetProjectionMatrix(), gbufferShader);
+        }
+        {
+            GpuScope scope(gpuProfiler, "DeferredLighting");
+            deferredShader->useProgram();
+            shadowMaps.Bind(deferredShader);
+            deferredRenderer.Shade(deferredShader, GetSceneFramebuffer(), view, camera.GetProjectionMatrix(),
+                camera.GetInterpolatedEye(scene.GetInterpolation()), ambientColor, clusteredLighting);
+        }
+    }
+    else {
+        if (depthPrepass) {
+            GpuScope scope(gpuProfiler, "DepthPrepass");
+            glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+            scene.DrawDepth(view, camera.GetProjectionMatrix(), depthShader);
+            glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+            // Only the front-most fragment survives, depth is already final
+            glDepthFunc(GL_EQUAL);
+            glDepthMask(GL_FALSE);
+        }
+        {
+            GpuScope scope(gpuProfiler, "DrawObjects");
+            scene.DrawObjects(view, camera.GetProjectionMatrix(), graphicsShader);
+        }
+        glDepthFunc(GL_LESS);
+        glDepthMask(GL_TRUE);
+    }
+    {
+        GpuScope scope(gpuProfiler, "DrawLightSources");
+        scene.DrawLightSources(view, camera.GetProjectionMatrix(), lightingShader);
+    }
+    {
+        GpuScope scope(gpuProfiler, "UpdateAll");
+        scene.UpdateAll();
+    }
+    if (dynamicResolution.IsEnabled()) {
+        GpuScope scope(gpuProfiler, "Upscale");
+        dynamicResolution.Resolve(app.getFramebuffer());
+    }
 }
 
 void MainLoop() {
@@ -291,64 +673,419 @@ void MainLoop() {
     // Set mouse to move relatively within application
     SDL_SetRelativeMouseMode(SDL_TRUE);
 
+    uint64_t frameCount = 0;
+    timestep.Reset();
     while (app.isActive()) {
-        // Create delta time
-        float currentFrame = 1.0f * SDL_GetTicks();
-        deltaTime = currentFrame - lastFrame;
-        lastFrame = currentFrame;
+        HORSE_PROFILE_SCOPE("Frame");
+        auto frameStart = std::chrono::steady_clock::now();
+        RenderStats::Reset();
+
+        Input();
+
+        if (frameLimiter.GetIdleState() == FrameLimiter::Hidden) {
+            // Nothing on screen to draw, sleep until an event brings the
+            // window back instead of simulating frames nobody sees
+            SDL_WaitEvent(nullptr);
+            timestep.Reset();
+            continue;
+        }
+
+        // Run as many fixed ticks as real time has accumulated
+        int ticks = timestep.Advance();
+        for (int i = 0; i < ticks; i++) {
+            scene.StorePreviousTransforms();
+            camera.StorePreviousState();
+            timestep.Tick();
+            Simulate(static_cast<float>(timestep.GetTickDuration()));
+        }
+        scene.SetInterpolation(timestep.GetAlpha());
 
         // Projection Matrix
         camera.SetProjectionMatrix(glm::radians(60.0f), (float)app.getWidth() / (float)app.getHeight(), 0.1f, 50.0f);
 
         // Set listener position
-        vec3df cameraPos = vec3df(camera.GetEye().x, camera.GetEye().y, camera.GetEye().z);
-        vec3df cameraLook = vec3df(camera.GetLookDir().x, camera.GetEye().y, camera.GetEye().z);
+        glm::vec3 eye = camera.GetInterpolatedEye(timestep.GetAlpha());
+        vec3df cameraPos = vec3df(eye.x, eye.y, eye.z);
+        vec3df cameraLook = vec3df(camera.GetLookDir().x, eye.y, eye.z);
 
         SoundEngine->setListenerPosition(cameraPos, cameraLook);
 
-        // Rotating light test
-        Mesh3D* testCube = scene.GetObject("testCube");
-        Mesh3D* lightCube = scene.GetObject("lightCube");
+        gpuProfiler.BeginFrame();
 
-        glm::vec3 cubePosition = testCube->GetPosition();
+        {
+            GpuScope scope(gpuProfiler, "PrepareDraw");
+            PrepareDraw();
+        }
 
-        lightCube->SetPosition(glm::vec3(cubePosition.x + sin(currentFrame/1000), cubePosition.y, cubePosition.z + cos(currentFrame/1000)));
+        Draw();
 
-        Input();
+        gpuProfiler.EndFrame();
+        dynamicResolution.Update(gpuProfiler.GetFrameMs());
 
-        PrepareDraw();
+        // CPU time up to here, presenting is left out as it waits on vsync
+        double cpuMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+        statsOverlay.EndFrame(cpuMs, gpuProfiler.GetFrameMs());
+        if (statsOverlay.IsVisible()) {
+            glBindFramebuffer(GL_FRAMEBUFFER, app.getFramebuffer());
+            statsOverlay.Draw(app.getWidth(), app.getHeight());
+        }
 
-        Draw();
+        if ((showGpuTimings || showGpuMemory) && frameCount % 30 == 0) {
+            SDL_SetWindowTitle(app.getWindow(), GetTitleSummary().c_str());
+        }
+        frameCount++;
 
         // Update the screen
-        SDL_GL_SwapWindow(app.getWindow());
+        {
+            HORSE_PROFILE_SCOPE("SwapWindow");
+            app.SwapBuffers();
+        }
+        frameLimiter.Wait();
     }
 }
 
 void CleanUp() {
+    gpuProfiler.CleanUp();
+    statsOverlay.CleanUp();
+    dynamicResolution.CleanUp();
+    clusteredLighting.CleanUp();
+    deferredRenderer.CleanUp();
+    shadowMaps.CleanUp();
+    stressScene.CleanUp();
+
     // Clean up objects
     scene.CleanUpAll();
+    sceneFile.CleanUp();
+    occlusionCuller.CleanUp();
+    Texture::SetArrayPool(nullptr);
+    textureArrays.CleanUp();
+    Mesh3D::SetTextureAtlas(nullptr);
+    textureAtlas.CleanUp();
+    Texture::SetStreamer(nullptr);
+    GpuMemory::Get().ClearPressureCallbacks();
+    textureStreamer.CleanUp();
 
     // Delete pipeline
     glDeleteProgram(graphicsPipelineShaderProgram);
 
     // Remove sound engine
-    SoundEngine->drop();
+    if (SoundEngine) {
+        SoundEngine->drop();
+        SoundEngine = nullptr;
+    }
 
     // Terminate App
     app.Terminate();
+
+    jobSystem.Shutdown();
+}
+
+// Microbenchmark of the job scheduler, no window or GL context needed
+void BenchmarkJobSystem() {
+    jobSystem.Initialize();
+    std::cout << "Job system: " << jobSystem.GetWorkerCount() << " workers" << std::endl;
+
+    const uint32_t jobCounts[] = { 1000, 10000, 100000, 1000000 };
+    for (uint32_t count : jobCounts) {
+        double ns = jobSystem.MeasureSchedulingOverhead(count);
+        std::cout << "  " << count << " empty jobs: " << ns << " ns/job" << std::endl;
+    }
+
+    jobSystem.Shutdown();
+}
+
+// Renders a scripted camera flight through the scene for a fixed number of
+// frames and prints frame time statistics and renderer counters
+void RunBenchmark(const BenchmarkOptions& options) {
+    CameraPath path;
+    if (!options.cameraPath.empty()) {
+        if (!path.Load(options.cameraPath)) {
+            exit(1);
+        }
+    }
+    else {
+        path = CameraPath::CreateOrbit(glm::vec3(0.0f, 0.0f, -2.0f), 8.0f, 2.0f, 10.0f);
+    }
+
+    camera.SetProjectionMatrix(glm::radians(60.0f), (float)app.getWidth() / (float)app.getHeight(), 0.1f, 50.0f);
+    scene.SetInterpolation(1.0f);
+
+    FrameStatistics frameTimes;
+    RenderStats totals;
+    uint64_t staticShadowViews = 0;
+    uint64_t dynamicShadowViews = 0;
+    OcclusionCuller::Stats cullTotals;
+    uint64_t softwareTested = 0;
+    uint64_t softwareCulled = 0;
+    uint64_t portalCells = 0;
+    uint64_t portalGathered = 0;
+    uint64_t streamedLevels = 0;
+    uint64_t evictedLevels = 0;
+    double resolutionScale = 0.0;
+    const int totalFrames = options.warmupFrames + options.frames;
+
+    for (int frame = 0; frame < totalFrames; frame++) {
+        HORSE_PROFILE_SCOPE("Frame");
+
+        // Scripted time, independent of how fast frames render
+        float time = frame / options.frameRate;
+        glm::vec3 eye, target;
+        path.Sample(time, eye, target);
+        camera.SetPose(eye, target);
+        AnimateScene(time);
+        stressScene.Update(time);
+
+        auto start = std::chrono::steady_clock::now();
+        RenderStats::Reset();
+
+        gpuProfiler.BeginFrame();
+        PrepareDraw();
+        Draw();
+        gpuProfiler.EndFrame();
+        dynamicResolution.Update(gpuProfiler.GetFrameMs());
+        app.SwapBuffers();
+
+        auto end = std::chrono::steady_clock::now();
+        if (frame < options.warmupFrames) {
+            continue;
+        }
+
+        frameTimes.Add(std::chrono::duration<double, std::milli>(end - start).count());
+
+        const RenderStats& stats = RenderStats::Current();
+        totals.drawCalls += stats.drawCalls;
+        totals.triangles += stats.triangles;
+        totals.bufferUploads += stats.bufferUploads;
+        totals.bufferUploadBytes += stats.bufferUploadBytes;
+        totals.textureUploads += stats.textureUploads;
+        totals.textureUploadBytes += stats.textureUploadBytes;
+        totals.materialBinds += stats.materialBinds;
+        totals.textureBinds += stats.textureBinds;
+        totals.shaderBinds += stats.shaderBinds;
+        totals.uniformUploads += stats.uniformUploads;
+        totals.culledObjects += stats.culledObjects;
+        staticShadowViews += shadowMaps.GetStaticViewsRendered();
+        dynamicShadowViews += shadowMaps.GetDynamicViewsRendered();
+
+        const OcclusionCuller::Stats& cull = occlusionCuller.GetStats();
+        cullTotals.frustumCulled += cull.frustumCulled;
+        cullTotals.visibleDrawn += cull.visibleDrawn;
+        cullTotals.conditionalDrawn += cull.conditionalDrawn;
+        cullTotals.boxQueries += cull.boxQueries;
+        cullTotals.geometryQueries += cull.geometryQueries;
+        cullTotals.occluded += cull.occluded;
+        softwareTested += softwareOcclusion.GetStats().tested;
+        softwareCulled += softwareOcclusion.GetStats().culled;
+        portalCells += portalSystem.GetStats().visibleCells;
+        portalGathered += portalSystem.GetStats().gathered;
+        streamedLevels += textureStreamer.GetStats().levelsStreamed;
+        evictedLevels += textureStreamer.GetStats().levelsEvicted;
+        resolutionScale += dynamicResolution.IsEnabled() ? dynamicResolution.GetScale() : 1.0;
+    }
+
+    std::cout << std::endl << "Benchmark " << app.getWidth() << "x" << app.getHeight()
+        << (app.isHeadless() ? " offscreen" : " windowed")
+        << (deferredShading ? ", deferred" : (depthPrepass ? ", forward with depth pre-pass" : ", forward")) << std::endl;
+    frameTimes.Print(std::cout, "Frame time");
+    if (dynamicResolution.IsEnabled()) {
+        std::cout << "Dynamic resolution: " << dynamicResolution.GetSettings().targetMs << " ms target, average scale "
+            << resolutionScale / options.frames << ", final " << dynamicResolution.GetRenderWidth() << "x"
+            << dynamicResolution.GetRenderHeight() << std::endl;
+    }
+
+    double frames = static_cast<double>(options.frames);
+    std::cout << "Per frame: "
+        << totals.drawCalls / frames << " draws, "
+        << totals.triangles / frames << " triangles, "
+        << totals.bufferUploads / frames << " buffer uploads ("
+        << totals.bufferUploadBytes / frames / 1024.0 << " KiB), "
+        << totals.textureUploads / frames << " texture uploads ("
+        << totals.textureUploadBytes / frames / 1024.0 << " KiB), "
+        << totals.materialBinds / frames << " material binds, "
+        << totals.textureBinds / frames << " texture binds, "
+        << totals.shaderBinds / frames << " shader binds, "
+        << totals.uniformUploads / frames << " uniform uploads, "
+        << totals.culledObjects / frames << " objects culled" << std::endl;
+    if (textureArrays.GetArrayCount() > 0) {
+        std::cout << "Texture arrays: " << textureArrays.GetArrayCount() << std::endl;
+    }
+    if (textureStreamer.GetStats().textures > 0) {
+        std::cout << "Texture streaming: " << textureStreamer.GetStats().textures << " textures, "
+            << textureStreamer.GetStats().residentBytes / (1024.0 * 1024.0) << " of "
+            << textureStreamer.GetBudget() / (1024.0 * 1024.0) << " MiB resident, "
+            << streamedLevels / frames << " levels streamed, " << evictedLevels / frames << " evicted per frame" << std::endl;
+    }
+    if (textureAtlas.GetPageCount() > 0) {
+        std::cout << "Texture atlas: " << textureAtlas.GetImageCount() << " images on "
+            << textureAtlas.GetPageCount() << " pages" << std::endl;
+    }
+    GpuMemory::Get().Print(std::cout);
+    if (shadowMaps.IsEnabled()) {
+        std::cout << "Shadow views per frame: " << staticShadowViews / frames << " static, "
+            << dynamicShadowViews / frames << " dynamic" << std::endl;
+    }
+    if (occlusionCuller.IsEnabled()) {
+        std::cout << "Culling per frame: " << cullTotals.frustumCulled / frames << " outside frustum, "
+            << cullTotals.occluded / frames << " occluded, "
+            << cullTotals.visibleDrawn / frames << " drawn, "
+            << cullTotals.conditionalDrawn / frames << " conditional, "
+            << (cullTotals.boxQueries + cullTotals.geometryQueries) / frames << " queries"
+            << (occlusionCuller.UsesConservativeQueries() ? " (conservative)" : "") << std::endl;
+    }
+    if (softwareOcclusion.IsEnabled()) {
+        std::cout << "Software occlusion per frame: " << softwareCulled / frames << " of "
+            << softwareTested / frames << " culled" << (softwareOcclusion.IsUsingSimd() ? " (AVX2)" : " (scalar)") << std::endl;
+    }
+    if (portalSystem.IsEnabled()) {
+        std::cout << "Portals per frame: " << portalCells / frames << " of " << portalSystem.GetCellCount() << " cells visible, "
+            << portalGathered / frames << " objects gathered" << std::endl;
+    }
+
+    for (const auto& pass : gpuProfiler.GetStats()) {
+        std::cout << "GPU " << pass.name << ": avg " << pass.averageMs << " ms, min " << pass.minMs << " ms, max " << pass.maxMs << " ms" << std::endl;
+    }
+    if (gpuProfiler.GetDroppedFrames() > 0) {
+        std::cout << "GPU timings dropped for " << gpuProfiler.GetDroppedFrames() << " frames" << std::endl;
+    }
+
+    // objects,moving,lights,mean,p50,p95,p99 for charting against object count
+    if (options.csv) {
+        std::cout << "RESULT," << stressScene.GetObjectCount() << "," << stressScene.GetMovingCount() << ","
+            << (options.stress ? options.stressConfig.lights : 0) << ","
+            << frameTimes.GetMean() << "," << frameTimes.GetPercentile(50.0) << ","
+            << frameTimes.GetPercentile(95.0) << "," << frameTimes.GetPercentile(99.0) << std::endl;
+    }
 }
 
 #undef main // bug fix: potential overlap of main declaration in SDL??
-int main()
+int main(int argc, char* argv[])
 {
+    if (argc > 1 && std::string(argv[1]) == "--bench-jobs") {
+        BenchmarkJobSystem();
+        return 0;
+    }
+
+    // CPU occlusion culling checked against a fixed scene, no window needed
+    if (argc > 1 && std::string(argv[1]) == "--check-occlusion") {
+        bool passed = SoftwareOcclusion::SelfCheck();
+        std::cout << "Software occlusion check " << (passed ? "passed" : "failed") << std::endl;
+        return passed ? 0 : 1;
+    }
+
+    // Text scene description to binary, no window needed
+    if (argc > 3 && std::string(argv[1]) == "--compile-scene") {
+        return SceneFile::Compile(argv[2], argv[3]) ? 0 : 1;
+    }
+
+    BenchmarkOptions benchmarkOptions;
+    if (BenchmarkOptions::Parse(argc, argv, benchmarkOptions)) {
+        InitializeProgram(benchmarkOptions.width, benchmarkOptions.height, benchmarkOptions.headless);
+        if (!benchmarkOptions.headless) {
+            // Measure rendering, not the display's refresh rate
+            frameLimiter.SetVSync(FrameLimiter::VSyncOff);
+        }
+        deferredShading = benchmarkOptions.deferred;
+        shadowMaps.SetEnabled(benchmarkOptions.shadows);
+        depthPrepass = benchmarkOptions.depthPrepass;
+        CreateGraphicsPipeline();
+        occlusionCuller.SetEnabled(benchmarkOptions.occlusion);
+        softwareOcclusion.SetEnabled(benchmarkOptions.softwareOcclusion);
+        softwareOcclusion.SetUseSimd(benchmarkOptions.simd);
+        portalSystem.SetEnabled(benchmarkOptions.portals);
+        if (benchmarkOptions.dynamicResolutionMs > 0.0) {
+            DynamicResolution::Settings settings;
+            settings.targetMs = benchmarkOptions.dynamicResolutionMs;
+            settings.upscale = benchmarkOptions.sharpenUpscale ? DynamicResolution::Sharpen : DynamicResolution::Bilinear;
+            dynamicResolution.SetSettings(settings);
+            dynamicResolution.SetEnabled(true);
+        }
+        if (!benchmarkOptions.textureArrays) {
+            Texture::SetArrayPool(nullptr);
+        }
+        if (!benchmarkOptions.textureAtlas) {
+            Mesh3D::SetTextureAtlas(nullptr);
+        }
+        if (!benchmarkOptions.textureStreaming) {
+            Texture::SetStreamer(nullptr);
+        }
+        textureStreamer.SetBudget(static_cast<uint64_t>(benchmarkOptions.textureBudgetMB) << 20);
+        SetGpuMemoryBudget(static_cast<uint64_t>(benchmarkOptions.gpuBudgetMB) << 20);
+        scene.SetImportSettings(benchmarkOptions.importSettings);
+        if (benchmarkOptions.scenePath.empty()) {
+            InitializeObjects();
+            InitializeModels();
+        }
+        else if (!LoadSceneFile(benchmarkOptions.scenePath)) {
+            CleanUp();
+            return 1;
+        }
+        if (benchmarkOptions.stress) {
+            stressScene.Generate(scene, benchmarkOptions.stressConfig, &portalSystem);
+            std::cout << "Stress scene: " << stressScene.GetObjectCount() << " objects, "
+                << stressScene.GetMovingCount() << " moving" << std::endl;
+        }
+
+        RunBenchmark(benchmarkOptions);
+
+        CleanUp();
+        return 0;
+    }
+
+    // --scene <path> --vsync off|on|adaptive --fps-cap <fps> --idle-fps <fps>
+    // --gpu-budget <MiB> --import-timings
+    std::string scenePath;
+    FrameLimiter::VSync vsync = FrameLimiter::VSyncOn;
+    int gpuBudgetMB = 0;
+    ImportSettings importSettings = ImportSettings::Production();
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--scene" && hasValue) {
+            scenePath = argv[++i];
+        }
+        else if (arg == "--vsync" && hasValue) {
+            if (!FrameLimiter::VSyncFromName(argv[++i], vsync)) {
+                std::cerr << "Unknown VSync mode: " << argv[i] << std::endl;
+            }
+        }
+        else if (arg == "--fps-cap" && hasValue) {
+            frameLimiter.SetFrameCap(std::atof(argv[++i]));
+        }
+        else if (arg == "--idle-fps" && hasValue) {
+            frameLimiter.SetIdleFrameRate(std::atof(argv[++i]));
+        }
+        else if (arg == "--gpu-budget" && hasValue) {
+            gpuBudgetMB = std::atoi(argv[++i]);
+        }
+        else if (arg == "--import-timings") {
+            // Each model's import time per post-processing step
+            importSettings.printTimings = true;
+        }
+    }
+
     InitializeProgram();
+    frameLimiter.SetVSync(vsync);
+
+    InitializeAudio();
 
     CreateGraphicsPipeline();
+    dynamicResolution.SetEnabled(true);
+    if (gpuBudgetMB > 0) {
+        SetGpuMemoryBudget(static_cast<uint64_t>(gpuBudgetMB) << 20);
+    }
 
-    InitializeObjects();
+    scene.SetImportSettings(importSettings);
 
-    InitializeModels();
+    if (!scenePath.empty()) {
+        if (!LoadSceneFile(scenePath)) {
+            CleanUp();
+            return 1;
+        }
+    }
+    else {
+        InitializeObjects();
+        InitializeModels();
+    }
 
     MainLoop();
 